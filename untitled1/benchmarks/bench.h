@@ -0,0 +1,258 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+#include "perf_counters.h"
+
+namespace bench {
+
+struct Options {
+    uint64_t seed = 20240601;           // Fixed so every run sees the same keys
+    int warmup = 1;                     // Untimed repetitions before measuring
+    int repetitions = 5;
+    size_t chunk = 16;                  // Operations per timed sample
+    std::vector<size_t> sizes = {1000, 100000, 1000000};
+    std::string format = "text";        // text | csv | json
+    std::string filter;                 // Only suites/engines/ops containing this
+    std::string trace;                  // Operation trace to replay (see workloads.h)
+    bool counters = true;               // Hardware counters per op, where available
+    double rate = 0;                    // Open-loop target ops/s for latency runs (0: closed loop)
+    bool large = false;                 // Also run the kary and veb suites past 10^6 keys
+};
+
+// Keeps the optimizer from discarding benchmarked work
+template<typename T>
+inline void doNotOptimize(const T& value) {
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    static volatile const T* sink;
+    sink = &value;
+#endif
+}
+
+inline uint64_t nowNs() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+struct Result {
+    std::string suite;
+    std::string engine;
+    std::string op;
+    size_t size = 0;
+    size_t samples = 0;
+    double medianNs = 0;                // Per operation
+    double p99Ns = 0;
+    double minNs = 0;
+    std::vector<std::pair<std::string, double>> extra;  // Suite-specific metrics
+};
+
+// Per-op samples of one benchmark, each the mean of a timed chunk
+class Samples {
+public:
+    void add(uint64_t elapsedNs, size_t ops) {
+        if (ops > 0) values_.push_back(static_cast<double>(elapsedNs) / static_cast<double>(ops));
+    }
+
+    bool empty() const { return values_.empty(); }
+
+    void summarize(Result& result) {
+        if (values_.empty()) return;
+        std::sort(values_.begin(), values_.end());
+        result.samples = values_.size();
+        result.minNs = values_.front();
+        result.medianNs = percentile(0.5);
+        result.p99Ns = percentile(0.99);
+    }
+
+private:
+    std::vector<double> values_;
+
+    double percentile(double p) const {
+        size_t index = static_cast<size_t>(p * static_cast<double>(values_.size() - 1) + 0.5);
+        return values_[std::min(index, values_.size() - 1)];
+    }
+};
+
+class Reporter {
+public:
+    explicit Reporter(const Options& options, std::ostream& out = std::cout)
+        : options_(options), out_(out) {}
+
+    bool selected(const std::string& suite, const std::string& engine, const std::string& op) const {
+        const std::string& f = options_.filter;
+        return f.empty() || suite.find(f) != std::string::npos ||
+               engine.find(f) != std::string::npos || op.find(f) != std::string::npos;
+    }
+
+    void add(Result result) {
+        if (options_.format == "text") printText(result);
+        results_.push_back(std::move(result));
+    }
+
+    // Emits machine-readable output (text rows are printed as they arrive)
+    void finish() {
+        if (options_.format == "csv") {
+            out_ << "suite,engine,op,size,samples,median_ns,p99_ns,min_ns,extra\n";
+            for (const auto& r : results_) {
+                out_ << r.suite << ',' << quoted(r.engine) << ',' << quoted(r.op) << ',' << r.size << ','
+                     << r.samples << ',' << r.medianNs << ',' << r.p99Ns << ',' << r.minNs << ",\"";
+                for (size_t i = 0; i < r.extra.size(); i++) {
+                    out_ << (i ? ";" : "") << r.extra[i].first << '=' << r.extra[i].second;
+                }
+                out_ << "\"\n";
+            }
+        } else if (options_.format == "json") {
+            out_ << "{\n  \"seed\": " << options_.seed << ",\n  \"repetitions\": " << options_.repetitions
+                 << ",\n  \"results\": [\n";
+            for (size_t i = 0; i < results_.size(); i++) {
+                const auto& r = results_[i];
+                out_ << "    {\"suite\": \"" << r.suite << "\", \"engine\": \"" << r.engine
+                     << "\", \"op\": \"" << r.op << "\", \"size\": " << r.size
+                     << ", \"samples\": " << r.samples << ", \"median_ns\": " << r.medianNs
+                     << ", \"p99_ns\": " << r.p99Ns << ", \"min_ns\": " << r.minNs;
+                for (const auto& [key, value] : r.extra) {
+                    out_ << ", \"" << key << "\": " << value;
+                }
+                out_ << "}" << (i + 1 < results_.size() ? "," : "") << "\n";
+            }
+            out_ << "  ]\n}\n";
+        }
+        out_.flush();
+    }
+
+    const std::vector<Result>& results() const { return results_; }
+
+private:
+    const Options& options_;
+    std::ostream& out_;
+    std::vector<Result> results_;
+    std::string lastSuite_;
+
+    static std::string quoted(const std::string& field) {
+        if (field.find_first_of(",\"") == std::string::npos) return field;
+        std::string escaped = "\"";
+        for (char c : field) {
+            if (c == '"') escaped += '"';
+            escaped += c;
+        }
+        return escaped + "\"";
+    }
+
+    void printText(const Result& r) {
+        if (r.suite != lastSuite_) {
+            lastSuite_ = r.suite;
+            out_ << "\n== " << r.suite << " ==\n"
+                 << std::left << std::setw(18) << "engine" << std::setw(18) << "op"
+                 << std::right << std::setw(10) << "size" << std::setw(12) << "median ns"
+                 << std::setw(12) << "p99 ns" << "\n";
+        }
+        out_ << std::left << std::setw(18) << r.engine << std::setw(18) << r.op
+             << std::right << std::setw(10) << r.size << std::fixed << std::setprecision(1);
+        if (r.samples > 0) {
+            out_ << std::setw(12) << r.medianNs << std::setw(12) << r.p99Ns;
+        } else {
+            out_ << std::setw(12) << "-" << std::setw(12) << "-";
+        }
+        for (const auto& [key, value] : r.extra) {
+            out_ << "  " << key << "=" << std::setprecision(value < 100 ? 2 : 0) << value;
+        }
+        out_ << "\n";
+    }
+};
+
+// Runs warmup + timed repetitions of a benchmark. setup() prepares a fresh
+// state before each repetition (untimed); run(sample) performs the work and
+// reports timings through sample(elapsedNs, ops). annotate(result) may add
+// derived metrics once the percentiles are known.
+// With hardware counters enabled, each timed run() is also counted and the
+// totals are reported per sampled op (this includes the clock reads between
+// chunks, a few instructions per op at the default chunk size).
+class Runner {
+public:
+    using SampleFn = std::function<void(uint64_t, size_t)>;
+
+    Runner(const Options& options, Reporter& reporter) : options_(options), reporter_(reporter) {
+        if (options_.counters) {
+            counters_ = std::make_unique<PerfCounters>();
+            if (!counters_->available()) {
+                std::cerr << "Hardware counters unavailable (perf_event_open refused); reporting time only\n";
+                counters_.reset();
+            }
+        }
+    }
+
+    const Options& options() const { return options_; }
+    Reporter& reporter() { return reporter_; }
+
+    template<typename Setup, typename Run>
+    void measure(Result result, Setup&& setup, Run&& run,
+                 const std::function<void(Result&)>& annotate = {}) {
+        if (!reporter_.selected(result.suite, result.engine, result.op)) return;
+
+        Samples samples;
+        size_t totalOps = 0;
+        SampleFn ignore = [](uint64_t, size_t) {};
+        SampleFn record = [&samples, &totalOps](uint64_t ns, size_t ops) {
+            samples.add(ns, ops);
+            totalOps += ops;
+        };
+        for (int i = 0; i < options_.warmup; i++) {
+            setup();
+            run(ignore);
+        }
+        if (counters_) counters_->reset();
+        for (int i = 0; i < options_.repetitions; i++) {
+            setup();
+            if (counters_) counters_->start();
+            run(record);
+            if (counters_) counters_->stop();
+        }
+        samples.summarize(result);
+        if (annotate && result.samples > 0) annotate(result);
+        if (counters_ && totalOps > 0) addCounters(result, totalOps);
+        reporter_.add(std::move(result));
+    }
+
+    // Times fn(i) for i in [0, count) in chunks of options().chunk operations
+    template<typename Fn>
+    void timeChunked(const SampleFn& sample, size_t count, Fn&& fn) const {
+        size_t chunk = std::max<size_t>(1, options_.chunk);
+        for (size_t begin = 0; begin < count; begin += chunk) {
+            size_t end = std::min(count, begin + chunk);
+            uint64_t start = nowNs();
+            for (size_t i = begin; i < end; i++) fn(i);
+            sample(nowNs() - start, end - begin);
+        }
+    }
+
+private:
+    const Options& options_;
+    Reporter& reporter_;
+    std::unique_ptr<PerfCounters> counters_;
+
+    void addCounters(Result& result, size_t ops) const {
+        double cycles = 0, instructions = 0;
+        for (const auto& [name, total] : counters_->read()) {
+            result.extra.emplace_back(name + "/op", total / static_cast<double>(ops));
+            if (name == "cycles") cycles = total;
+            if (name == "instr") instructions = total;
+        }
+        if (cycles > 0 && instructions > 0) result.extra.emplace_back("IPC", instructions / cycles);
+    }
+};
+
+}
+
+#endif
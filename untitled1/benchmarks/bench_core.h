@@ -0,0 +1,102 @@
+#ifndef BENCH_CORE_H
+#define BENCH_CORE_H
+
+#include <memory>
+#include <numeric>
+#include <random>
+#include <vector>
+#include "bench.h"
+#include "engines.h"
+
+namespace bench {
+
+// Present keys are the even numbers below 2n; odd numbers are misses
+struct KeySet {
+    std::vector<int> present;   // Shuffled insertion order
+    std::vector<int> probes;    // Present keys in a different order
+    std::vector<int> misses;
+
+    KeySet(size_t n, uint64_t seed) {
+        std::mt19937_64 gen(seed ^ n);
+        for (size_t i = 0; i < n; i++) {
+            present.push_back(static_cast<int>(2 * i));
+            misses.push_back(static_cast<int>(2 * i + 1));
+        }
+        std::shuffle(present.begin(), present.end(), gen);
+        probes = present;
+        std::shuffle(probes.begin(), probes.end(), gen);
+        std::shuffle(misses.begin(), misses.end(), gen);
+    }
+};
+
+// insert, lookup hit/miss, erase, iteration and copy for one engine and size
+template<typename Engine>
+void runCoreSuite(Runner& runner, size_t n) {
+    const char* engine = EngineName<Engine>::value;
+    KeySet keys(n, runner.options().seed);
+    auto result = [&](const char* op) {
+        Result r;
+        r.suite = "core";
+        r.engine = engine;
+        r.op = op;
+        r.size = n;
+        return r;
+    };
+
+    Engine built;
+    for (int key : keys.present) built.insert(key);
+    std::unique_ptr<Engine> scratch;
+
+    runner.measure(result("insert"),
+        [&] { scratch = std::make_unique<Engine>(); },
+        [&](const Runner::SampleFn& sample) {
+            runner.timeChunked(sample, n, [&](size_t i) { scratch->insert(keys.present[i]); });
+        });
+
+    runner.measure(result("lookup_hit"), [] {},
+        [&](const Runner::SampleFn& sample) {
+            size_t found = 0;
+            runner.timeChunked(sample, n, [&](size_t i) { found += built.contains(keys.probes[i]); });
+            doNotOptimize(found);
+        });
+
+    runner.measure(result("lookup_miss"), [] {},
+        [&](const Runner::SampleFn& sample) {
+            size_t found = 0;
+            runner.timeChunked(sample, n, [&](size_t i) { found += built.contains(keys.misses[i]); });
+            doNotOptimize(found);
+        });
+
+    runner.measure(result("erase"),
+        [&] { scratch = std::make_unique<Engine>(built); },
+        [&](const Runner::SampleFn& sample) {
+            runner.timeChunked(sample, n, [&](size_t i) { engineRemove(*scratch, keys.probes[i]); });
+        });
+
+    runner.measure(result("iterate"), [] {},
+        [&](const Runner::SampleFn& sample) {
+            size_t chunk = std::max<size_t>(1, runner.options().chunk);
+            long long sum = 0;
+            auto it = built.begin();
+            auto end = built.end();
+            while (it != end) {
+                size_t ops = 0;
+                uint64_t start = nowNs();
+                for (; ops < chunk && it != end; ++it, ++ops) sum += *it;
+                sample(nowNs() - start, ops);
+            }
+            doNotOptimize(sum);
+        });
+
+    runner.measure(result("copy"),
+        [&] { scratch.reset(); },
+        [&](const Runner::SampleFn& sample) {
+            uint64_t start = nowNs();
+            scratch = std::make_unique<Engine>(built);
+            sample(nowNs() - start, n);
+        });
+}
+
+}
+
+#endif
@@ -0,0 +1,887 @@
+#ifndef BENCH_FEATURES_H
+#define BENCH_FEATURES_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "bench.h"
+#include "engines.h"
+#include "workloads.h"
+#include "../include/AVL.h"
+#include "../include/Durable.h"
+#include "../include/Frozen.h"
+#include "../include/KaryTree.h"
+#include "../include/MappedTree.h"
+#include "../include/SmallTree.h"
+#include "../include/AVLMap.h"
+#include "../include/BSTMap.h"
+#include "../include/Multiset.h"
+#include "../include/StringTree.h"
+#include "../include/TickReader.h"
+#include "../include/Veb.h"
+#include "../include/Treap.h"
+#include "../include/WBTree.h"
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+namespace bench {
+
+inline std::string tempPath(const std::string& name) {
+    return (std::filesystem::temp_directory_path() / name).string();
+}
+
+// Live heap bytes as seen by the allocator, or 0 where unavailable
+inline size_t heapInUse() {
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+    auto info = mallinfo2();
+    return info.uordblks + info.hblkhd;     // Small chunks + mmapped blocks
+#else
+    return 0;
+#endif
+}
+
+inline Result featureResult(const std::string& suite, const std::string& engine,
+                            const std::string& op, size_t size) {
+    Result r;
+    r.suite = suite;
+    r.engine = engine;
+    r.op = op;
+    r.size = size;
+    return r;
+}
+
+inline ds::AVLTree<int> evenKeys(size_t n) {
+    std::vector<int> values(n);
+    for (size_t i = 0; i < n; i++) values[i] = static_cast<int>(2 * i);
+    ds::AVLTree<int> tree;
+    tree.assignSorted(std::move(values));
+    return tree;
+}
+
+// Page latency via resume tokens at several listing depths
+inline void runPagination(Runner& runner, size_t n) {
+    const size_t PAGE_SIZE = 50;
+    const size_t PAGES = 200;
+    ds::AVLTree<int> tree = evenKeys(n);
+
+    for (int depthPercent : {0, 25, 50, 75, 99}) {
+        int startKey = static_cast<int>(n / 100 * depthPercent * 2);
+        auto result = featureResult("pagination", "AVLTree", "page@" + std::to_string(depthPercent) + "%", n);
+
+        // Baseline: re-walk the listing from the start, as inorder() forces
+        uint64_t start = nowNs();
+        std::vector<int> naive;
+        tree.inorder([&](const int& val) {
+            if (val > startKey && naive.size() < PAGE_SIZE) naive.push_back(val);
+        });
+        result.extra.emplace_back("rewalk_ns", static_cast<double>(nowNs() - start));
+
+        runner.measure(result, [] {}, [&](const Runner::SampleFn& sample) {
+            for (size_t i = 0; i < PAGES; i++) {
+                uint64_t begin = nowNs();
+                auto page = tree.pageAfter(startKey, PAGE_SIZE);
+                sample(nowNs() - begin, 1);
+                doNotOptimize(page.items.data());
+            }
+        });
+    }
+}
+
+// Snapshot save/load throughput against rebuilding by insertion
+inline void runSnapshot(Runner& runner, size_t n) {
+    ds::AVLTree<int> tree = evenKeys(n);
+    std::string bytes;
+    {
+        std::stringstream buffer;
+        tree.save(buffer);
+        bytes = buffer.str();
+    }
+    double bytesPerKey = static_cast<double>(bytes.size()) / static_cast<double>(n);
+    auto throughput = [bytesPerKey](Result& r) {
+        r.extra.emplace_back("GB/s", bytesPerKey / r.medianNs);
+    };
+
+    runner.measure(featureResult("snapshot", "AVLTree", "save", n), [] {},
+        [&](const Runner::SampleFn& sample) {
+            std::stringstream out;
+            uint64_t start = nowNs();
+            tree.save(out);
+            sample(nowNs() - start, n);
+        }, throughput);
+
+    std::unique_ptr<ds::AVLTree<int>> loaded;
+    std::stringstream in;
+    runner.measure(featureResult("snapshot", "AVLTree", "load", n),
+        [&] { loaded = std::make_unique<ds::AVLTree<int>>(); in.str(bytes); in.clear(); },
+        [&](const Runner::SampleFn& sample) {
+            uint64_t start = nowNs();
+            loaded->load(in);
+            sample(nowNs() - start, n);
+        }, throughput);
+
+    runner.measure(featureResult("snapshot", "AVLTree", "reinsert", n),
+        [&] { loaded = std::make_unique<ds::AVLTree<int>>(); },
+        [&](const Runner::SampleFn& sample) {
+            uint64_t start = nowNs();
+            for (size_t i = 0; i < n; i++) loaded->insert(static_cast<int>(2 * i));
+            sample(nowNs() - start, n);
+        });
+}
+
+// Mapped file open and lookups against an in-memory tree
+inline void runMapped(Runner& runner, size_t n) {
+    ds::AVLTree<int> source = evenKeys(n);
+    std::string mappedPath = tempPath("ds_bench_mapped.bin");
+    std::string snapshotPath = tempPath("ds_bench_snapshot.bin");
+    ds::writeMappedTree(source, mappedPath);
+    {
+        std::ofstream out(snapshotPath, std::ios::binary);
+        source.save(out);
+    }
+
+    std::mt19937_64 gen(runner.options().seed);
+    std::uniform_int_distribution<int> dis(0, static_cast<int>(2 * n));
+    std::vector<int> probes(std::min<size_t>(n, 1000000));
+    for (int& probe : probes) probe = dis(gen);
+
+    runner.measure(featureResult("mapped", "mapped_tree", "open+first_query", n), [] {},
+        [&](const Runner::SampleFn& sample) {
+            uint64_t start = nowNs();
+            ds::mapped_tree<int> mapped(mappedPath);
+            bool hit = mapped.contains(probes[0]);
+            sample(nowNs() - start, 1);
+            doNotOptimize(hit);
+        });
+
+    runner.measure(featureResult("mapped", "AVLTree", "open+first_query", n), [] {},
+        [&](const Runner::SampleFn& sample) {
+            uint64_t start = nowNs();
+            ds::AVLTree<int> loaded;
+            std::ifstream in(snapshotPath, std::ios::binary);
+            loaded.load(in);
+            bool hit = loaded.contains(probes[0]);
+            sample(nowNs() - start, 1);
+            doNotOptimize(hit);
+        });
+
+    ds::mapped_tree<int> mapped(mappedPath);
+    runner.measure(featureResult("mapped", "mapped_tree", "lookup", n), [] {},
+        [&](const Runner::SampleFn& sample) {
+            size_t found = 0;
+            runner.timeChunked(sample, probes.size(), [&](size_t i) { found += mapped.contains(probes[i]); });
+            doNotOptimize(found);
+        });
+
+    runner.measure(featureResult("mapped", "AVLTree", "lookup", n), [] {},
+        [&](const Runner::SampleFn& sample) {
+            size_t found = 0;
+            runner.timeChunked(sample, probes.size(), [&](size_t i) { found += source.contains(probes[i]); });
+            doNotOptimize(found);
+        });
+
+    std::remove(mappedPath.c_str());
+    std::remove(snapshotPath.c_str());
+}
+
+// Durable inserts/removes at several group-commit windows
+inline void runGroupCommit(Runner& runner) {
+    const size_t OPS = 20000;
+    auto dir = tempPath("ds_bench_wal");
+    auto opsPerSec = [](Result& r) { r.extra.emplace_back("ops/s", 1e9 / r.medianNs); };
+
+    for (long long windowUs : {0LL, 100LL, 1000LL, 10000LL}) {
+        size_t groups = 0;
+        runner.measure(featureResult("group_commit", "DurableAVLTree",
+                                     "window=" + std::to_string(windowUs) + "us", OPS),
+            [&] { std::filesystem::remove_all(dir); },
+            [&](const Runner::SampleFn& sample) {
+                uint64_t start = nowNs();
+                ds::DurableAVLTree<int> tree(dir, ds::GroupCommit{1 << 20, std::chrono::microseconds(windowUs)});
+                for (size_t i = 0; i < OPS; i++) {
+                    tree.insert(static_cast<int>(i));
+                    if (i % 4 == 3) tree.remove(static_cast<int>(i - 2));
+                }
+                tree.sync();
+                sample(nowNs() - start, OPS + OPS / 4);
+                groups = tree.commitCount();
+            },
+            [&](Result& r) {
+                opsPerSec(r);
+                r.extra.emplace_back("fsyncs", static_cast<double>(groups));
+            });
+    }
+    std::filesystem::remove_all(dir);
+}
+
+// Streaming tick parser against getline + stod
+inline void runTickIngest(Runner& runner, size_t n) {
+    std::string path = tempPath("ds_bench_ticks.csv");
+    {
+        std::ofstream out(path, std::ios::binary);
+        std::mt19937_64 gen(runner.options().seed);
+        std::uniform_real_distribution<> price(1.0, 5000.0);
+        out << std::fixed << std::setprecision(2);
+        for (size_t i = 0; i < n; i++) {
+            out << "TICK" << (i % 5000) << "," << price(gen) << "\n";
+        }
+    }
+    auto linesPerSec = [](Result& r) { r.extra.emplace_back("lines/s", 1e9 / r.medianNs); };
+
+    runner.measure(featureResult("tick_ingest", "TickReader", "parse_line", n), [] {},
+        [&](const Runner::SampleFn& sample) {
+            double checksum = 0.0;
+            uint64_t start = nowNs();
+            ds::TickReader reader(path);
+            size_t lines = reader.forEachBatch([&checksum](const std::vector<ds::Tick>& batch) {
+                for (const auto& tick : batch) checksum += tick.price + static_cast<double>(tick.symbol.size());
+            });
+            sample(nowNs() - start, lines);
+            doNotOptimize(checksum);
+        }, linesPerSec);
+
+    runner.measure(featureResult("tick_ingest", "getline+stod", "parse_line", n), [] {},
+        [&](const Runner::SampleFn& sample) {
+            double checksum = 0.0;
+            uint64_t start = nowNs();
+            std::ifstream in(path);
+            std::string line;
+            size_t lines = 0;
+            while (std::getline(in, line)) {
+                size_t comma = line.find(',');
+                std::string symbol = line.substr(0, comma);
+                checksum += std::stod(line.substr(comma + 1)) + static_cast<double>(symbol.size());
+                lines++;
+            }
+            sample(nowNs() - start, lines);
+            doNotOptimize(checksum);
+        }, linesPerSec);
+
+    std::remove(path.c_str());
+}
+
+// One row of the footprint table: measured heap growth per key, plus the
+// memory_usage() breakdown for engines that provide it
+template<typename Engine, typename MakeKey>
+void memoryRow(Runner& runner, const std::string& engine, size_t n, MakeKey&& makeKey) {
+    if (!runner.reporter().selected("memory", engine, "bytes_per_key")) return;
+
+    size_t before = heapInUse();
+    Engine tree;
+    for (size_t i = 0; i < n; i++) tree.insert(makeKey(i));
+    auto result = featureResult("memory", engine, "bytes_per_key", n);
+    auto perKey = [n](size_t bytes) { return static_cast<double>(bytes) / static_cast<double>(n); };
+    result.extra.emplace_back("heap", perKey(heapInUse() - before));
+    if constexpr (requires { tree.memory_usage(); }) {
+        ds::MemoryUsage usage = tree.memory_usage();
+        result.extra.emplace_back("total", usage.bytesPerKey());
+        result.extra.emplace_back("node", perKey(usage.nodeBytes));
+        result.extra.emplace_back("malloc", perKey(usage.allocatorOverhead));
+        result.extra.emplace_back("payload", perKey(usage.payloadHeapBytes));
+    }
+    runner.reporter().add(result);
+}
+
+// Bytes per key for each engine and key type; "heap" is measured through the
+// allocator, the rest is the engine's own memory_usage() accounting
+inline void runMemoryFootprint(Runner& runner, size_t n) {
+    auto intKey = [](size_t i) { return static_cast<int>(i * 2654435761u % 2147483647u); };
+    auto wideKey = [](size_t i) { return static_cast<int64_t>(i * 0x9E3779B97F4A7C15ull); };
+    auto nameKey = [](size_t i) { return "Contact, Number " + std::to_string(i * 7919); };
+
+    memoryRow<ds::BST<int>>(runner, "BST<int>", n, intKey);
+    memoryRow<ds::AVLTree<int>>(runner, "AVLTree<int>", n, intKey);
+    memoryRow<ds::WBTree<int>>(runner, "WBTree<int>", n, intKey);
+    memoryRow<std::set<int>>(runner, "std::set<int>", n, intKey);
+    memoryRow<ds::BST<int64_t>>(runner, "BST<int64>", n, wideKey);
+    memoryRow<ds::AVLTree<int64_t>>(runner, "AVLTree<int64>", n, wideKey);
+    memoryRow<ds::WBTree<int64_t>>(runner, "WBTree<int64>", n, wideKey);
+    memoryRow<std::set<int64_t>>(runner, "std::set<int64>", n, wideKey);
+    memoryRow<ds::BST<std::string>>(runner, "BST<string>", n, nameKey);
+    memoryRow<ds::AVLTree<std::string>>(runner, "AVLTree<string>", n, nameKey);
+    memoryRow<ds::WBTree<std::string>>(runner, "WBTree<string>", n, nameKey);
+    memoryRow<std::set<std::string>>(runner, "std::set<string>", n, nameKey);
+    memoryRow<ds::StringTree>(runner, "StringTree", n, nameKey);
+}
+
+// Bytes per entry for contact-style names. The shared row is a second
+// StringTree over the same names and arena: the arena stores each name
+// once, so that tree pays for its nodes only.
+inline void runStringMemory(Runner& runner, size_t n) {
+    if (!runner.reporter().selected("string_memory", "StringTree", "bytes_per_entry")) return;
+
+    const char* lastNames[] = {"Anderson", "Brown", "Garcia", "Johnson", "Martinez",
+                               "Miller", "Rodriguez", "Smith", "Williams", "Wilson"};
+    auto nameOf = [&lastNames](size_t i) {
+        return std::string(lastNames[i % 10]) + ", Contact " + std::to_string(i);
+    };
+
+    size_t before = heapInUse();
+    {
+        ds::AVLTree<std::string> tree;
+        for (size_t i = 0; i < n; i++) tree.insert(nameOf(i));
+        auto result = featureResult("string_memory", "AVLTree<string>", "bytes_per_entry", n);
+        result.extra.emplace_back("heap", static_cast<double>(heapInUse() - before) / static_cast<double>(n));
+        runner.reporter().add(result);
+    }
+
+    before = heapInUse();
+    auto arena = std::make_shared<ds::StringArena>();
+    ds::StringTree compact(arena);
+    compact.reserve(n);
+    for (size_t i = 0; i < n; i++) compact.insert(nameOf(i));
+    auto result = featureResult("string_memory", "StringTree", "bytes_per_entry", n);
+    result.extra.emplace_back("heap", static_cast<double>(heapInUse() - before) / static_cast<double>(n));
+    result.extra.emplace_back("reserved", static_cast<double>(compact.memoryBytes()) / static_cast<double>(n));
+    runner.reporter().add(result);
+
+    before = heapInUse();
+    ds::StringTree shared(arena);
+    shared.reserve(n);
+    for (size_t i = 0; i < n; i++) shared.insert(nameOf(i));
+    auto sharedResult = featureResult("string_memory", "StringTree/shared", "bytes_per_entry", n);
+    sharedResult.extra.emplace_back("heap", static_cast<double>(heapInUse() - before) / static_cast<double>(n));
+    runner.reporter().add(sharedResult);
+}
+
+// Bulk set operations: Treap split/merge (one thread and all cores) against
+// AVLTree doing the same work key by key. Both sides hold n random keys
+// from [0, 4n); times are per key of the second operand (per removed key
+// for erase_range).
+inline void runBulkOps(Runner& runner, size_t n) {
+    std::mt19937_64 gen(runner.options().seed ^ n);
+    std::uniform_int_distribution<int> dis(0, static_cast<int>(4 * n) - 1);
+    std::vector<int> left(n), right(n), batch(n / 4);
+    for (int& key : left) key = dis(gen);
+    for (int& key : right) key = dis(gen);
+    for (int& key : batch) key = dis(gen);
+
+    ds::AVLTree<int> avlLeft, avlRight;
+    ds::Treap<int> treapLeft, treapRight;
+    for (int key : left) {
+        avlLeft.insert(key);
+        treapLeft.insert(key);
+    }
+    for (int key : right) {
+        avlRight.insert(key);
+        treapRight.insert(key);
+    }
+    int low = static_cast<int>(n), high = static_cast<int>(3 * n);     // The middle half
+    std::vector<int> inRange;
+    for (auto it = avlLeft.lower_bound(low); it != avlLeft.end() && *it < high; ++it) inRange.push_back(*it);
+
+    std::unique_ptr<ds::AVLTree<int>> avl;
+    auto avlRow = [&](const std::string& op, size_t ops, auto&& work) {
+        runner.measure(featureResult("bulk", "AVLTree", op, n),
+            [&] { avl = std::make_unique<ds::AVLTree<int>>(avlLeft); },
+            [&](const Runner::SampleFn& sample) {
+                uint64_t start = nowNs();
+                work(*avl);
+                sample(nowNs() - start, ops);
+            });
+    };
+    avlRow("union", n, [&](ds::AVLTree<int>& tree) { for (int key : right) tree.insert(key); });
+    avlRow("intersect", n, [&](ds::AVLTree<int>& tree) {
+        for (int key : left) {
+            if (!avlRight.contains(key)) tree.remove(key);
+        }
+    });
+    avlRow("subtract", n, [&](ds::AVLTree<int>& tree) { for (int key : right) tree.remove(key); });
+    avlRow("erase_range", inRange.size(), [&](ds::AVLTree<int>& tree) { for (int key : inRange) tree.remove(key); });
+    avlRow("insert_bulk", batch.size(), [&](ds::AVLTree<int>& tree) { for (int key : batch) tree.insert(key); });
+
+    std::unique_ptr<ds::Treap<int>> treap, other;
+    for (unsigned threads : {1u, 0u}) {
+        const std::string engine = threads == 1 ? "Treap" : "Treap/parallel";
+        auto treapRow = [&](const std::string& op, size_t ops, auto&& work) {
+            runner.measure(featureResult("bulk", engine, op, n),
+                [&] {
+                    treap = std::make_unique<ds::Treap<int>>(treapLeft);
+                    other = std::make_unique<ds::Treap<int>>(treapRight);
+                },
+                [&](const Runner::SampleFn& sample) {
+                    uint64_t start = nowNs();
+                    work(*treap);
+                    sample(nowNs() - start, ops);
+                });
+        };
+        treapRow("union", n, [&](ds::Treap<int>& tree) { tree.unite(std::move(*other), threads); });
+        treapRow("intersect", n, [&](ds::Treap<int>& tree) { tree.intersect(std::move(*other), threads); });
+        treapRow("subtract", n, [&](ds::Treap<int>& tree) { tree.subtract(std::move(*other), threads); });
+        if (threads == 1) {
+            treapRow("erase_range", inRange.size(), [&](ds::Treap<int>& tree) { tree.eraseRange(low, high); });
+        }
+        treapRow("insert_bulk", batch.size(), [&](ds::Treap<int>& tree) { tree.insertBulk(batch, threads); });
+    }
+}
+
+// k-th smallest key by walking the in-order sequence, for engines without
+// order statistics
+template<typename Engine>
+int walkSelect(const Engine& tree, size_t k) {
+    auto it = tree.begin();
+    while (k-- > 0) ++it;
+    return *it;
+}
+
+// Keys below key, counted by walking the in-order sequence
+template<typename Engine>
+size_t walkRank(const Engine& tree, int key) {
+    size_t count = 0;
+    for (auto it = tree.begin(); it != tree.end() && *it < key; ++it) count++;
+    return count;
+}
+
+// Percentile queries over a book of n distinct prices, as StockMarket runs
+// them. WBTree reads ranks off its subtree sizes in O(log n); AVLTree has
+// no order statistics and walks the in-order sequence, so it gets fewer
+// queries per sample. tick+p50 replaces one price, then asks for the median.
+inline void runPercentiles(Runner& runner, size_t n) {
+    const size_t QUERIES = std::min<size_t>(n, 10000);
+    const size_t WALKS = 20;
+    std::vector<int> keys = workload::shuffled(2 * n, runner.options().seed ^ n);
+    std::vector<int> book(keys.begin(), keys.begin() + n);
+    std::vector<int> sortedBook(book);
+    std::sort(sortedBook.begin(), sortedBook.end());
+
+    std::mt19937_64 gen(runner.options().seed ^ n);
+    std::vector<size_t> ranks(QUERIES);
+    std::vector<int> probes(QUERIES);
+    for (size_t i = 0; i < QUERIES; i++) {
+        ranks[i] = gen() % n;
+        probes[i] = static_cast<int>(gen() % (2 * n));
+    }
+
+    auto rows = [&](auto& tree, const std::string& engine, size_t queries, auto&& select, auto&& rank) {
+        runner.measure(featureResult("percentile", engine, "select", n), [] {},
+            [&](const Runner::SampleFn& sample) {
+                runner.timeChunked(sample, queries, [&](size_t i) { doNotOptimize(select(tree, ranks[i])); });
+            });
+        runner.measure(featureResult("percentile", engine, "rank", n), [] {},
+            [&](const Runner::SampleFn& sample) {
+                runner.timeChunked(sample, queries, [&](size_t i) { doNotOptimize(rank(tree, probes[i])); });
+            });
+        runner.measure(featureResult("percentile", engine, "tick+p50", n),
+            [&] { tree.assignSorted(sortedBook); },
+            [&](const Runner::SampleFn& sample) {
+                runner.timeChunked(sample, queries, [&](size_t i) {
+                    tree.remove(book[i]);
+                    tree.insert(keys[n + i]);
+                    doNotOptimize(select(tree, tree.size() / 2));
+                });
+            });
+    };
+
+    ds::WBTree<int> weighted;
+    weighted.assignSorted(sortedBook);
+    rows(weighted, "WBTree", QUERIES,
+         [](const ds::WBTree<int>& tree, size_t k) { return tree.select(k); },
+         [](const ds::WBTree<int>& tree, int key) { return tree.rank(key); });
+
+    ds::AVLTree<int> avl;
+    avl.assignSorted(sortedBook);
+    rows(avl, "AVLTree", std::min(QUERIES, WALKS), walkSelect<ds::AVLTree<int>>, walkRank<ds::AVLTree<int>>);
+}
+
+// ContactManager's records two ways: the old layout, one Contact ordered by
+// name with the details riding along in the key, and name -> details maps
+struct ContactDetails {
+    std::string phone;
+    std::string email;
+    std::string address;
+};
+
+struct ContactRecord {
+    std::string name;
+    ContactDetails details;
+
+    bool operator<(const ContactRecord& other) const { return name < other.name; }
+    bool operator>(const ContactRecord& other) const { return name > other.name; }
+};
+
+// Build, lookup by name, phone update, full listing and 20-entry pages for
+// n contacts. An update in the set has to remove and reinsert the record;
+// the maps assign the value in place. bytes/key is memory_usage() per contact.
+inline void runContacts(Runner& runner, size_t n) {
+    const size_t lookups = std::min<size_t>(n, 1000000);
+    std::vector<std::string> names(n);
+    std::vector<ContactDetails> details(n);
+    std::vector<size_t> order(n);
+    for (size_t i = 0; i < n; i++) {
+        names[i] = "user" + std::to_string(1000000000 + i);
+        details[i] = ContactDetails{"+1-555-" + std::to_string(1000000 + i),
+                                    names[i] + "@mail.example.com",
+                                    std::to_string(i % 9999) + " Long Street Name, Springfield"};
+        order[i] = i;
+    }
+    std::mt19937_64 gen(runner.options().seed ^ n);
+    std::shuffle(order.begin(), order.end(), gen);
+    std::vector<size_t> probes(lookups);
+    for (size_t& probe : probes) probe = gen() % n;
+
+    auto rows = [&](const std::string& engine, auto& book, auto&& add, auto&& phoneOf, auto&& setPhone, auto&& scan) {
+        runner.measure(featureResult("contacts", engine, "build", n),
+            [&] { book.clear(); },
+            [&](const Runner::SampleFn& sample) {
+                uint64_t start = nowNs();
+                for (size_t i : order) add(i);
+                sample(nowNs() - start, n);
+            });
+        double bytesPerKey = book.memory_usage().bytesPerKey();
+        auto annotate = [bytesPerKey](Result& r) { r.extra.emplace_back("bytes/key", bytesPerKey); };
+        runner.measure(featureResult("contacts", engine, "lookup", n), [] {},
+            [&](const Runner::SampleFn& sample) {
+                size_t length = 0;
+                runner.timeChunked(sample, lookups, [&](size_t i) { length += phoneOf(names[probes[i]]).size(); });
+                doNotOptimize(length);
+            }, annotate);
+        runner.measure(featureResult("contacts", engine, "update", n), [] {},
+            [&](const Runner::SampleFn& sample) {
+                runner.timeChunked(sample, lookups, [&](size_t i) { setPhone(probes[i], details[i % n].phone); });
+            }, annotate);
+        runner.measure(featureResult("contacts", engine, "iterate", n), [] {},
+            [&](const Runner::SampleFn& sample) {
+                size_t length = 0;
+                uint64_t start = nowNs();
+                scan([&length](const std::string& name, const ContactDetails& info) { length += name.size() + info.phone.size(); });
+                sample(nowNs() - start, n);
+                doNotOptimize(length);
+            }, annotate);
+        runner.measure(featureResult("contacts", engine, "page20", n), [] {},
+            [&](const Runner::SampleFn& sample) {
+                size_t pages = 0;
+                uint64_t start = nowNs();
+                for (auto token = decltype(book.page({}, 20).next)(); ; pages++) {
+                    auto page = book.page(token, 20);
+                    token = page.next;
+                    if (!page.hasMore) break;
+                }
+                sample(nowNs() - start, n);
+                doNotOptimize(pages);
+            }, annotate);
+    };
+
+    ds::AVLTree<ContactRecord> records;
+    rows("AVLTree<Contact>", records,
+        [&](size_t i) { records.insert(ContactRecord{names[i], details[i]}); },
+        [&](const std::string& name) -> const std::string& {
+            return records.lower_bound(ContactRecord{name, {}})->details.phone;
+        },
+        [&](size_t i, const std::string& phone) {
+            ContactRecord record = *records.lower_bound(ContactRecord{names[i], {}});
+            records.remove(record);
+            record.details.phone = phone;
+            records.insert(record);
+        },
+        [&](auto&& visit) {
+            records.scanInorder([&visit](const ContactRecord& record) { visit(record.name, record.details); });
+        });
+    records.clear();
+
+    auto mapRows = [&](const std::string& engine, auto& map) {
+        rows(engine, map,
+            [&](size_t i) { map.insert_or_assign(names[i], details[i]); },
+            [&](const std::string& name) -> const std::string& { return map.find(name)->phone; },
+            [&](size_t i, const std::string& phone) { map.find(names[i])->phone = phone; },
+            [&](auto&& visit) { map.scanInorder(visit); });
+        map.clear();
+    };
+    ds::AVLMap<std::string, ContactDetails> avlMap;
+    mapRows("AVLMap", avlMap);
+    ds::BSTMap<std::string, ContactDetails> bstMap;
+    mapRows("BSTMap", bstMap);
+}
+
+// Even keys below 2n, with random present and absent probes (at most 1M)
+struct SearchProbes {
+    std::vector<int> sorted, hits, misses;
+
+    SearchProbes(size_t n, uint64_t seed) : sorted(n) {
+        const size_t lookups = std::min<size_t>(n, 1000000);
+        std::mt19937_64 gen(seed ^ n);
+        for (size_t i = 0; i < n; i++) sorted[i] = static_cast<int>(2 * i);
+        for (size_t i = 0; i < lookups; i++) {
+            hits.push_back(static_cast<int>(2 * (gen() % n)));
+            misses.push_back(hits.back() + 1);
+        }
+    }
+};
+
+// lookup_hit, lookup_miss and lower_bound rows for an engine with Key keys
+template<typename Key, typename Engine>
+void searchRows(Runner& runner, const std::string& suite, const std::string& engine, Engine& tree,
+                const SearchProbes& probes, const std::function<void(Result&)>& annotate = {}) {
+    const size_t n = probes.sorted.size();
+    const size_t lookups = probes.hits.size();
+    size_t found = 0;
+    runner.measure(featureResult(suite, engine, "lookup_hit", n), [] {},
+        [&](const Runner::SampleFn& sample) {
+            runner.timeChunked(sample, lookups, [&](size_t i) { found += tree.contains(static_cast<Key>(probes.hits[i])); });
+        }, annotate);
+    runner.measure(featureResult(suite, engine, "lookup_miss", n), [] {},
+        [&](const Runner::SampleFn& sample) {
+            runner.timeChunked(sample, lookups, [&](size_t i) { found += tree.contains(static_cast<Key>(probes.misses[i])); });
+        }, annotate);
+    runner.measure(featureResult(suite, engine, "lower_bound", n), [] {},
+        [&](const Runner::SampleFn& sample) {
+            runner.timeChunked(sample, lookups, [&](size_t i) {
+                found += tree.lower_bound(static_cast<Key>(probes.misses[i])) != tree.end();
+            });
+        }, annotate);
+    doNotOptimize(found);
+}
+
+// Lookup throughput of the SIMD k-ary search tree against the pointer trees
+// on the same keys, as int and as double (the StockPrice::price case).
+// KaryTree rows read Kary<key>/simd (Kary128 for two-line blocks), naming
+// the block search compiled in.
+inline void runKarySearch(Runner& runner, size_t n) {
+    SearchProbes probes(n, runner.options().seed);
+    const std::vector<int>& sorted = probes.sorted;
+    auto rows = [&](const std::string& engine, auto& tree, auto key) {
+        searchRows<decltype(key)>(runner, "kary", engine, tree, probes);
+    };
+    auto karyName = [](const char* key, size_t nodeBytes, const char* simd) {
+        return "Kary" + (nodeBytes == 64 ? std::string() : std::to_string(nodeBytes)) + "<" + key + ">/" + simd;
+    };
+
+    {
+        ds::AVLTree<int> avl;
+        avl.assignSorted(sorted);
+        rows("AVLTree<int>", avl, int{});
+    }
+    {
+        ds::BTree<int> btree;
+        for (int key : sorted) btree.insert(key);
+        rows("BTree<int>", btree, int{});
+    }
+    {
+        ds::KaryTree<int, 64> kary(sorted);
+        rows(karyName("int", 64, kary.simd), kary, int{});
+    }
+    {
+        ds::KaryTree<int, 128> kary(sorted);
+        rows(karyName("int", 128, kary.simd), kary, int{});
+    }
+
+    std::vector<double> prices(sorted.begin(), sorted.end());
+    {
+        ds::AVLTree<double> avl;
+        avl.assignSorted(prices);
+        rows("AVLTree<double>", avl, double{});
+    }
+    {
+        ds::KaryTree<double, 64> kary(prices);
+        rows(karyName("double", 64, kary.simd), kary, double{});
+    }
+}
+
+// Frozen (Eytzinger array, branch-free search) against the pointer trees it
+// was frozen from, plus the cost per key of freezing, thawing and iterating
+inline void runFrozen(Runner& runner, size_t n) {
+    SearchProbes probes(n, runner.options().seed);
+    ds::AVLTree<int> avl;
+    avl.assignSorted(probes.sorted);
+    ds::BST<int> bst;
+    bst.assignSorted(probes.sorted);
+    ds::FrozenTree<int> frozen = avl.freeze();
+
+    searchRows<int>(runner, "frozen", "AVLTree", avl, probes);
+    searchRows<int>(runner, "frozen", "BST", bst, probes);
+    searchRows<int>(runner, "frozen", "FrozenTree", frozen, probes);
+
+    auto iterate = [&](const std::string& engine, const auto& tree) {
+        runner.measure(featureResult("frozen", engine, "iterate", n), [] {},
+            [&](const Runner::SampleFn& sample) {
+                long long sum = 0;
+                uint64_t start = nowNs();
+                tree.scanInorder([&sum](const int& key) { sum += key; });
+                sample(nowNs() - start, n);
+                doNotOptimize(sum);
+            });
+    };
+    iterate("AVLTree", avl);
+    iterate("FrozenTree", frozen);
+
+    runner.measure(featureResult("frozen", "AVLTree", "freeze", n), [] {},
+        [&](const Runner::SampleFn& sample) {
+            uint64_t start = nowNs();
+            ds::FrozenTree<int> copy = avl.freeze();
+            sample(nowNs() - start, n);
+            doNotOptimize(copy.size());
+        });
+    runner.measure(featureResult("frozen", "FrozenTree", "thaw", n), [] {},
+        [&](const Runner::SampleFn& sample) {
+            uint64_t start = nowNs();
+            ds::AVLTree<int> copy = frozen.thaw();
+            sample(nowNs() - start, n);
+            doNotOptimize(copy.size());
+        });
+}
+
+// Eytzinger against van Emde Boas layout, frozen from the same keys, with
+// each array's footprint next to the times. TLB reach is about 6 MB with
+// 4 KiB pages and a few GB with 2 MiB pages: the default sizes (up to 4 MB
+// of keys) only pass the first, --large adds 10^8 and 10^9 keys to pass
+// both. Compare runs with transparent huge pages on and off.
+inline void runVeb(Runner& runner, size_t n) {
+    SearchProbes probes(n, runner.options().seed);
+    auto footprint = [](const ds::MemoryUsage& usage) {
+        double mb = static_cast<double>(usage.nodeBytes) / (1 << 20);
+        return [mb](Result& r) { r.extra.emplace_back("MB", mb); };
+    };
+    {
+        ds::FrozenTree<int> eytzinger(probes.sorted);
+        searchRows<int>(runner, "veb", "Eytzinger", eytzinger, probes, footprint(eytzinger.memory_usage()));
+    }
+    {
+        ds::VebTree<int> veb(probes.sorted);
+        searchRows<int>(runner, "veb", "vEB", veb, probes, footprint(veb.memory_usage()));
+    }
+}
+
+// One engine's rows for n keys spread over n / k sets of k keys each
+template<typename Engine>
+void smallSetRows(Runner& runner, const std::string& engine, size_t n, size_t k) {
+    const size_t sets = std::max<size_t>(1, n / k);
+    const size_t lookups = std::min<size_t>(n, 1000000);
+    const std::string suffix = "/k=" + std::to_string(k);
+    std::mt19937_64 gen(runner.options().seed ^ n ^ k);
+    std::vector<int> keys(sets * k);
+    for (int& key : keys) key = static_cast<int>(gen() % 1000000000);
+    std::vector<size_t> probeSet(lookups);
+    std::vector<int> probeKey(lookups);
+    for (size_t i = 0; i < lookups; i++) {
+        probeSet[i] = gen() % sets;
+        probeKey[i] = keys[probeSet[i] * k + gen() % k];
+    }
+    auto build = [&](std::vector<Engine>& all) {
+        for (size_t s = 0; s < sets; s++) {
+            for (size_t j = 0; j < k; j++) all[s].insert(keys[s * k + j]);
+        }
+    };
+
+    std::unique_ptr<std::vector<Engine>> scratch;
+    runner.measure(featureResult("small", engine, "build" + suffix, n),
+        [&] { scratch = std::make_unique<std::vector<Engine>>(sets); },
+        [&](const Runner::SampleFn& sample) {
+            uint64_t start = nowNs();
+            build(*scratch);
+            sample(nowNs() - start, sets * k);
+        });
+    scratch.reset();
+
+    size_t before = heapInUse();
+    std::vector<Engine> all(sets);
+    build(all);
+    double bytesPerKey = static_cast<double>(heapInUse() - before) / static_cast<double>(sets * k);
+    auto annotate = [bytesPerKey](Result& r) { r.extra.emplace_back("bytes/key", bytesPerKey); };
+
+    runner.measure(featureResult("small", engine, "lookup" + suffix, n), [] {},
+        [&](const Runner::SampleFn& sample) {
+            size_t found = 0;
+            runner.timeChunked(sample, lookups, [&](size_t i) { found += all[probeSet[i]].contains(probeKey[i]); });
+            doNotOptimize(found);
+        }, annotate);
+    runner.measure(featureResult("small", engine, "iterate" + suffix, n), [] {},
+        [&](const Runner::SampleFn& sample) {
+            long long sum = 0;
+            uint64_t start = nowNs();
+            for (const Engine& set : all) {
+                for (int key : set) sum += key;
+            }
+            sample(nowNs() - start, sets * k);
+            doNotOptimize(sum);
+        }, annotate);
+}
+
+// Many tiny sets, like per-user indexes: AVLTree pays a heap node per key,
+// SmallTree keeps up to 32 keys inside the object (k = 64 shows it after
+// promotion). Times are per key inserted, per lookup in a random set and
+// per key iterated; bytes/key counts the heap plus the vector of sets.
+inline void runSmallSets(Runner& runner, size_t n) {
+    for (size_t k : {4, 16, 32, 64}) {
+        smallSetRows<ds::AVLTree<int>>(runner, "AVLTree", n, k);
+        smallSetRows<ds::SmallTree<int>>(runner, "SmallTree", n, k);
+    }
+}
+
+// n entries spread over `levels` distinct keys, from a few busy price
+// levels up to all-distinct. AVLMultimap keeps one node per key with the
+// payloads in it; WBTree (keyed by key, then sequence number) and
+// std::multimap keep one node per entry. count is the entries under one
+// key, which std::multimap walks, so it gets fewer queries on few levels.
+// heap/entry is the allocator's growth during build.
+inline void runMultiset(Runner& runner, size_t n) {
+    const size_t lookups = std::min<size_t>(n, 1000000);
+    for (size_t levels : {size_t{16}, size_t{1024}, n}) {
+        std::mt19937_64 gen(runner.options().seed ^ n ^ levels);
+        std::vector<int> keys(n);
+        for (int& key : keys) key = static_cast<int>(gen() % levels);
+        std::vector<int> probes(lookups);
+        for (int& probe : probes) probe = static_cast<int>(gen() % levels);
+        const std::string suffix = "/levels=" + std::to_string(levels);
+
+        auto rows = [&](const std::string& engine, auto& book, size_t countQueries, auto&& add, auto&& count, auto&& scan) {
+            double heapPerEntry = 0;
+            runner.measure(featureResult("multiset", engine, "insert" + suffix, n),
+                [&] { book.clear(); },
+                [&](const Runner::SampleFn& sample) {
+                    size_t before = heapInUse();
+                    uint64_t start = nowNs();
+                    for (size_t i = 0; i < n; i++) add(keys[i], static_cast<int>(i));
+                    sample(nowNs() - start, n);
+                    heapPerEntry = static_cast<double>(heapInUse() - before) / static_cast<double>(n);
+                });
+            auto annotate = [&](Result& r) {
+                r.extra.emplace_back("heap/entry", heapPerEntry);
+                if constexpr (requires { book.height(); }) r.extra.emplace_back("height", static_cast<double>(book.height()));
+            };
+            runner.measure(featureResult("multiset", engine, "count" + suffix, n), [] {},
+                [&](const Runner::SampleFn& sample) {
+                    size_t total = 0;
+                    runner.timeChunked(sample, countQueries, [&](size_t i) { total += count(probes[i]); });
+                    doNotOptimize(total);
+                }, annotate);
+            runner.measure(featureResult("multiset", engine, "iterate" + suffix, n), [] {},
+                [&](const Runner::SampleFn& sample) {
+                    int64_t sum = 0;
+                    uint64_t start = nowNs();
+                    scan([&sum](int key, int value) { sum += key + value; });
+                    sample(nowNs() - start, n);
+                    doNotOptimize(sum);
+                }, annotate);
+            book.clear();
+        };
+
+        ds::AVLMultimap<int, int> multimap;
+        rows("AVLMultimap", multimap, lookups,
+            [&](int key, int value) { multimap.insert(key, value); },
+            [&](int key) { return multimap.count(key); },
+            [&](auto&& visit) { multimap.scanInorder(visit); });
+
+        ds::WBTree<std::pair<int, int>> sequenced;
+        rows("WBTree<pair>", sequenced, lookups,
+            [&](int key, int value) { sequenced.insert({key, value}); },
+            [&](int key) { return sequenced.countRange({key, 0}, {key + 1, 0}); },
+            [&](auto&& visit) { sequenced.scanInorder([&visit](const std::pair<int, int>& entry) { visit(entry.first, entry.second); }); });
+
+        std::multimap<int, int> reference;
+        rows("std::multimap", reference, std::min(lookups, std::max<size_t>(16, lookups * levels / n)),
+            [&](int key, int value) { reference.emplace(key, value); },
+            [&](int key) { return reference.count(key); },
+            [&](auto&& visit) { for (const auto& [key, value] : reference) visit(key, value); });
+    }
+}
+
+}
+
+#endif
@@ -0,0 +1,110 @@
+#ifndef BENCH_LATENCY_H
+#define BENCH_LATENCY_H
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "bench.h"
+#include "bench_core.h"
+#include "engines.h"
+#include "hdr_histogram.h"
+
+namespace bench {
+
+// Fills a Result from a latency histogram: median/p99/min columns plus the
+// tail percentiles the SLA is written against
+inline void reportLatency(Runner& runner, Result result, const HdrHistogram& histogram) {
+    result.samples = histogram.count();
+    result.medianNs = static_cast<double>(histogram.valueAtPercentile(50));
+    result.p99Ns = static_cast<double>(histogram.valueAtPercentile(99));
+    result.minNs = static_cast<double>(histogram.min());
+    result.extra.emplace_back("p90", static_cast<double>(histogram.valueAtPercentile(90)));
+    result.extra.emplace_back("p99.9", static_cast<double>(histogram.valueAtPercentile(99.9)));
+    result.extra.emplace_back("max", static_cast<double>(histogram.max()));
+    runner.reporter().add(std::move(result));
+}
+
+// Runs op(i) for i in [0, count). Closed loop (rate 0) issues each op as soon
+// as the previous one returns and records its service time; one clock read
+// per op serves as the end of one and the start of the next. Open loop issues
+// op i at start + i / rate and records latency from that intended start, so a
+// stall is charged to every request queued behind it (no coordinated
+// omission). Returns the achieved rate in ops/s.
+template<typename Op>
+double driveLatency(HdrHistogram& histogram, size_t count, double rate, Op&& op) {
+    uint64_t start = nowNs();
+    if (rate <= 0) {
+        uint64_t previous = start;
+        for (size_t i = 0; i < count; i++) {
+            op(i);
+            uint64_t now = nowNs();
+            histogram.record(now - previous);
+            previous = now;
+        }
+    } else {
+        double interval = 1e9 / rate;
+        for (size_t i = 0; i < count; i++) {
+            uint64_t intended = start + static_cast<uint64_t>(static_cast<double>(i) * interval);
+            while (nowNs() < intended) {}
+            op(i);
+            histogram.record(nowNs() - intended);
+        }
+    }
+    uint64_t elapsed = nowNs() - start;
+    return elapsed ? static_cast<double>(count) * 1e9 / static_cast<double>(elapsed) : 0.0;
+}
+
+// Per-operation latency of insert, contains and erase for one engine.
+// Every timed repetition is merged into one histogram per op.
+template<typename Engine>
+void runLatencySuite(Runner& runner, size_t n) {
+    const Options& options = runner.options();
+    const char* engine = EngineName<Engine>::value;
+    const std::string suite = options.rate > 0 ? "open_loop" : "latency";
+    KeySet keys(n, options.seed);
+
+    // Open loop runs at most about one second per repetition
+    size_t count = n;
+    if (options.rate > 0) count = std::min(n, std::max<size_t>(1, static_cast<size_t>(options.rate)));
+
+    Engine built;
+    for (int key : keys.present) built.insert(key);
+
+    auto measureOp = [&](const char* op, auto&& setup, auto&& run) {
+        if (!runner.reporter().selected(suite, engine, op)) return;
+        HdrHistogram histogram;
+        double achieved = 0;
+        for (int rep = -options.warmup; rep < options.repetitions; rep++) {
+            setup();
+            HdrHistogram pass;
+            achieved = driveLatency(pass, count, options.rate, run);
+            if (rep >= 0) histogram.merge(pass);
+        }
+
+        Result result;
+        result.suite = suite;
+        result.engine = engine;
+        result.op = op;
+        result.size = n;
+        if (options.rate > 0) result.extra.emplace_back("achieved_ops/s", achieved);
+        reportLatency(runner, std::move(result), histogram);
+    };
+
+    std::unique_ptr<Engine> scratch;
+    measureOp("insert",
+        [&] { scratch = std::make_unique<Engine>(); },
+        [&](size_t i) { scratch->insert(keys.present[i]); });
+
+    size_t found = 0;
+    measureOp("contains", [] {},
+        [&](size_t i) { found += built.contains(keys.probes[i]); });
+    doNotOptimize(found);
+
+    measureOp("erase",
+        [&] { scratch = std::make_unique<Engine>(built); },
+        [&](size_t i) { engineRemove(*scratch, keys.probes[i]); });
+}
+
+}
+
+#endif
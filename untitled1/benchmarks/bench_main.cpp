@@ -0,0 +1,178 @@
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include "bench.h"
+#include "bench_core.h"
+#include "bench_features.h"
+#include "bench_latency.h"
+#include "bench_workloads.h"
+
+namespace {
+
+void printUsage() {
+    std::cout << "Usage: benchmarks [options]\n"
+              << "  --format=text|csv|json   Output format (default text)\n"
+              << "  --out=FILE               Write results to FILE instead of stdout\n"
+              << "  --sizes=N,N,...          Element counts (default 1000,100000,1000000)\n"
+              << "  --reps=N                 Timed repetitions (default 5)\n"
+              << "  --warmup=N               Untimed warmup repetitions (default 1)\n"
+              << "  --chunk=N                Operations per timed sample (default 16)\n"
+              << "  --seed=N                 Random seed (default 20240601)\n"
+              << "  --filter=TEXT            Only suites, engines or ops containing TEXT\n"
+              << "  --trace=FILE             Also replay an operation trace (lines of \"i|l|e KEY\")\n"
+              << "  --counters=on|off        Hardware counters per op via perf_event_open (default on)\n"
+              << "  --rate=OPS               Latency suite in open loop at OPS requests/s (default closed loop)\n"
+              << "  --large                  Also run the kary suite at 10^8 and the veb suite at 10^8 and 10^9\n"
+              << "                           keys (needs about 5 GB and 12 GB of RAM)\n";
+}
+
+std::vector<size_t> parseSizes(const std::string& list) {
+    std::vector<size_t> sizes;
+    std::stringstream in(list);
+    std::string item;
+    while (std::getline(in, item, ',')) {
+        if (!item.empty()) sizes.push_back(std::stoull(item));
+    }
+    return sizes;
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    bench::Options options;
+    std::string outPath;
+
+    // std::stoi and friends throw on malformed or out-of-range numbers
+    try {
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            auto value = [&arg]() { return arg.substr(arg.find('=') + 1); };
+            if (arg.rfind("--format=", 0) == 0) options.format = value();
+            else if (arg.rfind("--out=", 0) == 0) outPath = value();
+            else if (arg.rfind("--sizes=", 0) == 0) options.sizes = parseSizes(value());
+            else if (arg.rfind("--reps=", 0) == 0) options.repetitions = std::stoi(value());
+            else if (arg.rfind("--warmup=", 0) == 0) options.warmup = std::stoi(value());
+            else if (arg.rfind("--chunk=", 0) == 0) options.chunk = std::stoull(value());
+            else if (arg.rfind("--seed=", 0) == 0) options.seed = std::stoull(value());
+            else if (arg.rfind("--filter=", 0) == 0) options.filter = value();
+            else if (arg.rfind("--trace=", 0) == 0) options.trace = value();
+            else if (arg.rfind("--rate=", 0) == 0) options.rate = std::stod(value());
+            else if (arg == "--counters=on" || arg == "--counters=off") options.counters = value() == "on";
+            else if (arg == "--large") options.large = true;
+            else {
+                printUsage();
+                return arg == "--help" ? 0 : 1;
+            }
+        }
+    } catch (const std::logic_error&) {
+        std::cerr << "Invalid option value\n";
+        printUsage();
+        return 1;
+    }
+    if (options.sizes.empty() || options.repetitions < 1 || options.rate < 0 ||
+        (options.format != "text" && options.format != "csv" && options.format != "json")) {
+        printUsage();
+        return 1;
+    }
+
+    std::ofstream file;
+    if (!outPath.empty()) {
+        file.open(outPath);
+        if (!file) {
+            std::cerr << "Cannot write " << outPath << "\n";
+            return 1;
+        }
+    }
+    bench::Reporter reporter(options, outPath.empty() ? std::cout : file);
+    bench::Runner runner(options, reporter);
+
+    try {
+        for (size_t n : options.sizes) {
+            bench::runCoreSuite<ds::BST<int>>(runner, n);
+            bench::runCoreSuite<ds::AVLTree<int>>(runner, n);
+            bench::runCoreSuite<std::set<int>>(runner, n);
+            bench::runCoreSuite<ds::BTree<int, 64>>(runner, n);
+            bench::runCoreSuite<ds::BTree<int, 256>>(runner, n);
+            bench::runCoreSuite<ds::BTree<int, 4096>>(runner, n);
+            bench::runCoreSuite<ds::Treap<int>>(runner, n);
+            bench::runCoreSuite<ds::WBTree<int>>(runner, n);
+        }
+        for (size_t n : options.sizes) {
+            bench::runWorkloadSuite<ds::BST<int>>(runner, n);
+            bench::runWorkloadSuite<ds::AVLTree<int>>(runner, n);
+            bench::runWorkloadSuite<std::set<int>>(runner, n);
+            bench::runWorkloadSuite<ds::BTree<int>>(runner, n);
+            bench::runWorkloadSuite<ds::SplayTree<int>>(runner, n);
+            bench::runWorkloadSuite<ds::Treap<int>>(runner, n);
+            bench::runWorkloadSuite<ds::WBTree<int>>(runner, n);
+            bench::runSplaySuite(runner, n);
+        }
+        for (size_t n : options.sizes) {
+            bench::runLatencySuite<ds::BST<int>>(runner, n);
+            bench::runLatencySuite<ds::AVLTree<int>>(runner, n);
+            bench::runLatencySuite<std::set<int>>(runner, n);
+            bench::runLatencySuite<ds::BTree<int>>(runner, n);
+            bench::runLatencySuite<ds::SplayTree<int>>(runner, n);
+            bench::runLatencySuite<ds::Treap<int>>(runner, n);
+            bench::runLatencySuite<ds::WBTree<int>>(runner, n);
+            bench::runLatencySuite<ds::AVLSet<int>>(runner, n);
+            bench::runLatencySuite<ds::RedBlackTree<int>>(runner, n);
+            bench::runLatencySuite<ds::WAVLTree<int>>(runner, n);
+            bench::runLatencySuite<ds::UnbalancedTree<int>>(runner, n);
+            bench::runLatencySuite<ds::SmallTree<int>>(runner, n);
+        }
+        for (size_t n : options.sizes) {
+            bench::runStructureStats<ds::BST<int, ds::TreeStats>>(runner, n);
+            bench::runStructureStats<ds::AVLTree<int, ds::TreeStats>>(runner, n);
+        }
+        for (size_t n : options.sizes) {
+            bench::runKarySearch(runner, n);
+            bench::runFrozen(runner, n);
+            bench::runVeb(runner, n);
+        }
+        if (options.large) {
+            // Only the array layouts fit at 10^9; the kary suite's AVLTree
+            // and BTree rows already take a few GB at 10^8
+            bench::runKarySearch(runner, 100000000);
+            bench::runVeb(runner, 100000000);
+            bench::runVeb(runner, 1000000000);
+        }
+        for (size_t n : options.sizes) {
+            bench::runBalanceSuite<ds::AVLBalance>(runner, n);
+            bench::runBalanceSuite<ds::RedBlackBalance>(runner, n);
+            bench::runBalanceSuite<ds::WAVLBalance>(runner, n);
+            bench::runBalanceSuite<ds::NoBalance>(runner, n);
+        }
+        if (!options.trace.empty()) {
+            auto ops = bench::workload::loadTrace(options.trace);
+            bench::runTrace<ds::BST<int>>(runner, ops, options.trace);
+            bench::runTrace<ds::AVLTree<int>>(runner, ops, options.trace);
+            bench::runTrace<std::set<int>>(runner, ops, options.trace);
+            bench::runTrace<ds::SplayTree<int>>(runner, ops, options.trace);
+        }
+
+        size_t largest = *std::max_element(options.sizes.begin(), options.sizes.end());
+        bench::runPagination(runner, largest);
+        bench::runSnapshot(runner, largest);
+        bench::runBulkOps(runner, largest);
+        bench::runPercentiles(runner, largest);
+        bench::runSmallSets(runner, largest);
+        bench::runContacts(runner, largest);
+        bench::runMultiset(runner, largest);
+        bench::runMapped(runner, largest);
+        bench::runGroupCommit(runner);
+        bench::runTickIngest(runner, largest);
+        bench::runStringMemory(runner, 5000000);
+        bench::runMemoryFootprint(runner, largest);
+    } catch (const std::exception& e) {
+        std::cerr << "Benchmark failed: " << e.what() << "\n";
+        return 1;
+    }
+
+    reporter.finish();
+    return 0;
+}
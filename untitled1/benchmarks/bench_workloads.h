@@ -0,0 +1,251 @@
+#ifndef BENCH_WORKLOADS_SUITE_H
+#define BENCH_WORKLOADS_SUITE_H
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "bench.h"
+#include "engines.h"
+#include "workloads.h"
+#include "../include/TreeStats.h"
+
+namespace bench {
+
+// Insert orders, skewed lookups and read/write mixes for one engine and size
+template<typename Engine>
+void runWorkloadSuite(Runner& runner, size_t n) {
+    const char* engine = EngineName<Engine>::value;
+    uint64_t seed = runner.options().seed ^ n;
+    auto result = [&](const std::string& op) {
+        Result r;
+        r.suite = "workload";
+        r.engine = engine;
+        r.op = op;
+        r.size = n;
+        return r;
+    };
+
+    std::unique_ptr<Engine> scratch;
+    auto insertAll = [&](const std::string& name, const std::vector<int>& keys) {
+        runner.measure(result("insert_" + name),
+            [&] { scratch = std::make_unique<Engine>(); },
+            [&](const Runner::SampleFn& sample) {
+                runner.timeChunked(sample, keys.size(), [&](size_t i) { scratch->insert(keys[i]); });
+            });
+    };
+    insertAll("ascending", workload::ascending(n));
+    insertAll("descending", workload::descending(n));
+    insertAll("sawtooth16", workload::sawtooth(n, 16));
+    insertAll("zigzag", workload::zigzag(n));
+    insertAll("fibonacci", workload::fibonacciTree(n));
+    insertAll("shuffled", workload::shuffled(n, seed));
+
+    // Lookups on a randomly built tree: uniform vs. hot-key skew
+    Engine built;
+    for (int key : workload::shuffled(n, seed + 1)) built.insert(key);
+    auto lookups = [&](const std::string& name, const std::vector<int>& keys) {
+        runner.measure(result(name), [] {},
+            [&](const Runner::SampleFn& sample) {
+                size_t found = 0;
+                runner.timeChunked(sample, keys.size(), [&](size_t i) { found += built.contains(keys[i]); });
+                doNotOptimize(found);
+            });
+    };
+    lookups("lookup_uniform", workload::shuffled(n, seed + 2));
+    lookups("lookup_zipf0.99", workload::zipfLookups(n, n, 0.99, seed + 3));
+
+    // Read/write mixes over a half-full key space of 2n keys
+    Engine half;
+    for (int key : workload::shuffled(2 * n, seed + 4)) {
+        if (key % 2 == 0) half.insert(key);
+    }
+    auto mix = [&](const std::string& name, const std::vector<Op>& ops) {
+        runner.measure(result(name),
+            [&] { scratch = std::make_unique<Engine>(half); },
+            [&](const Runner::SampleFn& sample) {
+                size_t changed = 0;
+                runner.timeChunked(sample, ops.size(), [&](size_t i) { changed += applyOp(*scratch, ops[i]); });
+                doNotOptimize(changed);
+            });
+    };
+    mix("mixed_90r_zipf", workload::mixed(n, 2 * n, 0.9, 0.99, seed + 5));
+    mix("mixed_50r_zipf", workload::mixed(n, 2 * n, 0.5, 0.99, seed + 6));
+    mix("mixed_50r_uniform", workload::mixed(n, 2 * n, 0.5, 0.0, seed + 7));
+}
+
+// Rotations, comparisons and path lengths per insert for each insert order,
+// from a TreeStats-instrumented tree. Counts only; times are not reported.
+template<typename Engine>
+void runStructureStats(Runner& runner, size_t n) {
+    const char* engine = EngineName<Engine>::value;
+    uint64_t seed = runner.options().seed ^ n;
+    auto row = [&](const std::string& name, const std::vector<int>& keys) {
+        if (!runner.reporter().selected("structure", engine, "insert_" + name)) return;
+        Engine tree;
+        for (int key : keys) tree.insert(key);
+        const ds::TreeStats& stats = tree.stats();
+        auto perOp = [&keys](uint64_t count) { return static_cast<double>(count) / static_cast<double>(keys.size()); };
+
+        Result r;
+        r.suite = "structure";
+        r.engine = engine;
+        r.op = "insert_" + name;
+        r.size = keys.size();
+        r.extra.emplace_back("single_rot/op", perOp(stats.singleRotations()));
+        r.extra.emplace_back("double_rot/op", perOp(stats.doubleRotations()));
+        r.extra.emplace_back("cmp/op", perOp(stats.comparisons));
+        r.extra.emplace_back("depth", stats.meanDepth());
+        r.extra.emplace_back("height_upd/op", perOp(stats.heightUpdates));
+        r.extra.emplace_back("retrace", perOp(stats.retraceSteps));
+        r.extra.emplace_back("max_retrace", static_cast<double>(stats.maxRetrace));
+        runner.reporter().add(r);
+    };
+    row("ascending", workload::ascending(n));
+    row("sawtooth16", workload::sawtooth(n, 16));
+    row("zigzag", workload::zigzag(n));
+    row("fibonacci", workload::fibonacciTree(n));
+    row("shuffled", workload::shuffled(n, seed));
+}
+
+// One BalancedTree core under each BalancePolicy: build time plus
+// insert-heavy, erase-heavy and lookup-heavy mixes over a half-full key
+// space of 2n keys. A second, untimed pass on a TreeStats tree adds the
+// rotations per op and the mean lookup depth each policy pays for its speed.
+template<typename Policy>
+void runBalanceSuite(Runner& runner, size_t n) {
+    using Tree = ds::BalancedTree<int, Policy>;
+    using Counted = ds::BalancedTree<int, Policy, ds::TreeStats>;
+    const char* engine = EngineName<Tree>::value;
+    uint64_t seed = runner.options().seed ^ n;
+    auto result = [&](const std::string& op) {
+        Result r;
+        r.suite = "balance";
+        r.engine = engine;
+        r.op = op;
+        r.size = n;
+        return r;
+    };
+    auto structure = [](Result& r, const Counted& counted, size_t ops) {
+        const ds::TreeStats& stats = counted.stats();
+        r.extra.emplace_back("rot/op", static_cast<double>(stats.singleRotations()) / static_cast<double>(ops));
+        r.extra.emplace_back("depth", stats.meanDepth());
+    };
+
+    std::vector<int> keys = workload::shuffled(2 * n, seed);
+    std::unique_ptr<Tree> scratch;
+    if (runner.reporter().selected("balance", engine, "insert_shuffled")) {
+        Result r = result("insert_shuffled");
+        Counted counted;
+        for (size_t i = 0; i < n; i++) counted.insert(keys[i]);
+        structure(r, counted, n);
+        runner.measure(r,
+            [&] { scratch = std::make_unique<Tree>(); },
+            [&](const Runner::SampleFn& sample) {
+                runner.timeChunked(sample, n, [&](size_t i) { scratch->insert(keys[i]); });
+            });
+    }
+
+    Tree half;
+    Counted countedHalf;
+    for (int key : keys) {
+        if (key % 2 != 0) continue;
+        half.insert(key);
+        countedHalf.insert(key);
+    }
+    auto mix = [&](const std::string& name, const std::vector<Op>& ops) {
+        if (!runner.reporter().selected("balance", engine, name)) return;
+        Result r = result(name);
+        Counted counted(countedHalf);
+        for (const Op& op : ops) applyOp(counted, op);
+        structure(r, counted, ops.size());
+        runner.measure(r,
+            [&] { scratch = std::make_unique<Tree>(half); },
+            [&](const Runner::SampleFn& sample) {
+                size_t changed = 0;
+                runner.timeChunked(sample, ops.size(), [&](size_t i) { changed += applyOp(*scratch, ops[i]); });
+                doNotOptimize(changed);
+            });
+    };
+    mix("insert_heavy", workload::weighted(n, 2 * n, 0.1, 0.8, 0.1, seed + 1));
+    mix("erase_heavy", workload::weighted(n, 2 * n, 0.1, 0.1, 0.8, seed + 2));
+    mix("lookup_heavy", workload::weighted(n, 2 * n, 0.9, 0.05, 0.05, seed + 3));
+}
+
+// SplayTree against AVLTree from the same balanced start (assignSorted):
+// uniform, Zipfian and hot-set lookups plus the 90%-read Zipfian mix, with
+// full splaying and with splaying on every 4th/16th lookup. An untimed
+// TreeStats pass adds rotations per op and the mean lookup depth.
+inline void runSplaySuite(Runner& runner, size_t n) {
+    uint64_t seed = runner.options().seed ^ n;
+    std::vector<int> sorted = workload::ascending(n);
+    auto lookups = [](const std::vector<int>& keys) {
+        std::vector<Op> ops(keys.size());
+        for (size_t i = 0; i < keys.size(); i++) ops[i] = Op{OpType::Lookup, keys[i]};
+        return ops;
+    };
+    const std::vector<std::pair<std::string, std::vector<Op>>> workloads = {
+        {"lookup_uniform", lookups(workload::shuffled(n, seed + 1))},
+        {"lookup_zipf0.99", lookups(workload::zipfLookups(n, n, 0.99, seed + 2))},
+        {"lookup_hot95/0.1%", lookups(workload::hotSetLookups(n, n, n / 1000, 0.95, seed + 3))},
+        {"mixed_90r_zipf", workload::mixed(n, n, 0.9, 0.99, seed + 4)},
+    };
+
+    auto variant = [&](const std::string& engine, auto make, auto makeCounted) {
+        using Tree = decltype(make());
+        for (const auto& [name, ops] : workloads) {
+            if (!runner.reporter().selected("splay", engine, name)) continue;
+            Result r;
+            r.suite = "splay";
+            r.engine = engine;
+            r.op = name;
+            r.size = n;
+
+            auto counted = makeCounted();
+            counted.assignSorted(sorted);
+            for (const Op& op : ops) applyOp(counted, op);
+            const ds::TreeStats& stats = counted.stats();
+            r.extra.emplace_back("rot/op", static_cast<double>(stats.singleRotations() + 2 * stats.doubleRotations()) /
+                                           static_cast<double>(ops.size()));
+            r.extra.emplace_back("depth", stats.meanDepth());
+
+            std::unique_ptr<Tree> tree;
+            runner.measure(r,
+                [&] {
+                    tree = std::make_unique<Tree>(make());
+                    tree->assignSorted(sorted);
+                },
+                [&](const Runner::SampleFn& sample) {
+                    size_t changed = 0;
+                    runner.timeChunked(sample, ops.size(), [&](size_t i) { changed += applyOp(*tree, ops[i]); });
+                    doNotOptimize(changed);
+                });
+        }
+    };
+    variant("AVLTree", [] { return ds::AVLTree<int>(); }, [] { return ds::AVLTree<int, ds::TreeStats>(); });
+    variant("Splay", [] { return ds::SplayTree<int>(); }, [] { return ds::SplayTree<int, ds::TreeStats>(); });
+    variant("Splay/every4", [] { return ds::SplayTree<int>(4); }, [] { return ds::SplayTree<int, ds::TreeStats>(4); });
+    variant("Splay/every16", [] { return ds::SplayTree<int>(16); }, [] { return ds::SplayTree<int, ds::TreeStats>(16); });
+}
+
+// Replays a recorded trace from an empty engine
+template<typename Engine>
+void runTrace(Runner& runner, const std::vector<Op>& ops, const std::string& name) {
+    Result r;
+    r.suite = "trace";
+    r.engine = EngineName<Engine>::value;
+    r.op = name;
+    r.size = ops.size();
+
+    std::unique_ptr<Engine> scratch;
+    runner.measure(r,
+        [&] { scratch = std::make_unique<Engine>(); },
+        [&](const Runner::SampleFn& sample) {
+            size_t changed = 0;
+            runner.timeChunked(sample, ops.size(), [&](size_t i) { changed += applyOp(*scratch, ops[i]); });
+            doNotOptimize(changed);
+        });
+}
+
+}
+
+#endif
@@ -0,0 +1,92 @@
+#ifndef BENCH_ENGINES_H
+#define BENCH_ENGINES_H
+
+#include <array>
+#include <set>
+#include "../include/AVL.h"
+#include "../include/BalancedTree.h"
+#include "../include/BST.h"
+#include "../include/BTree.h"
+#include "../include/SmallTree.h"
+#include "../include/Splay.h"
+#include "../include/Treap.h"
+#include "../include/WBTree.h"
+
+namespace bench {
+
+// Display name of each ordered-set engine under test
+template<typename Engine>
+struct EngineName;
+
+template<typename T, typename Stats>
+struct EngineName<ds::BST<T, Stats>> {
+    static constexpr const char* value = "BST";
+};
+
+template<typename T, typename Stats>
+struct EngineName<ds::AVLTree<T, Stats>> {
+    static constexpr const char* value = "AVLTree";
+};
+
+template<typename T, typename Stats>
+struct EngineName<ds::SplayTree<T, Stats>> {
+    static constexpr const char* value = "SplayTree";
+};
+
+template<typename T, typename Stats>
+struct EngineName<ds::Treap<T, Stats>> {
+    static constexpr const char* value = "Treap";
+};
+
+template<typename T, typename Stats>
+struct EngineName<ds::WBTree<T, Stats>> {
+    static constexpr const char* value = "WBTree";
+};
+
+// Named after the balancing policy: "AVL", "RedBlack", "WAVL", "Unbalanced"
+template<typename T, typename Policy, typename Stats>
+struct EngineName<ds::BalancedTree<T, Policy, Stats>> {
+    static constexpr const char* value = Policy::name;
+};
+
+// "BTree<256>": the node size is part of the name
+template<typename T, size_t NodeBytes>
+struct EngineName<ds::BTree<T, NodeBytes>> {
+    static constexpr auto text = [] {
+        std::array<char, 24> name{};
+        const char prefix[] = "BTree<";
+        size_t length = 0;
+        for (size_t i = 0; prefix[i]; i++) name[length++] = prefix[i];
+        char digits[20];
+        size_t count = 0;
+        for (size_t bytes = NodeBytes; bytes > 0 || count == 0; bytes /= 10) digits[count++] = static_cast<char>('0' + bytes % 10);
+        while (count > 0) name[length++] = digits[--count];
+        name[length] = '>';
+        return name;
+    }();
+    static constexpr const char* value = text.data();
+};
+
+template<typename T, size_t N>
+struct EngineName<ds::SmallTree<T, N>> {
+    static constexpr const char* value = "SmallTree";
+};
+
+template<typename T>
+struct EngineName<std::set<T>> {
+    static constexpr const char* value = "std::set";
+};
+
+// Uniform access to engines whose APIs differ slightly
+template<typename Engine, typename T>
+bool engineRemove(Engine& engine, const T& value) {
+    if constexpr (requires { engine.remove(value); }) {
+        return engine.remove(value);
+    } else {
+        return engine.erase(value) > 0;
+    }
+}
+
+}
+
+#endif
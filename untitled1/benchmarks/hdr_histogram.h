@@ -0,0 +1,114 @@
+#ifndef BENCH_HDR_HISTOGRAM_H
+#define BENCH_HDR_HISTOGRAM_H
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace bench {
+
+// High-dynamic-range histogram of nanosecond latencies, after Gil Tene's
+// HdrHistogram: values below 2048 get exact buckets, and every power-of-two
+// range above is split into 1024 linear buckets, so any recorded value is
+// kept to within 0.1% (three significant digits). Recording is an index
+// computation and an increment, cheap enough to run on every operation.
+class HdrHistogram {
+public:
+    // Values above highest are clamped into the top bucket (default ~18 min)
+    explicit HdrHistogram(uint64_t highest = uint64_t(1) << 40)
+        : highest_(highest), counts_(indexOf(highest) + 1, 0) {}
+
+    void record(uint64_t value) {
+        value = std::min(value, highest_);
+        counts_[indexOf(value)]++;
+        total_++;
+        min_ = std::min(min_, value);
+        max_ = std::max(max_, value);
+        sum_ += static_cast<double>(value);
+    }
+
+    void merge(const HdrHistogram& other) {
+        if (other.counts_.size() > counts_.size()) counts_.resize(other.counts_.size(), 0);
+        for (size_t i = 0; i < other.counts_.size(); i++) counts_[i] += other.counts_[i];
+        total_ += other.total_;
+        min_ = std::min(min_, other.min_);
+        max_ = std::max(max_, other.max_);
+        sum_ += other.sum_;
+        highest_ = std::max(highest_, other.highest_);
+    }
+
+    void reset() {
+        std::fill(counts_.begin(), counts_.end(), 0);
+        total_ = 0;
+        min_ = UINT64_MAX;
+        max_ = 0;
+        sum_ = 0;
+    }
+
+    uint64_t count() const { return total_; }
+    uint64_t min() const { return total_ ? min_ : 0; }
+    uint64_t max() const { return max_; }
+    double mean() const { return total_ ? sum_ / static_cast<double>(total_) : 0.0; }
+
+    // Smallest recorded value v such that `percentile`% of values are <= v,
+    // reported as the midpoint of v's bucket (exact max for 100)
+    uint64_t valueAtPercentile(double percentile) const {
+        if (total_ == 0) return 0;
+        if (percentile >= 100.0) return max_;
+        auto rank = static_cast<uint64_t>(percentile / 100.0 * static_cast<double>(total_) + 0.5);
+        rank = std::max<uint64_t>(1, rank);
+        uint64_t seen = 0;
+        for (size_t i = 0; i < counts_.size(); i++) {
+            seen += counts_[i];
+            if (seen >= rank) {
+                uint64_t low = lowestAt(i);
+                return std::min(max_, std::max(min_, low + (bucketWidth(i) >> 1)));
+            }
+        }
+        return max_;
+    }
+
+private:
+    static constexpr int SUB_BITS = 10;     // 1024 buckets per power of two
+
+    uint64_t highest_;
+    std::vector<uint64_t> counts_;
+    uint64_t total_{0};
+    uint64_t min_{UINT64_MAX};
+    uint64_t max_{0};
+    double sum_{0};
+
+    static int msb(uint64_t value) {
+        int bit = 0;
+        while (value >>= 1) bit++;
+        return bit;
+    }
+
+    // Bucket b covers [1024 << b, 2048 << b) with width 1 << b
+    static size_t indexOf(uint64_t value) {
+#if defined(__GNUC__) || defined(__clang__)
+        int top = value ? 63 - __builtin_clzll(value) : 0;
+#else
+        int top = msb(value);
+#endif
+        int b = std::max(0, top - SUB_BITS);
+        return (static_cast<size_t>(b) << SUB_BITS) + static_cast<size_t>(value >> b);
+    }
+
+    static int bucketOf(size_t index) {
+        return index < (size_t(2) << SUB_BITS) ? 0 : static_cast<int>(index >> SUB_BITS) - 1;
+    }
+
+    static uint64_t lowestAt(size_t index) {
+        int b = bucketOf(index);
+        return static_cast<uint64_t>(index - (static_cast<size_t>(b) << SUB_BITS)) << b;
+    }
+
+    static uint64_t bucketWidth(size_t index) {
+        return uint64_t(1) << bucketOf(index);
+    }
+};
+
+}
+
+#endif
@@ -0,0 +1,127 @@
+#ifndef BENCH_PERF_COUNTERS_H
+#define BENCH_PERF_COUNTERS_H
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace bench {
+
+// Hardware counters around benchmarked code, via Linux perf_event_open.
+// Each event is opened on its own (not as a group) so the kernel can
+// multiplex more events than the PMU has slots; totals are scaled by
+// enabled/running time. User-space only, which works under the default
+// perf_event_paranoid=2. Events the kernel or container refuses are left
+// out; available() is false when none could be opened (e.g. no PMU access
+// in a container, or not Linux), and the harness then reports time only.
+class PerfCounters {
+public:
+    struct Reading {
+        std::string name;
+        double value;
+    };
+
+    PerfCounters() {
+#if defined(__linux__)
+        add("cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+        add("instr", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+        add("L1d-miss", PERF_TYPE_HW_CACHE, cacheEvent(PERF_COUNT_HW_CACHE_L1D));
+        add("LLC-miss", PERF_TYPE_HW_CACHE, cacheEvent(PERF_COUNT_HW_CACHE_LL));
+        add("br-miss", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+        add("dTLB-miss", PERF_TYPE_HW_CACHE, cacheEvent(PERF_COUNT_HW_CACHE_DTLB));
+#endif
+    }
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    ~PerfCounters() {
+#if defined(__linux__)
+        for (const auto& event : events_) close(event.fd);
+#endif
+    }
+
+    bool available() const { return !events_.empty(); }
+
+    // Names of the events that could be opened
+    std::vector<std::string> names() const {
+        std::vector<std::string> result;
+        for (const auto& event : events_) result.push_back(event.name);
+        return result;
+    }
+
+    void reset() {
+#if defined(__linux__)
+        for (const auto& event : events_) ioctl(event.fd, PERF_EVENT_IOC_RESET, 0);
+#endif
+    }
+
+    void start() {
+#if defined(__linux__)
+        for (const auto& event : events_) ioctl(event.fd, PERF_EVENT_IOC_ENABLE, 0);
+#endif
+    }
+
+    void stop() {
+#if defined(__linux__)
+        for (const auto& event : events_) ioctl(event.fd, PERF_EVENT_IOC_DISABLE, 0);
+#endif
+    }
+
+    // Counts since reset(), scaled for multiplexing. An event that never got
+    // scheduled on the PMU is omitted rather than reported as zero.
+    std::vector<Reading> read() const {
+        std::vector<Reading> readings;
+#if defined(__linux__)
+        for (const auto& event : events_) {
+            uint64_t values[3] = {};   // value, time enabled, time running
+            if (::read(event.fd, values, sizeof(values)) != static_cast<ssize_t>(sizeof(values))) continue;
+            if (values[2] == 0) continue;
+            double scale = static_cast<double>(values[1]) / static_cast<double>(values[2]);
+            readings.push_back(Reading{event.name, static_cast<double>(values[0]) * scale});
+        }
+#endif
+        return readings;
+    }
+
+private:
+    struct Event {
+        std::string name;
+        int fd;
+    };
+
+    std::vector<Event> events_;
+
+#if defined(__linux__)
+    static uint64_t cacheEvent(uint64_t cache) {
+        return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    }
+
+    void add(const char* name, uint32_t type, uint64_t config) {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = type;
+        attr.config = config;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+        long fd = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+        if (fd >= 0) events_.push_back(Event{name, static_cast<int>(fd)});
+    }
+#endif
+};
+
+}
+
+#endif
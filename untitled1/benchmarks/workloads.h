@@ -0,0 +1,251 @@
+#ifndef BENCH_WORKLOADS_H
+#define BENCH_WORKLOADS_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <numeric>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "engines.h"
+
+namespace bench {
+
+enum class OpType : char { Insert = 'i', Lookup = 'l', Erase = 'e' };
+
+struct Op {
+    OpType type;
+    int key;
+};
+
+// Zipfian ranks in [0, n): rank 0 is the hottest, theta in (0, 1) sets the
+// skew (YCSB uses 0.99). Uses the constant-time method of Gray et al.
+// ("Quickly generating billion-record synthetic databases") after an O(n)
+// zeta precomputation.
+class ZipfGenerator {
+public:
+    ZipfGenerator(size_t n, double theta, uint64_t seed)
+        : n_(n), theta_(theta), gen_(seed), uniform_(0.0, 1.0) {
+        if (n == 0 || !(theta > 0.0 && theta < 1.0)) {
+            throw std::invalid_argument("Zipf needs n > 0 and 0 < theta < 1");
+        }
+        zetaN_ = zeta(n_, theta_);
+        double zeta2 = zeta(2, theta_);
+        alpha_ = 1.0 / (1.0 - theta_);
+        eta_ = (1.0 - std::pow(2.0 / static_cast<double>(n_), 1.0 - theta_)) / (1.0 - zeta2 / zetaN_);
+    }
+
+    size_t next() {
+        double u = uniform_(gen_);
+        double uz = u * zetaN_;
+        if (uz < 1.0) return 0;
+        if (uz < 1.0 + std::pow(0.5, theta_)) return std::min<size_t>(1, n_ - 1);
+        auto rank = static_cast<size_t>(static_cast<double>(n_) * std::pow(eta_ * u - eta_ + 1.0, alpha_));
+        return std::min(rank, n_ - 1);
+    }
+
+private:
+    size_t n_;
+    double theta_;
+    std::mt19937_64 gen_;
+    std::uniform_real_distribution<double> uniform_;
+    double zetaN_, alpha_, eta_;
+
+    static double zeta(size_t n, double theta) {
+        double sum = 0.0;
+        for (size_t i = 1; i <= n; i++) sum += 1.0 / std::pow(static_cast<double>(i), theta);
+        return sum;
+    }
+};
+
+namespace workload {
+
+// 0, 1, 2, ... n-1
+inline std::vector<int> ascending(size_t n) {
+    std::vector<int> keys(n);
+    std::iota(keys.begin(), keys.end(), 0);
+    return keys;
+}
+
+inline std::vector<int> descending(size_t n) {
+    std::vector<int> keys = ascending(n);
+    std::reverse(keys.begin(), keys.end());
+    return keys;
+}
+
+// Bursts of ascending keys: each of `teeth` runs climbs through the whole key
+// range, interleaved with the others (tooth t holds keys t, t + teeth, ...)
+inline std::vector<int> sawtooth(size_t n, size_t teeth) {
+    teeth = std::max<size_t>(1, teeth);
+    std::vector<int> keys;
+    keys.reserve(n);
+    for (size_t t = 0; t < teeth; t++) {
+        for (size_t k = t; k < n; k += teeth) keys.push_back(static_cast<int>(k));
+    }
+    return keys;
+}
+
+// Alternates between the two ends of the range (0, n-1, 1, n-2, ...), so each
+// insert lands on an inner edge and tends to need a double rotation
+inline std::vector<int> zigzag(size_t n) {
+    std::vector<int> keys;
+    keys.reserve(n);
+    for (size_t lo = 0, hi = n; lo < hi;) {
+        keys.push_back(static_cast<int>(lo++));
+        if (lo < hi) keys.push_back(static_cast<int>(--hi));
+    }
+    return keys;
+}
+
+// Level order of a Fibonacci tree (the sparsest legal AVL tree) holding at
+// least n keys, trimmed to the keys below n. Inserting it builds a tree of
+// near-maximal height, the worst case for AVL lookup depth.
+inline std::vector<int> fibonacciTree(size_t n) {
+    // Smallest height whose Fibonacci tree has at least n nodes
+    std::vector<size_t> nodes = {0, 1};
+    while (nodes.back() < n) nodes.push_back(nodes[nodes.size() - 1] + nodes[nodes.size() - 2] + 1);
+    int height = static_cast<int>(nodes.size()) - 1;
+
+    // Breadth-first over (height, first key) pairs; the left subtree has height-1
+    std::vector<int> keys;
+    std::vector<std::pair<int, size_t>> level = {{height, 0}}, next;
+    while (!level.empty()) {
+        next.clear();
+        for (auto [h, first] : level) {
+            if (h <= 0) continue;
+            size_t leftSize = nodes[h - 1];
+            size_t key = first + leftSize;
+            if (key < n) keys.push_back(static_cast<int>(key));
+            next.emplace_back(h - 1, first);
+            if (h >= 2) next.emplace_back(h - 2, key + 1);
+        }
+        level.swap(next);
+    }
+    return keys;
+}
+
+// Uniformly shuffled 0..n-1
+inline std::vector<int> shuffled(size_t n, uint64_t seed) {
+    std::vector<int> keys = ascending(n);
+    std::mt19937_64 gen(seed);
+    std::shuffle(keys.begin(), keys.end(), gen);
+    return keys;
+}
+
+// `count` lookups over keys 0..n-1 with Zipfian popularity. Hot ranks are
+// scattered over the key space so hot keys do not share tree paths.
+inline std::vector<int> zipfLookups(size_t n, size_t count, double theta, uint64_t seed) {
+    ZipfGenerator zipf(n, theta, seed);
+    std::vector<int> rankToKey = shuffled(n, seed + 1);
+    std::vector<int> keys(count);
+    for (int& key : keys) key = rankToKey[zipf.next()];
+    return keys;
+}
+
+// Lookups where hotShare of the accesses go to a random hot set of
+// hotKeys keys (e.g. 95% to 0.1% of them) and the rest are uniform
+inline std::vector<int> hotSetLookups(size_t n, size_t count, size_t hotKeys, double hotShare, uint64_t seed) {
+    std::vector<int> hot = shuffled(n, seed);
+    hot.resize(std::max<size_t>(1, std::min(hotKeys, n)));
+    std::mt19937_64 gen(seed + 1);
+    std::uniform_real_distribution<double> coin(0.0, 1.0);
+    std::uniform_int_distribution<size_t> pickHot(0, hot.size() - 1);
+    std::uniform_int_distribution<int> uniform(0, static_cast<int>(n) - 1);
+    std::vector<int> keys(count);
+    for (int& key : keys) key = coin(gen) < hotShare ? hot[pickHot(gen)] : uniform(gen);
+    return keys;
+}
+
+// Mixed operations over keys 0..keySpace-1: readFraction lookups, the rest
+// split evenly between inserts and erases. Keys follow a Zipfian
+// distribution when theta > 0, otherwise uniform.
+inline std::vector<Op> mixed(size_t count, size_t keySpace, double readFraction, double theta, uint64_t seed) {
+    std::mt19937_64 gen(seed);
+    std::uniform_real_distribution<double> coin(0.0, 1.0);
+    std::uniform_int_distribution<int> uniform(0, static_cast<int>(keySpace) - 1);
+    std::vector<int> keys = theta > 0 ? zipfLookups(keySpace, count, theta, seed + 2) : std::vector<int>();
+
+    std::vector<Op> ops(count);
+    for (size_t i = 0; i < count; i++) {
+        double roll = coin(gen);
+        OpType type = roll < readFraction ? OpType::Lookup
+                    : roll < readFraction + (1.0 - readFraction) / 2 ? OpType::Insert
+                    : OpType::Erase;
+        ops[i] = Op{type, theta > 0 ? keys[i] : uniform(gen)};
+    }
+    return ops;
+}
+
+// Operations over uniform keys 0..keySpace-1 in the given proportions of
+// lookups, inserts and erases (weights need not sum to one)
+inline std::vector<Op> weighted(size_t count, size_t keySpace, double lookups, double inserts, double erases, uint64_t seed) {
+    std::mt19937_64 gen(seed);
+    std::uniform_real_distribution<double> coin(0.0, lookups + inserts + erases);
+    std::uniform_int_distribution<int> uniform(0, static_cast<int>(keySpace) - 1);
+
+    std::vector<Op> ops(count);
+    for (size_t i = 0; i < count; i++) {
+        double roll = coin(gen);
+        OpType type = roll < lookups ? OpType::Lookup
+                    : roll < lookups + inserts ? OpType::Insert
+                    : OpType::Erase;
+        ops[i] = Op{type, uniform(gen)};
+    }
+    return ops;
+}
+
+// Traces are text files with one "<i|l|e> <key>" operation per line, e.g.
+// captured from production traffic; '#' starts a comment line
+inline std::vector<Op> loadTrace(const std::string& path) {
+    std::ifstream in(path);
+    if (!in) throw std::runtime_error("Cannot open trace " + path);
+
+    std::vector<Op> ops;
+    std::string line;
+    size_t lineNumber = 0;
+    while (std::getline(in, line)) {
+        lineNumber++;
+        if (line.empty() || line[0] == '#') continue;
+        std::istringstream fields(line);
+        char type;
+        long long key;
+        if (!(fields >> type >> key) || (type != 'i' && type != 'l' && type != 'e')) {
+            throw std::runtime_error("Bad trace line " + std::to_string(lineNumber) + " in " + path);
+        }
+        ops.push_back(Op{static_cast<OpType>(type), static_cast<int>(key)});
+    }
+    return ops;
+}
+
+inline void saveTrace(const std::string& path, const std::vector<Op>& ops) {
+    std::ofstream out(path);
+    for (const Op& op : ops) out << static_cast<char>(op.type) << ' ' << op.key << '\n';
+    if (!out) throw std::runtime_error("Cannot write trace " + path);
+}
+
+}
+
+// Applies one operation; returns whether a lookup hit or an update changed the set
+template<typename Engine>
+bool applyOp(Engine& engine, const Op& op) {
+    switch (op.type) {
+        case OpType::Insert: {
+            size_t before = engine.size();
+            engine.insert(op.key);
+            return engine.size() != before;
+        }
+        case OpType::Lookup:
+            return engine.contains(op.key);
+        case OpType::Erase:
+            return engineRemove(engine, op.key);
+    }
+    return false;
+}
+
+}
+
+#endif
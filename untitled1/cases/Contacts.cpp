@@ -1,38 +1,70 @@
-#include "../include/AVL.h"
+#include "../include/AVLMap.h"
+#include "../include/Durable.h"
 #include <string>
 #include <iostream>
 #include <iomanip>
 #include <vector>
 
-struct Contact {
-    std::string name;
+// Contact details, keyed by name in the ContactManager's map
+struct ContactInfo {
     std::string phone;
     std::string email;
     std::string address;
+};
+
+namespace ds {
 
-    // Sort by name ( User in Contact )
-    bool operator<(const Contact& other) const {
-        return name < other.name;
+// Written after the name key, which gives the same bytes the old Contact
+// set (ordered by name) wrote, so existing snapshots and logs still load
+template<>
+struct Serializer<ContactInfo> {
+    static void write(std::ostream& out, const ContactInfo& info) {
+        Serializer<std::string>::write(out, info.phone);
+        Serializer<std::string>::write(out, info.email);
+        Serializer<std::string>::write(out, info.address);
     }
 
-    bool operator>(const Contact& other) const {
-        return name > other.name;
+    static ContactInfo read(std::istream& in) {
+        ContactInfo info;
+        info.phone = Serializer<std::string>::read(in);
+        info.email = Serializer<std::string>::read(in);
+        info.address = Serializer<std::string>::read(in);
+        return info;
     }
 };
 
+}
+
 class ContactManager {
 private:
-    ds::AVLTree<Contact> contacts;
+    // Name -> details, persisted under dataDir: snapshot plus write-ahead log
+    ds::DurableAVLMap<std::string, ContactInfo> contacts;
 
 public:
+    explicit ContactManager(const std::string& dataDir) : contacts(dataDir) {}
+
     void addContact(const std::string& name,
                    const std::string& phone,
                    const std::string& email,
                    const std::string& address) {
-        contacts.insert(Contact{name, phone, email, address});
+        contacts.insert_or_assign(name, ContactInfo{phone, email, address});
         std::cout << "Contact added: " << name << "\n";
     }
 
+    bool removeContact(const std::string& name) {
+        return contacts.remove(name);
+    }
+
+    // Details for name, or nullptr if there is no such contact
+    const ContactInfo* findContact(const std::string& name) const {
+        return contacts.find(name);
+    }
+
+    // Makes every change so far durable
+    void save() {
+        contacts.sync();
+    }
+
     void displayContacts() const {
         std::cout << "\nContact List (Alphabetically):\n";
         std::cout << "-----------------------------\n";
@@ -43,23 +75,28 @@ public:
                   << "Address\n";
         std::cout << std::string(75, '-') << "\n";
 
-        contacts.inorder([](const Contact& contact) {
+        contacts.map().inorder([](const std::string& name, const ContactInfo& info) {
             std::cout << std::left
-                      << std::setw(20) << contact.name
-                      << std::setw(15) << contact.phone
-                      << std::setw(25) << contact.email
-                      << contact.address << "\n";
+                      << std::setw(20) << name
+                      << std::setw(15) << info.phone
+                      << std::setw(25) << info.email
+                      << info.address << "\n";
         });
     }
 
+    // One page of the alphabetical listing; pass page.next back for the next one
+    ds::Page<std::pair<std::string, ContactInfo>, std::string> listContacts(
+            const ds::PageToken<std::string>& from, size_t pageSize) const {
+        return contacts.map().page(from, pageSize);
+    }
+
     bool searchContact(const std::string& name) const {
-        Contact searchKey{name, "", "", ""};
-        return contacts.contains(searchKey);
+        return contacts.contains(name);
     }
 };
 
 int main() {
-    ContactManager manager;
+    ContactManager manager("contacts_data");
 
     // Adding sample contacts, with extra info
     manager.addContact("Diana", "176-820-2123", "Diana@email.com", "5 St Geogre");
@@ -71,13 +108,29 @@ int main() {
     // Display all contacts
     manager.displayContacts();
 
+    // Page through the listing two at a time
+    ds::PageToken<std::string> cursor;
+    int pageNumber = 1;
+    do {
+        auto page = manager.listContacts(cursor, 2);
+        std::cout << "\nPage " << pageNumber++ << ":";
+        for (const auto& [name, info] : page.items) {
+            std::cout << " " << name;
+        }
+        cursor = page.next;
+        if (!page.hasMore) break;
+    } while (true);
+    std::cout << "\n";
+
     // Search specific name
     std::string searchName = "Gavi";
-    if (manager.searchContact(searchName)) {
-        std::cout << "\nFound contact: " << searchName << "\n";
+    if (const ContactInfo* info = manager.findContact(searchName)) {
+        std::cout << "\nFound contact: " << searchName << " (" << info->phone << ")\n";
     } else {
         std::cout << "\nContact not found: " << searchName << "\n";
     }
 
+    manager.save();
+
     return 0;
 }
\ No newline at end of file
@@ -1,52 +1,28 @@
-#include "../include/AVL.h"
-#include <string>
-#include <iostream>
-#include <iomanip>
+#include "stock_market.h"
 
-struct StockPrice {
-    std::string symbol;
-    double price;
-
-    bool operator<(const StockPrice& other) const {
-        return price < other.price;
-    }
-
-    bool operator>(const StockPrice& other) const {
-        return price > other.price;
-    }
-};
-
-class StockMarket {
-private:
-    ds::AVLTree<StockPrice> priceTree;
-
-public:
-    void addStock(const std::string& symbol, double price) {
-        priceTree.insert(StockPrice{symbol, price});
-    }
-
-    void printPriceRange() const {
-        std::cout << "\nCurrent Stock Prices:\n";
-        std::cout << "--------------------\n";
-        priceTree.inorder([](const StockPrice& stock) {
-            std::cout << std::left << std::setw(10) << stock.symbol
-                     << "$ " << std::fixed << std::setprecision(2) << stock.price << "\n";
-        });
-    }
-};
-
-int main() {
+int main(int argc, char* argv[]) {
     StockMarket market;
 
+    // stocks <ticks.csv | -> ingests a tick file instead of the sample data
+    if (argc > 1) {
+        size_t ticks = market.ingest(argv[1]);
+        std::cout << "Ingested " << ticks << " ticks\n";
+        market.printPriceRange();
+        market.printPercentiles();
+        return 0;
+    }
 
     market.addStock("AAPL", 150.50);
     market.addStock("GOGL", 2800.75);
     market.addStock("MSFT", 290.25);
     market.addStock("AMZN", 3300.00);
     market.addStock("TSLA", 750.80);
+    market.addStock("NFLX", 290.25);
 
 
     market.printPriceRange();
+    market.printPercentiles();
+    std::cout << "\nStocks between $100 and $1000: " << market.countInRange(100.0, 1000.0) << "\n";
 
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,145 @@
+#ifndef STOCK_MARKET_H
+#define STOCK_MARKET_H
+
+#include "../include/Multiset.h"
+#include "../include/TickReader.h"
+#include <string>
+#include <string_view>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <optional>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+struct StockPrice {
+    std::string symbol;
+    double price;
+};
+
+// Current price of every listed symbol. A tick moves its symbol to the new
+// price, so percentiles and range counts only ever see current prices.
+class StockMarket {
+private:
+    // Price -> symbols listed at that price. Stocks sharing a price share a
+    // node, and subtree entry counts give O(log n) percentiles.
+    ds::AVLMultimap<double, std::string> priceTree;
+
+    // Where a symbol sits in priceTree: its price and its position in that
+    // price's bucket, so an update never searches a busy price level
+    struct Listing {
+        double price;
+        size_t slot;
+    };
+    std::unordered_map<std::string, Listing> listings;
+    std::vector<size_t> order;  // Scratch space for applyTicks
+    std::unordered_map<std::string_view, size_t> latest;  // Ditto
+
+    // Removes a listing; the last symbol at its price takes over its slot
+    void unlist(const Listing& listing) {
+        priceTree.removeAt(listing.price, listing.slot);
+        const auto* level = priceTree.find(listing.price);
+        if (level && listing.slot < level->size()) {
+            listings.find((*level)[listing.slot])->second.slot = listing.slot;
+        }
+    }
+
+public:
+    // Lists symbol at price, replacing its previous price if it has one;
+    // O(log n) however many symbols share either price. A NaN would compare
+    // equal to every price level, so non-finite prices are rejected.
+    void addStock(const std::string& symbol, double price) {
+        if (!std::isfinite(price)) throw std::invalid_argument("Price must be finite: " + symbol);
+        auto [it, added] = listings.try_emplace(symbol, Listing{price, 0});
+        if (!added) {
+            if (it->second.price == price) return;
+            unlist(it->second);
+            it->second.price = price;
+        }
+        it->second.slot = priceTree.insert(price, symbol);
+    }
+
+    // Applies one batch of ticks; only a symbol's last tick in the batch
+    // counts. Applying in price order keeps successive inserts on
+    // neighbouring tree paths, so they hit warm cache lines.
+    void applyTicks(const std::vector<ds::Tick>& batch) {
+        latest.clear();
+        for (size_t i = 0; i < batch.size(); i++) latest[batch[i].symbol] = i;
+        order.clear();
+        for (const auto& [symbol, i] : latest) order.push_back(i);
+        std::sort(order.begin(), order.end(), [&batch](size_t a, size_t b) {
+            return batch[a].price < batch[b].price;
+        });
+        for (size_t i : order) {
+            addStock(std::string(batch[i].symbol), batch[i].price);
+        }
+    }
+
+    // Streams symbol,price lines from a file ("-" for stdin)
+    size_t ingest(const std::string& path) {
+        ds::TickReader reader(path);
+        size_t ticks = reader.forEachBatch([this](const std::vector<ds::Tick>& batch) {
+            applyTicks(batch);
+        });
+        if (reader.skippedLines() > 0) {
+            std::cout << "Skipped " << reader.skippedLines() << " malformed lines\n";
+        }
+        return ticks;
+    }
+
+    // Number of listed symbols
+    size_t size() const { return listings.size(); }
+
+    std::optional<double> priceOf(const std::string& symbol) const {
+        auto it = listings.find(symbol);
+        if (it == listings.end()) return std::nullopt;
+        return it->second.price;
+    }
+
+    // Nearest-rank percentile (0 < pct <= 100) of the current prices
+    StockPrice percentile(double pct) const {
+        if (priceTree.empty()) throw std::out_of_range("No stocks listed");
+        double rank = std::ceil(pct / 100.0 * double(priceTree.size()));
+        auto it = priceTree.select(rank < 1.0 ? 0 : size_t(rank) - 1);
+        return StockPrice{it.value(), it.key()};
+    }
+
+    // Number of stocks priced in [low, high)
+    size_t countInRange(double low, double high) const {
+        return priceTree.countRange(low, high);
+    }
+
+    // Every listing in price order
+    template<typename Callback>
+    void forEachListing(Callback&& callback) const {
+        priceTree.scanInorder([&callback](double price, const std::string& symbol) {
+            callback(StockPrice{symbol, price});
+        });
+    }
+
+    void printPercentiles() const {
+        if (priceTree.empty()) return;
+        std::cout << "\nPrice Percentiles:\n";
+        std::cout << "------------------\n";
+        for (int pct : {10, 50, 90}) {
+            StockPrice stock = percentile(pct);
+            std::cout << "p" << std::left << std::setw(9) << pct
+                     << "$ " << std::fixed << std::setprecision(2) << stock.price
+                     << " (" << stock.symbol << ")\n";
+        }
+    }
+
+    void printPriceRange() const {
+        std::cout << "\nCurrent Stock Prices:\n";
+        std::cout << "--------------------\n";
+        forEachListing([](const StockPrice& stock) {
+            std::cout << std::left << std::setw(10) << stock.symbol
+                     << "$ " << std::fixed << std::setprecision(2) << stock.price << "\n";
+        });
+    }
+};
+
+#endif
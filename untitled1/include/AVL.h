@@ -1,14 +1,28 @@
-
 #ifndef AVL_H
 #define AVL_H
 
 #include <algorithm>
 #include <memory>
 #include <functional>
+#include <exception>
+#include <iterator>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <vector>
+#include "Cursor.h"
+#include "Frozen.h"
+#include "MemoryUsage.h"
+#include "Serialize.h"
+#include "TreeShape.h"
+#include "TreeStats.h"
 
 namespace ds {
 
-template<typename T>
+// Stats selects structural instrumentation (see TreeStats.h); the default
+// NoStats adds no code or state. With TreeStats even const lookups update
+// the counters, so an instrumented tree is not safe for concurrent reads.
+template<typename T, typename Stats = NoStats>
 class AVLTree {
 private:
     struct Node {
@@ -18,10 +32,22 @@ private:
         std::unique_ptr<Node> right;
 
         Node(const T& value) : data(value), height(1) {}
+        Node(T&& value) : data(std::move(value)), height(1) {}
     };
 
     std::unique_ptr<Node> root;
     size_t size_;
+    [[no_unique_address]] mutable Stats stats_;
+
+    bool lessThan(const T& a, const T& b) const {
+        stats_.compare();
+        return a < b;
+    }
+
+    bool greaterThan(const T& a, const T& b) const {
+        stats_.compare();
+        return a > b;
+    }
 
     int getHeight(const Node* node) const {
         return node ? node->height : 0;
@@ -33,6 +59,7 @@ private:
 
     void updateHeight(Node* node) {
         if (node) {
+            stats_.heightUpdate();
             node->height = 1 + std::max(getHeight(node->left.get()),
                                       getHeight(node->right.get()));
         }
@@ -67,25 +94,35 @@ private:
     std::unique_ptr<Node> balance(std::unique_ptr<Node> node) {
         if (!node) return nullptr;
 
+        int oldHeight = node->height;
         updateHeight(node.get());
         int balance = getBalance(node.get());
 
         // Left Heavy Situation
         if (balance > 1) {
+            stats_.retraceStep();
             if (getBalance(node->left.get()) < 0) {
+                stats_.rotate(Rotation::LeftRight);
                 node->left = leftRotate(std::move(node->left));
+            } else {
+                stats_.rotate(Rotation::Right);
             }
             return rightRotate(std::move(node));
         }
 
         // Right Heavy Situation
         if (balance < -1) {
+            stats_.retraceStep();
             if (getBalance(node->right.get()) > 0) {
+                stats_.rotate(Rotation::RightLeft);
                 node->right = rightRotate(std::move(node->right));
+            } else {
+                stats_.rotate(Rotation::Left);
             }
             return leftRotate(std::move(node));
         }
 
+        if (node->height != oldHeight) stats_.retraceStep();
         return std::move(node);
     }
 
@@ -95,9 +132,10 @@ private:
             return std::make_unique<Node>(value);
         }
 
-        if (value < node->data) {
+        stats_.visit();
+        if (lessThan(value, node->data)) {
             node->left = insert(std::move(node->left), value);
-        } else if (value > node->data) {
+        } else if (greaterThan(value, node->data)) {
             node->right = insert(std::move(node->right), value);
         } else {
             return node; // Duplicate value
@@ -106,42 +144,364 @@ private:
         return balance(std::move(node));
     }
 
+    std::unique_ptr<Node> remove(std::unique_ptr<Node> node, const T& value, bool& found) {
+        if (!node) return nullptr;
+
+        stats_.visit();
+        if (lessThan(value, node->data)) {
+            node->left = remove(std::move(node->left), value, found);
+        } else if (greaterThan(value, node->data)) {
+            node->right = remove(std::move(node->right), value, found);
+        } else {
+            found = true;
+            size_--;
+            if (!node->left) return std::move(node->right);
+            if (!node->right) return std::move(node->left);
+
+            // Two children: relink the in-order successor into this position
+            std::unique_ptr<Node> successor;
+            node->right = detachMin(std::move(node->right), successor);
+            successor->left = std::move(node->left);
+            successor->right = std::move(node->right);
+            return balance(std::move(successor));
+        }
+
+        return balance(std::move(node));
+    }
+
+    std::unique_ptr<Node> detachMin(std::unique_ptr<Node> node, std::unique_ptr<Node>& min) {
+        stats_.visit();
+        if (!node->left) {
+            auto right = std::move(node->right);
+            min = std::move(node);
+            return right;
+        }
+        node->left = detachMin(std::move(node->left), min);
+        return balance(std::move(node));
+    }
+
+    std::unique_ptr<Node> clone(const Node* node) const {
+        if (!node) return nullptr;
+        auto copy = std::make_unique<Node>(node->data);
+        copy->height = node->height;
+        copy->left = clone(node->left.get());
+        copy->right = clone(node->right.get());
+        return copy;
+    }
+
+    // Perfectly balanced subtree from keys[lo, hi); no comparisons needed
+    std::unique_ptr<Node> buildBalanced(std::vector<T>& keys, size_t lo, size_t hi) {
+        if (lo >= hi) return nullptr;
+        size_t mid = lo + (hi - lo) / 2;
+        auto node = std::make_unique<Node>(std::move(keys[mid]));
+        node->left = buildBalanced(keys, lo, mid);
+        node->right = buildBalanced(keys, mid + 1, hi);
+        updateHeight(node.get());
+        return node;
+    }
+
 public:
+    // Upper bound on AVL height for up to 2^64 nodes (1.44 * log2(n + 2)).
+    static constexpr size_t MAX_HEIGHT = 96;
+
+    // In-order iterator over an immutable view of the tree. Keeps a fixed
+    // MAX_HEIGHT stack of ancestors, so iterating never allocates.
+    class iterator {
+    private:
+        friend class AVLTree;
+
+        const Node* stack_[MAX_HEIGHT]{};
+        size_t depth_{0};
+
+        void pushLeft(const Node* node) {
+            while (node) {
+                stack_[depth_++] = node;
+                node = node->left.get();
+            }
+        }
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const T*;
+        using reference = const T&;
+
+        iterator() = default;
+
+        explicit iterator(const Node* root) {
+            pushLeft(root);
+        }
+
+        reference operator*() const { return stack_[depth_ - 1]->data; }
+        pointer operator->() const { return &stack_[depth_ - 1]->data; }
+
+        iterator& operator++() {
+            const Node* node = stack_[--depth_];
+            pushLeft(node->right.get());
+            return *this;
+        }
+
+        iterator operator++(int) {
+            iterator tmp = *this;
+            ++(*this);
+            return tmp;
+        }
+
+        bool operator==(const iterator& other) const {
+            if (depth_ == 0 || other.depth_ == 0) return depth_ == other.depth_;
+            return stack_[depth_ - 1] == other.stack_[other.depth_ - 1];
+        }
+
+        bool operator!=(const iterator& other) const {
+            return !(*this == other);
+        }
+    };
+
     AVLTree() : size_(0) {}
 
+    AVLTree(const AVLTree& other) : root(clone(other.root.get())), size_(other.size_) {}
+
+    AVLTree(AVLTree&& other) noexcept : root(std::move(other.root)), size_(other.size_) {
+        other.size_ = 0;
+    }
+
+    AVLTree& operator=(const AVLTree& other) {
+        if (this != &other) {
+            AVLTree temp(other);
+            std::swap(root, temp.root);
+            std::swap(size_, temp.size_);
+        }
+        return *this;
+    }
+
+    AVLTree& operator=(AVLTree&& other) noexcept {
+        if (this != &other) {
+            root = std::move(other.root);
+            size_ = other.size_;
+            other.size_ = 0;
+        }
+        return *this;
+    }
+
+    iterator begin() const { return iterator(root.get()); }
+    iterator end() const { return iterator(); }
+
     void insert(const T& value) {
+        stats_.beginPath();
         root = insert(std::move(root), value);
+        stats_.endPath();
     }
 
-    bool contains(const T& value) const {
+    bool remove(const T& value) {
+        bool found = false;
+        stats_.beginPath();
+        root = remove(std::move(root), value, found);
+        stats_.endPath();
+        return found;
+    }
+
+    void clear() {
+        root.reset();
+        size_ = 0;
+    }
+
+    // First element not less than value
+    iterator lower_bound(const T& value) const {
+        iterator it;
+        const Node* current = root.get();
+        while (current) {
+            if (current->data < value) {
+                current = current->right.get();
+            } else {
+                it.stack_[it.depth_++] = current;
+                current = current->left.get();
+            }
+        }
+        return it;
+    }
+
+    // First element greater than value
+    iterator upper_bound(const T& value) const {
+        iterator it;
         const Node* current = root.get();
         while (current) {
             if (value < current->data) {
+                it.stack_[it.depth_++] = current;
+                current = current->left.get();
+            } else {
+                current = current->right.get();
+            }
+        }
+        return it;
+    }
+
+    // Up to k elements following the token, in O(log n + k)
+    Page<T> page(const PageToken<T>& token, size_t k) const {
+        return collectPage(token.atStart() ? begin() : upper_bound(*token.last_), k, token);
+    }
+
+    // Up to k elements strictly after key
+    Page<T> pageAfter(const T& key, size_t k) const {
+        return collectPage(upper_bound(key), k, PageToken<T>(key));
+    }
+
+    bool contains(const T& value) const {
+        stats_.beginPath();
+        const Node* current = root.get();
+        while (current) {
+            stats_.visit();
+            if (lessThan(value, current->data)) {
                 current = current->left.get();
-            } else if (value > current->data) {
+            } else if (greaterThan(value, current->data)) {
                 current = current->right.get();
             } else {
-                return true;
+                break;
             }
         }
-        return false;
+        stats_.endPath();
+        return current != nullptr;
     }
 
     size_t size() const { return size_; }
     bool empty() const { return size_ == 0; }
 
+    // Stored height of the root; 0 when empty
+    int height() const { return getHeight(root.get()); }
+
+    // O(n) walk of the actual nodes: real height, depth and balance-factor
+    // distributions, and AVL/order/stored-height checks. Large trees are
+    // split across threads (threads == 0: one per core). Needs the tree to
+    // be free of concurrent writers, like scanInorder().
+    TreeShape diagnostics(unsigned threads = 0) const {
+        return shape::analyze(root.get(), size_, threads);
+    }
+
+    // Keys laid out by level for display (see shape::levels)
+    std::vector<std::vector<const T*>> levels(size_t maxLevels) const {
+        return shape::levels<T>(root.get(), maxLevels);
+    }
+
+    // Structural counters for insert, remove and contains (TreeStats only)
+    const Stats& stats() const { return stats_; }
+    void resetStats() { stats_.reset(); }
+
+    // One heap allocation per node; key heap bytes need a HeapSize<T> specialization
+    MemoryUsage memory_usage() const {
+        MemoryUsage usage = memory::nodeAllocations(size_, sizeof(Node));
+        if constexpr (HeapSize<T>::ownsHeap) {
+            scanInorder([&usage](const T& value) { usage.payloadHeapBytes += HeapSize<T>::of(value); });
+        }
+        return usage;
+    }
+
+    // Replaces the contents with keys that are already sorted and unique, O(n)
+    void assignSorted(std::vector<T> keys) {
+        root = buildBalanced(keys, 0, keys.size());
+        size_ = keys.size();
+    }
+
+    // Immutable copy for read-only use: FrozenTree (Eytzinger order) by
+    // default, or VebTree; thaw() converts back (see Frozen.h, Veb.h)
+    template<typename Frozen = FrozenTree<T>>
+    Frozen freeze() const {
+        return Frozen::of(*this);
+    }
+
+    // Binary snapshot (see Serialize.h); T needs a ds::Serializer
+    void save(std::ostream& out) const {
+        snapshot::writeHeader<T>(out, size_);
+        snapshot::KeyWriter<T> writer(out);
+        scanInorder(writer);
+        writer.finish();
+        if (!out) throw std::runtime_error("Failed to write snapshot");
+    }
+
+    // Rebuilds a balanced tree from a snapshot in O(n)
+    void load(std::istream& in) {
+        uint64_t count = snapshot::readHeader<T>(in);
+        assignSorted(snapshot::readKeys<T>(in, count));
+    }
+
     // Traversal with Callback Func
     void inorder(const std::function<void(const T&)>& callback) const {
-        inorderTraversal(root.get(), callback);
+        scanInorder(callback);
+    }
+
+    // Read-only traversal: no recursion, no heap, fixed MAX_HEIGHT stack.
+    // Never writes to the tree, so any number of threads may scan at once.
+    template<typename Callback>
+    void scanInorder(Callback&& callback) const {
+        const Node* stack[MAX_HEIGHT];
+        size_t depth = 0;
+        const Node* current = root.get();
+        while (current || depth > 0) {
+            while (current) {
+                stack[depth++] = current;
+                current = current->left.get();
+            }
+            current = stack[--depth];
+            callback(current->data);
+            current = current->right.get();
+        }
+    }
+
+    // Morris traversal: O(1) extra memory. Each in-order predecessor's empty
+    // right link temporarily borrows a pointer back to its successor; the
+    // borrowed pointer is released (never deleted) when the thread is removed.
+    // Requires exclusive access while running. A throwing callback stops the
+    // visits, but the walk finishes unthreading before rethrowing.
+    template<typename Callback>
+    void morrisInorder(Callback&& callback) {
+        std::exception_ptr error;
+        auto visit = [&](const T& value) {
+            if (error) return;
+            try {
+                callback(value);
+            } catch (...) {
+                error = std::current_exception();
+            }
+        };
+
+        Node* current = root.get();
+        while (current) {
+            if (!current->left) {
+                visit(current->data);
+                current = current->right.get();
+                continue;
+            }
+
+            Node* pred = current->left.get();
+            while (pred->right && pred->right.get() != current) {
+                pred = pred->right.get();
+            }
+
+            if (!pred->right) {
+                pred->right.reset(current);   // Borrowed thread, not owned
+                current = current->left.get();
+            } else {
+                pred->right.release();        // Drop thread without deleting
+                visit(current->data);
+                current = current->right.get();
+            }
+        }
+
+        if (error) std::rethrow_exception(error);
     }
 
 private:
-    void inorderTraversal(const Node* node, const std::function<void(const T&)>& callback) const {
-        if (node) {
-            inorderTraversal(node->left.get(), callback);
-            callback(node->data);
-            inorderTraversal(node->right.get(), callback);
+    Page<T> collectPage(iterator it, size_t k, const PageToken<T>& from) const {
+        Page<T> result;
+        result.next = from;
+        result.items.reserve(std::min(k, size()));  // k may be far larger, even SIZE_MAX
+        for (iterator last = end(); it != last && result.items.size() < k; ++it) {
+            result.items.push_back(*it);
+        }
+        if (!result.items.empty()) {
+            result.next = PageToken<T>(result.items.back());
         }
+        result.hasMore = it != end();
+        return result;
     }
 };
 
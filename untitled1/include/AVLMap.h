@@ -0,0 +1,539 @@
+#ifndef AVLMAP_H
+#define AVLMAP_H
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <istream>
+#include <iterator>
+#include <memory>
+#include <ostream>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "Cursor.h"
+#include "MemoryUsage.h"
+#include "Serialize.h"
+#include "TreeStats.h"
+
+namespace ds {
+
+// Ordered map on the AVL core: nodes are ordered by K alone, so records
+// no longer have to be their own keys (with an operator< that ignores
+// most of the fields). Each node starts with the key, height and child
+// links, which is all a lookup reads; the value comes after them. Values
+// larger than INLINE_VALUE_BYTES get an allocation of their own instead,
+// so a node stays about one cache line and the nodes a search walks
+// through pack densely. Rotations and removes relink nodes, so neither
+// keys nor values are ever moved or copied once inserted, and references
+// from find() stay valid until that key is removed.
+template<typename K, typename V, typename Stats = NoStats>
+class AVLMap {
+public:
+    static constexpr size_t INLINE_VALUE_BYTES = 32;
+    static constexpr bool INLINE_VALUES = sizeof(V) <= INLINE_VALUE_BYTES;
+
+private:
+    using ValueSlot = std::conditional_t<INLINE_VALUES, V, std::unique_ptr<V>>;
+
+    struct Node {
+        K key;
+        int height{1};
+        std::unique_ptr<Node> left;
+        std::unique_ptr<Node> right;
+        ValueSlot value;
+
+        template<typename Key, typename... Args>
+        explicit Node(Key&& k, Args&&... args)
+            : key(std::forward<Key>(k)), value(makeSlot(std::forward<Args>(args)...)) {}
+    };
+
+    std::unique_ptr<Node> root;
+    size_t size_{0};
+    [[no_unique_address]] mutable Stats stats_;
+
+    template<typename... Args>
+    static ValueSlot makeSlot(Args&&... args) {
+        if constexpr (INLINE_VALUES) {
+            return V(std::forward<Args>(args)...);
+        } else {
+            return std::make_unique<V>(std::forward<Args>(args)...);
+        }
+    }
+
+    static V& valueOf(Node& node) {
+        if constexpr (INLINE_VALUES) {
+            return node.value;
+        } else {
+            return *node.value;
+        }
+    }
+
+    static const V& valueOf(const Node& node) {
+        if constexpr (INLINE_VALUES) {
+            return node.value;
+        } else {
+            return *node.value;
+        }
+    }
+
+    bool lessThan(const K& a, const K& b) const {
+        stats_.compare();
+        return a < b;
+    }
+
+    int getHeight(const Node* node) const {
+        return node ? node->height : 0;
+    }
+
+    int getBalance(const Node* node) const {
+        return node ? getHeight(node->left.get()) - getHeight(node->right.get()) : 0;
+    }
+
+    void updateHeight(Node* node) {
+        if (node) {
+            stats_.heightUpdate();
+            node->height = 1 + std::max(getHeight(node->left.get()), getHeight(node->right.get()));
+        }
+    }
+
+    std::unique_ptr<Node> rightRotate(std::unique_ptr<Node> y) {
+        auto x = std::move(y->left);
+        y->left = std::move(x->right);
+        updateHeight(y.get());
+        x->right = std::move(y);
+        updateHeight(x.get());
+        return x;
+    }
+
+    std::unique_ptr<Node> leftRotate(std::unique_ptr<Node> x) {
+        auto y = std::move(x->right);
+        x->right = std::move(y->left);
+        updateHeight(x.get());
+        y->left = std::move(x);
+        updateHeight(y.get());
+        return y;
+    }
+
+    std::unique_ptr<Node> balance(std::unique_ptr<Node> node) {
+        int oldHeight = node->height;
+        updateHeight(node.get());
+        int balance = getBalance(node.get());
+
+        if (balance > 1) {
+            stats_.retraceStep();
+            if (getBalance(node->left.get()) < 0) {
+                stats_.rotate(Rotation::LeftRight);
+                node->left = leftRotate(std::move(node->left));
+            } else {
+                stats_.rotate(Rotation::Right);
+            }
+            return rightRotate(std::move(node));
+        }
+
+        if (balance < -1) {
+            stats_.retraceStep();
+            if (getBalance(node->right.get()) > 0) {
+                stats_.rotate(Rotation::RightLeft);
+                node->right = rightRotate(std::move(node->right));
+            } else {
+                stats_.rotate(Rotation::Left);
+            }
+            return leftRotate(std::move(node));
+        }
+
+        if (node->height != oldHeight) stats_.retraceStep();
+        return node;
+    }
+
+    // Finds key or inserts it with a value built from args; hit is the
+    // key's node either way
+    template<typename Key, typename... Args>
+    std::unique_ptr<Node> emplace(std::unique_ptr<Node> node, Key&& key, Node*& hit, Args&&... args) {
+        if (!node) {
+            size_++;
+            node = std::make_unique<Node>(std::forward<Key>(key), std::forward<Args>(args)...);
+            hit = node.get();
+            return node;
+        }
+
+        stats_.visit();
+        if (lessThan(key, node->key)) {
+            node->left = emplace(std::move(node->left), std::forward<Key>(key), hit, std::forward<Args>(args)...);
+        } else if (lessThan(node->key, key)) {
+            node->right = emplace(std::move(node->right), std::forward<Key>(key), hit, std::forward<Args>(args)...);
+        } else {
+            hit = node.get();
+            return node;
+        }
+
+        return balance(std::move(node));
+    }
+
+    std::unique_ptr<Node> remove(std::unique_ptr<Node> node, const K& key, bool& found) {
+        if (!node) return nullptr;
+
+        stats_.visit();
+        if (lessThan(key, node->key)) {
+            node->left = remove(std::move(node->left), key, found);
+        } else if (lessThan(node->key, key)) {
+            node->right = remove(std::move(node->right), key, found);
+        } else {
+            found = true;
+            size_--;
+            if (!node->left) return std::move(node->right);
+            if (!node->right) return std::move(node->left);
+
+            // Two children: relink the in-order successor into this position
+            std::unique_ptr<Node> successor;
+            node->right = detachMin(std::move(node->right), successor);
+            successor->left = std::move(node->left);
+            successor->right = std::move(node->right);
+            return balance(std::move(successor));
+        }
+
+        return balance(std::move(node));
+    }
+
+    std::unique_ptr<Node> detachMin(std::unique_ptr<Node> node, std::unique_ptr<Node>& min) {
+        stats_.visit();
+        if (!node->left) {
+            auto right = std::move(node->right);
+            min = std::move(node);
+            return right;
+        }
+        node->left = detachMin(std::move(node->left), min);
+        return balance(std::move(node));
+    }
+
+    Node* findNode(const K& key) const {
+        stats_.beginPath();
+        Node* current = root.get();
+        while (current) {
+            stats_.visit();
+            if (lessThan(key, current->key)) {
+                current = current->left.get();
+            } else if (lessThan(current->key, key)) {
+                current = current->right.get();
+            } else {
+                break;
+            }
+        }
+        stats_.endPath();
+        return current;
+    }
+
+    std::unique_ptr<Node> clone(const Node* node) const {
+        if (!node) return nullptr;
+        auto copy = std::make_unique<Node>(node->key, valueOf(*node));
+        copy->height = node->height;
+        copy->left = clone(node->left.get());
+        copy->right = clone(node->right.get());
+        return copy;
+    }
+
+    // Perfectly balanced subtree from entries[lo, hi); no comparisons needed
+    std::unique_ptr<Node> buildBalanced(std::vector<std::pair<K, V>>& entries, size_t lo, size_t hi) {
+        if (lo >= hi) return nullptr;
+        size_t mid = lo + (hi - lo) / 2;
+        auto node = std::make_unique<Node>(std::move(entries[mid].first), std::move(entries[mid].second));
+        node->left = buildBalanced(entries, lo, mid);
+        node->right = buildBalanced(entries, mid + 1, hi);
+        updateHeight(node.get());
+        return node;
+    }
+
+public:
+    // Upper bound on AVL height for up to 2^64 nodes (1.44 * log2(n + 2)).
+    static constexpr size_t MAX_HEIGHT = 96;
+
+    // In-order iterator over an immutable view of the map; *it is a pair
+    // of references to the key and value. Keeps a fixed MAX_HEIGHT stack of
+    // ancestors, so iterating never allocates.
+    class iterator {
+    private:
+        friend class AVLMap;
+
+        const Node* stack_[MAX_HEIGHT]{};
+        size_t depth_{0};
+
+        void pushLeft(const Node* node) {
+            while (node) {
+                stack_[depth_++] = node;
+                node = node->left.get();
+            }
+        }
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = std::pair<const K&, const V&>;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = std::pair<const K&, const V&>;
+
+        iterator() = default;
+
+        explicit iterator(const Node* root) {
+            pushLeft(root);
+        }
+
+        const K& key() const { return stack_[depth_ - 1]->key; }
+        const V& value() const { return valueOf(*stack_[depth_ - 1]); }
+
+        reference operator*() const { return {key(), value()}; }
+
+        iterator& operator++() {
+            const Node* node = stack_[--depth_];
+            pushLeft(node->right.get());
+            return *this;
+        }
+
+        iterator operator++(int) {
+            iterator tmp = *this;
+            ++(*this);
+            return tmp;
+        }
+
+        bool operator==(const iterator& other) const {
+            if (depth_ == 0 || other.depth_ == 0) return depth_ == other.depth_;
+            return stack_[depth_ - 1] == other.stack_[other.depth_ - 1];
+        }
+
+        bool operator!=(const iterator& other) const {
+            return !(*this == other);
+        }
+    };
+
+    AVLMap() = default;
+
+    AVLMap(const AVLMap& other) : root(clone(other.root.get())), size_(other.size_) {}
+
+    AVLMap(AVLMap&& other) noexcept : root(std::move(other.root)), size_(other.size_) {
+        other.size_ = 0;
+    }
+
+    AVLMap& operator=(const AVLMap& other) {
+        if (this != &other) {
+            AVLMap temp(other);
+            std::swap(root, temp.root);
+            std::swap(size_, temp.size_);
+        }
+        return *this;
+    }
+
+    AVLMap& operator=(AVLMap&& other) noexcept {
+        if (this != &other) {
+            root = std::move(other.root);
+            size_ = other.size_;
+            other.size_ = 0;
+        }
+        return *this;
+    }
+
+    iterator begin() const { return iterator(root.get()); }
+    iterator end() const { return iterator(); }
+
+    // Value for key, or nullptr when absent
+    V* find(const K& key) {
+        Node* node = findNode(key);
+        return node ? &valueOf(*node) : nullptr;
+    }
+
+    const V* find(const K& key) const {
+        const Node* node = findNode(key);
+        return node ? &valueOf(*node) : nullptr;
+    }
+
+    V& at(const K& key) {
+        if (V* value = find(key)) return *value;
+        throw std::out_of_range("Key not found");
+    }
+
+    const V& at(const K& key) const {
+        if (const V* value = find(key)) return *value;
+        throw std::out_of_range("Key not found");
+    }
+
+    bool contains(const K& key) const {
+        return findNode(key) != nullptr;
+    }
+
+    // Value for key, value-initialized first if the key is new
+    V& operator[](const K& key) {
+        return *try_emplace(key).first;
+    }
+
+    // Inserts key with V(args...) unless it is present, in which case
+    // nothing is constructed. Returns the key's value and whether it was
+    // inserted.
+    template<typename... Args>
+    std::pair<V*, bool> try_emplace(const K& key, Args&&... args) {
+        Node* hit = nullptr;
+        size_t before = size_;
+        stats_.beginPath();
+        root = emplace(std::move(root), key, hit, std::forward<Args>(args)...);
+        stats_.endPath();
+        return {&valueOf(*hit), size_ != before};
+    }
+
+    // Inserts key or overwrites its value; true if the key was new
+    template<typename Value>
+    std::pair<V*, bool> insert_or_assign(const K& key, Value&& value) {
+        auto result = try_emplace(key, std::forward<Value>(value));
+        if (!result.second) *result.first = std::forward<Value>(value);
+        return result;
+    }
+
+    bool remove(const K& key) {
+        bool found = false;
+        stats_.beginPath();
+        root = remove(std::move(root), key, found);
+        stats_.endPath();
+        return found;
+    }
+
+    void clear() {
+        root.reset();
+        size_ = 0;
+    }
+
+    // First entry whose key is not less than key
+    iterator lower_bound(const K& key) const {
+        iterator it;
+        const Node* current = root.get();
+        while (current) {
+            if (current->key < key) {
+                current = current->right.get();
+            } else {
+                it.stack_[it.depth_++] = current;
+                current = current->left.get();
+            }
+        }
+        return it;
+    }
+
+    // First entry whose key is greater than key
+    iterator upper_bound(const K& key) const {
+        iterator it;
+        const Node* current = root.get();
+        while (current) {
+            if (key < current->key) {
+                it.stack_[it.depth_++] = current;
+                current = current->left.get();
+            } else {
+                current = current->right.get();
+            }
+        }
+        return it;
+    }
+
+    // Up to k entries following the token, in O(log n + k)
+    Page<std::pair<K, V>, K> page(const PageToken<K>& token, size_t k) const {
+        return collectPage(token.atStart() ? begin() : upper_bound(*token.last_), k, token);
+    }
+
+    // Up to k entries with keys strictly after key
+    Page<std::pair<K, V>, K> pageAfter(const K& key, size_t k) const {
+        return collectPage(upper_bound(key), k, PageToken<K>(key));
+    }
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    // Stored height of the root; 0 when empty
+    int height() const { return getHeight(root.get()); }
+
+    // Structural counters for inserts, removes and lookups (TreeStats only)
+    const Stats& stats() const { return stats_; }
+    void resetStats() { stats_.reset(); }
+
+    // One allocation per node, plus one per value when values are out of
+    // line; heap owned by keys and values needs HeapSize specializations
+    MemoryUsage memory_usage() const {
+        MemoryUsage usage = memory::nodeAllocations(size_, sizeof(Node));
+        if constexpr (!INLINE_VALUES) {
+            MemoryUsage values = memory::nodeAllocations(size_, sizeof(V));
+            usage.nodeBytes += values.nodeBytes;
+            usage.allocatorOverhead += values.allocatorOverhead;
+        }
+        if constexpr (HeapSize<K>::ownsHeap || HeapSize<V>::ownsHeap) {
+            scanInorder([&usage](const K& key, const V& value) {
+                usage.payloadHeapBytes += HeapSize<K>::of(key) + HeapSize<V>::of(value);
+            });
+        }
+        return usage;
+    }
+
+    // Replaces the contents with entries already sorted by unique key, O(n)
+    void assignSorted(std::vector<std::pair<K, V>> entries) {
+        root = buildBalanced(entries, 0, entries.size());
+        size_ = entries.size();
+    }
+
+    // Binary snapshot (see Serialize.h): the set header for K, then each
+    // key followed by its value; K and V need a ds::Serializer
+    void save(std::ostream& out) const {
+        snapshot::writeHeader<K>(out, size_);
+        scanInorder([&out](const K& key, const V& value) {
+            Serializer<K>::write(out, key);
+            Serializer<V>::write(out, value);
+        });
+        if (!out) throw std::runtime_error("Failed to write snapshot");
+    }
+
+    // Rebuilds a balanced map from a snapshot in O(n)
+    void load(std::istream& in) {
+        uint64_t count = snapshot::readHeader<K>(in);
+        std::vector<std::pair<K, V>> entries;
+        entries.reserve(std::min(count, snapshot::READ_CHUNK));
+        for (uint64_t i = 0; i < count && in; i++) {
+            K key = Serializer<K>::read(in);
+            if (in && !entries.empty()) snapshot::requireOrder(entries.back().first, key);
+            entries.emplace_back(std::move(key), Serializer<V>::read(in));
+        }
+        if (!in) throw std::runtime_error("Truncated snapshot");
+        assignSorted(std::move(entries));
+    }
+
+    // Traversal with Callback Func
+    void inorder(const std::function<void(const K&, const V&)>& callback) const {
+        scanInorder(callback);
+    }
+
+    // Read-only traversal: no recursion, no heap, fixed MAX_HEIGHT stack
+    template<typename Callback>
+    void scanInorder(Callback&& callback) const {
+        const Node* stack[MAX_HEIGHT];
+        size_t depth = 0;
+        const Node* current = root.get();
+        while (current || depth > 0) {
+            while (current) {
+                stack[depth++] = current;
+                current = current->left.get();
+            }
+            current = stack[--depth];
+            callback(current->key, valueOf(*current));
+            current = current->right.get();
+        }
+    }
+
+private:
+    Page<std::pair<K, V>, K> collectPage(iterator it, size_t k, const PageToken<K>& from) const {
+        Page<std::pair<K, V>, K> result;
+        result.next = from;
+        result.items.reserve(std::min(k, size()));  // k may be far larger, even SIZE_MAX
+        for (iterator last = end(); it != last && result.items.size() < k; ++it) {
+            result.items.emplace_back(it.key(), it.value());
+        }
+        if (!result.items.empty()) {
+            result.next = PageToken<K>(result.items.back().first);
+        }
+        result.hasMore = it != end();
+        return result;
+    }
+};
+
+}
+
+#endif
@@ -2,15 +2,27 @@
 #define BST_HPP
 
 #include <memory>
-#include <stack>
 #include <queue>
 #include <functional>
 #include <stdexcept>
 #include <algorithm>
+#include <exception>
+#include <istream>
+#include <ostream>
+#include <vector>
+#include "Cursor.h"
+#include "Frozen.h"
+#include "MemoryUsage.h"
+#include "Serialize.h"
+#include "TreeShape.h"
+#include "TreeStats.h"
 
 namespace ds {
 
-template<typename T>
+// Stats selects structural instrumentation (see TreeStats.h); the default
+// NoStats adds no code or state. With TreeStats even const lookups update
+// the counters, so an instrumented tree is not safe for concurrent reads.
+template<typename T, typename Stats = NoStats>
 class BST {
 private:
     struct Node {
@@ -26,17 +38,25 @@ private:
     using NodePtr = std::shared_ptr<Node>;
     NodePtr root_;
     size_t size_{0};
+    [[no_unique_address]] mutable Stats stats_;
 
 public:
+    // Upper bound on the height of an AVL-balanced tree with up to 2^64 nodes
+    // (1.44 * log2(n + 2)); fixed-size traversal stacks never need more.
+    static constexpr size_t MAX_HEIGHT = 96;
+
     class iterator {
     private:
-        std::stack<NodePtr> stack_;
-        NodePtr current_;
+        friend class BST;
+
+        Node* stack_[MAX_HEIGHT]{};
+        size_t depth_{0};
+        Node* current_{nullptr};
 
-        void pushLeft(NodePtr node) {
+        void pushLeft(Node* node) {
             while (node) {
-                stack_.push(node);
-                node = node->left;
+                stack_[depth_++] = node;
+                node = node->left.get();
             }
         }
 
@@ -49,10 +69,10 @@ public:
 
         iterator() = default;
 
-        explicit iterator(NodePtr root) {
-            pushLeft(root);
-            if (!stack_.empty()) {
-                current_ = stack_.top();
+        explicit iterator(const NodePtr& root) {
+            pushLeft(root.get());
+            if (depth_ > 0) {
+                current_ = stack_[depth_ - 1];
             }
         }
 
@@ -60,15 +80,14 @@ public:
         pointer operator->() { return &current_->data; }
 
         iterator& operator++() {
-            if (stack_.empty()) {
+            if (depth_ == 0) {
                 current_ = nullptr;
                 return *this;
             }
 
-            NodePtr node = stack_.top();
-            stack_.pop();
-            pushLeft(node->right);
-            current_ = stack_.empty() ? nullptr : stack_.top();
+            Node* node = stack_[--depth_];
+            pushLeft(node->right.get());
+            current_ = depth_ == 0 ? nullptr : stack_[depth_ - 1];
             return *this;
         }
 
@@ -79,8 +98,7 @@ public:
         }
 
         bool operator==(const iterator& other) const {
-            return (stack_.empty() && other.stack_.empty()) ||
-                   (!stack_.empty() && !other.stack_.empty() && stack_.top() == other.stack_.top());
+            return current_ == other.current_;
         }
 
         bool operator!=(const iterator& other) const {
@@ -129,18 +147,54 @@ public:
     size_t size() const noexcept { return size_; }
     bool empty() const noexcept { return size_ == 0; }
 
+    // Stored height of the root; 0 when empty
+    int height() const noexcept { return getHeight(root_); }
+
+    // O(n) walk of the actual nodes: real height, depth and balance-factor
+    // distributions, and AVL/order/stored-height checks. Large trees are
+    // split across threads (threads == 0: one per core). Needs the tree to
+    // be free of concurrent writers, like scanInorder().
+    TreeShape diagnostics(unsigned threads = 0) const {
+        return shape::analyze(root_.get(), size_, threads);
+    }
+
+    // Keys laid out by level for display (see shape::levels)
+    std::vector<std::vector<const T*>> levels(size_t maxLevels) const {
+        return shape::levels<T>(root_.get(), maxLevels);
+    }
+
+    // Structural counters for insert, remove and contains (TreeStats only)
+    const Stats& stats() const noexcept { return stats_; }
+    void resetStats() noexcept { stats_.reset(); }
+
+    // Nodes come from make_shared, so each allocation also holds a control
+    // block; key heap bytes need a HeapSize<T> specialization
+    MemoryUsage memory_usage() const {
+        MemoryUsage usage = memory::nodeAllocations(size_, memory::sharedAllocationBytes<Node>());
+        if constexpr (HeapSize<T>::ownsHeap) {
+            scanInorder([&usage](const T& value) { usage.payloadHeapBytes += HeapSize<T>::of(value); });
+        }
+        return usage;
+    }
+
     // Modifiers
     void insert(const T& value) {
+        stats_.beginPath();
         root_ = insertImpl(root_, value);
+        stats_.endPath();
     }
 
     void insert(T&& value) {
+        stats_.beginPath();
         root_ = insertImpl(root_, std::move(value));
+        stats_.endPath();
     }
 
     bool remove(const T& value) {
         bool found = false;
+        stats_.beginPath();
         root_ = removeImpl(root_, value, found);
+        stats_.endPath();
         return found;
     }
 
@@ -149,14 +203,87 @@ public:
         size_ = 0;
     }
 
+    // Replaces the contents with keys that are already sorted and unique, O(n)
+    void assignSorted(std::vector<T> keys) {
+        root_ = buildBalanced(keys, 0, keys.size());
+        size_ = keys.size();
+    }
+
+    // Immutable copy for read-only use: FrozenTree (Eytzinger order) by
+    // default, or VebTree; thaw() converts back (see Frozen.h, Veb.h)
+    template<typename Frozen = FrozenTree<T>>
+    Frozen freeze() const {
+        return Frozen::of(*this);
+    }
+
+    // Binary snapshot (see Serialize.h); T needs a ds::Serializer
+    void save(std::ostream& out) const {
+        snapshot::writeHeader<T>(out, size_);
+        snapshot::KeyWriter<T> writer(out);
+        scanInorder(writer);
+        writer.finish();
+        if (!out) throw std::runtime_error("Failed to write snapshot");
+    }
+
+    // Rebuilds a balanced tree from a snapshot in O(n)
+    void load(std::istream& in) {
+        uint64_t count = snapshot::readHeader<T>(in);
+        assignSorted(snapshot::readKeys<T>(in, count));
+    }
+
     // Lookup
     bool contains(const T& value) const noexcept {
+        stats_.beginPath();
         auto current = root_;
         while (current) {
-            if (value == current->data) return true;
-            current = (value < current->data) ? current->left : current->right;
+            stats_.visit();
+            if (equalTo(value, current->data)) break;
+            current = lessThan(value, current->data) ? current->left : current->right;
         }
-        return false;
+        stats_.endPath();
+        return current != nullptr;
+    }
+
+    // First element not less than value
+    iterator lower_bound(const T& value) noexcept {
+        iterator it;
+        Node* current = root_.get();
+        while (current) {
+            if (current->data < value) {
+                current = current->right.get();
+            } else {
+                it.stack_[it.depth_++] = current;
+                current = current->left.get();
+            }
+        }
+        it.current_ = it.depth_ == 0 ? nullptr : it.stack_[it.depth_ - 1];
+        return it;
+    }
+
+    // First element greater than value
+    iterator upper_bound(const T& value) noexcept {
+        iterator it;
+        Node* current = root_.get();
+        while (current) {
+            if (value < current->data) {
+                it.stack_[it.depth_++] = current;
+                current = current->left.get();
+            } else {
+                current = current->right.get();
+            }
+        }
+        it.current_ = it.depth_ == 0 ? nullptr : it.stack_[it.depth_ - 1];
+        return it;
+    }
+
+    // Up to k elements following the token, in O(log n + k)
+    Page<T> page(const PageToken<T>& token, size_t k) const {
+        return collectPage(token.atStart() ? nullptr : &*token.last_, k, token);
+    }
+
+    // Up to k elements strictly after key
+    Page<T> pageAfter(const T& key, size_t k) const {
+        return collectPage(&key, k, PageToken<T>(key));
     }
 
     const T& min() const {
@@ -173,7 +300,69 @@ public:
 
     // Traversal methods
     void inorder(const std::function<void(const T&)>& func) const {
-        inorderImpl(root_, func);
+        scanInorder(func);
+    }
+
+    // Read-only in-order scan without recursion or heap allocation. Uses a
+    // fixed MAX_HEIGHT stack of raw pointers, so concurrent readers are safe
+    // and no shared_ptr reference counts are touched.
+    template<typename Func>
+    void scanInorder(Func&& func) const {
+        const Node* stack[MAX_HEIGHT];
+        size_t depth = 0;
+        const Node* current = root_.get();
+        while (current || depth > 0) {
+            while (current) {
+                stack[depth++] = current;
+                current = current->left.get();
+            }
+            current = stack[--depth];
+            func(current->data);
+            current = current->right.get();
+        }
+    }
+
+    // Morris in-order traversal: O(1) extra memory, no allocations. The tree
+    // is temporarily threaded through right links, so it needs exclusive
+    // access; use scanInorder() when other threads may be reading. If func
+    // throws, the walk still completes to remove every thread before the
+    // exception is rethrown.
+    template<typename Func>
+    void morrisInorder(Func&& func) {
+        std::exception_ptr error;
+        auto visit = [&](const T& value) {
+            if (error) return;
+            try {
+                func(value);
+            } catch (...) {
+                error = std::current_exception();
+            }
+        };
+
+        NodePtr current = root_;
+        while (current) {
+            if (!current->left) {
+                visit(current->data);
+                current = current->right;
+                continue;
+            }
+
+            Node* pred = current->left.get();
+            while (pred->right && pred->right != current) {
+                pred = pred->right.get();
+            }
+
+            if (!pred->right) {
+                pred->right = current;       // Thread back to the successor
+                current = current->left;
+            } else {
+                pred->right.reset();         // Remove the thread
+                visit(current->data);
+                current = current->right;
+            }
+        }
+
+        if (error) std::rethrow_exception(error);
     }
 
     void preorder(const std::function<void(const T&)>& func) const {
@@ -208,12 +397,71 @@ private:
         return newNode;
     }
 
+    Page<T> collectPage(const T* after, size_t k, const PageToken<T>& from) const {
+        Page<T> result;
+        result.next = from;
+        result.items.reserve(std::min(k, size()));  // k may be far larger, even SIZE_MAX
+
+        // Seek: the stack holds the ancestors still to be visited
+        const Node* stack[MAX_HEIGHT];
+        size_t depth = 0;
+        const Node* current = root_.get();
+        while (current) {
+            if (!after || *after < current->data) {
+                stack[depth++] = current;
+                current = current->left.get();
+            } else {
+                current = current->right.get();
+            }
+        }
+
+        while (depth > 0 && result.items.size() < k) {
+            current = stack[--depth];
+            result.items.push_back(current->data);
+            for (current = current->right.get(); current; current = current->left.get()) {
+                stack[depth++] = current;
+            }
+        }
+
+        if (!result.items.empty()) {
+            result.next = PageToken<T>(result.items.back());
+        }
+        result.hasMore = depth > 0;
+        return result;
+    }
+
+    NodePtr buildBalanced(std::vector<T>& keys, size_t lo, size_t hi) {
+        if (lo >= hi) return nullptr;
+        size_t mid = lo + (hi - lo) / 2;
+        NodePtr node = std::make_shared<Node>(std::move(keys[mid]));
+        node->left = buildBalanced(keys, lo, mid);
+        node->right = buildBalanced(keys, mid + 1, hi);
+        updateHeight(node);
+        return node;
+    }
+
+    bool lessThan(const T& a, const T& b) const {
+        stats_.compare();
+        return a < b;
+    }
+
+    bool greaterThan(const T& a, const T& b) const {
+        stats_.compare();
+        return a > b;
+    }
+
+    bool equalTo(const T& a, const T& b) const {
+        stats_.compare();
+        return a == b;
+    }
+
     int getHeight(const NodePtr& node) const noexcept {
         return node ? node->height : 0;
     }
 
     void updateHeight(NodePtr& node) noexcept {
         if (node) {
+            stats_.heightUpdate();
             node->height = 1 + std::max(getHeight(node->left), getHeight(node->right));
         }
     }
@@ -251,25 +499,35 @@ private:
     NodePtr balance(NodePtr& node) {
         if (!node) return nullptr;
 
+        int oldHeight = node->height;
         updateHeight(node);
         int balance = balanceFactor(node);
 
         // Left Heavy
         if (balance > 1) {
+            stats_.retraceStep();
             if (balanceFactor(node->left) < 0) {
+                stats_.rotate(Rotation::LeftRight);
                 node->left = rotateLeft(node->left);
+            } else {
+                stats_.rotate(Rotation::Right);
             }
             return rotateRight(node);
         }
 
         // Right Heavy
         if (balance < -1) {
+            stats_.retraceStep();
             if (balanceFactor(node->right) > 0) {
+                stats_.rotate(Rotation::RightLeft);
                 node->right = rotateRight(node->right);
+            } else {
+                stats_.rotate(Rotation::Left);
             }
             return rotateLeft(node);
         }
 
+        if (node->height != oldHeight) stats_.retraceStep();
         return node;
     }
 
@@ -279,9 +537,10 @@ private:
             return std::make_shared<Node>(std::move(value));
         }
 
-        if (value < node->data) {
+        stats_.visit();
+        if (lessThan(value, node->data)) {
             node->left = insertImpl(node->left, std::move(value));
-        } else if (value > node->data) {
+        } else if (greaterThan(value, node->data)) {
             node->right = insertImpl(node->right, std::move(value));
         }
 
@@ -296,10 +555,11 @@ private:
     NodePtr removeImpl(NodePtr& node, const T& value, bool& found) {
         if (!node) return nullptr;
 
-        if (value < node->data) {
+        stats_.visit();
+        if (lessThan(value, node->data)) {
             node->left = removeImpl(node->left, value, found);
         }
-        else if (value > node->data) {
+        else if (greaterThan(value, node->data)) {
             node->right = removeImpl(node->right, value, found);
         }
         else {
@@ -331,13 +591,6 @@ private:
         return balance(node);
     }
 
-    void inorderImpl(const NodePtr& node, const std::function<void(const T&)>& func) const {
-        if (!node) return;
-        inorderImpl(node->left, func);
-        func(node->data);
-        inorderImpl(node->right, func);
-    }
-
     void preorderImpl(const NodePtr& node, const std::function<void(const T&)>& func) const {
         if (!node) return;
         func(node->data);
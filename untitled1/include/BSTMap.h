@@ -0,0 +1,587 @@
+#ifndef BSTMAP_H
+#define BSTMAP_H
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <istream>
+#include <iterator>
+#include <memory>
+#include <ostream>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "Cursor.h"
+#include "MemoryUsage.h"
+#include "Serialize.h"
+#include "TreeStats.h"
+
+namespace ds {
+
+// BST's ordered-map counterpart (see AVLMap.h): shared_ptr nodes ordered
+// by K alone, with the key and links first and the value after them, or
+// out of line when larger than INLINE_VALUE_BYTES. Like BST, iterators
+// give mutable access; values can be changed in place, keys cannot. A
+// removed node with two children is replaced by relinking its successor,
+// so no entry is ever copied.
+template<typename K, typename V, typename Stats = NoStats>
+class BSTMap {
+public:
+    static constexpr size_t INLINE_VALUE_BYTES = 32;
+    static constexpr bool INLINE_VALUES = sizeof(V) <= INLINE_VALUE_BYTES;
+
+private:
+    using ValueSlot = std::conditional_t<INLINE_VALUES, V, std::unique_ptr<V>>;
+
+    struct Node {
+        K key;
+        std::shared_ptr<Node> left;
+        std::shared_ptr<Node> right;
+        int height{1};
+        ValueSlot value;
+
+        template<typename Key, typename... Args>
+        explicit Node(Key&& k, Args&&... args)
+            : key(std::forward<Key>(k)), value(makeSlot(std::forward<Args>(args)...)) {}
+    };
+
+    using NodePtr = std::shared_ptr<Node>;
+    NodePtr root_;
+    size_t size_{0};
+    [[no_unique_address]] mutable Stats stats_;
+
+    template<typename... Args>
+    static ValueSlot makeSlot(Args&&... args) {
+        if constexpr (INLINE_VALUES) {
+            return V(std::forward<Args>(args)...);
+        } else {
+            return std::make_unique<V>(std::forward<Args>(args)...);
+        }
+    }
+
+    static V& valueOf(Node& node) noexcept {
+        if constexpr (INLINE_VALUES) {
+            return node.value;
+        } else {
+            return *node.value;
+        }
+    }
+
+    static const V& valueOf(const Node& node) noexcept {
+        if constexpr (INLINE_VALUES) {
+            return node.value;
+        } else {
+            return *node.value;
+        }
+    }
+
+public:
+    // Upper bound on the height of an AVL-balanced tree with up to 2^64 nodes
+    // (1.44 * log2(n + 2)); fixed-size traversal stacks never need more.
+    static constexpr size_t MAX_HEIGHT = 96;
+
+    // In-order iterator; key() is read-only, value() may be modified
+    class iterator {
+    private:
+        friend class BSTMap;
+
+        Node* stack_[MAX_HEIGHT]{};
+        size_t depth_{0};
+        Node* current_{nullptr};
+
+        void pushLeft(Node* node) {
+            while (node) {
+                stack_[depth_++] = node;
+                node = node->left.get();
+            }
+        }
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = std::pair<const K&, V&>;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = std::pair<const K&, V&>;
+
+        iterator() = default;
+
+        explicit iterator(const NodePtr& root) {
+            pushLeft(root.get());
+            if (depth_ > 0) {
+                current_ = stack_[depth_ - 1];
+            }
+        }
+
+        const K& key() const { return current_->key; }
+        V& value() const { return valueOf(*current_); }
+
+        reference operator*() const { return {key(), value()}; }
+
+        iterator& operator++() {
+            if (depth_ == 0) {
+                current_ = nullptr;
+                return *this;
+            }
+
+            Node* node = stack_[--depth_];
+            pushLeft(node->right.get());
+            current_ = depth_ == 0 ? nullptr : stack_[depth_ - 1];
+            return *this;
+        }
+
+        iterator operator++(int) {
+            iterator tmp = *this;
+            ++(*this);
+            return tmp;
+        }
+
+        bool operator==(const iterator& other) const {
+            return current_ == other.current_;
+        }
+
+        bool operator!=(const iterator& other) const {
+            return !(*this == other);
+        }
+    };
+
+    // Constructors and assignment operators
+    BSTMap() noexcept = default;
+
+    BSTMap(const BSTMap& other) {
+        root_ = clone(other.root_);
+        size_ = other.size_;
+    }
+
+    BSTMap(BSTMap&& other) noexcept
+        : root_(std::move(other.root_)), size_(other.size_) {
+        other.size_ = 0;
+    }
+
+    BSTMap& operator=(const BSTMap& other) {
+        if (this != &other) {
+            BSTMap temp(other);
+            std::swap(root_, temp.root_);
+            std::swap(size_, temp.size_);
+        }
+        return *this;
+    }
+
+    BSTMap& operator=(BSTMap&& other) noexcept {
+        if (this != &other) {
+            root_ = std::move(other.root_);
+            size_ = other.size_;
+            other.size_ = 0;
+        }
+        return *this;
+    }
+
+    ~BSTMap() = default;
+
+    // Iterator methods
+    iterator begin() noexcept { return iterator(root_); }
+    iterator end() noexcept { return iterator(); }
+
+    // Capacity
+    size_t size() const noexcept { return size_; }
+    bool empty() const noexcept { return size_ == 0; }
+
+    // Stored height of the root; 0 when empty
+    int height() const noexcept { return getHeight(root_); }
+
+    // Structural counters for inserts, removes and lookups (TreeStats only)
+    const Stats& stats() const noexcept { return stats_; }
+    void resetStats() noexcept { stats_.reset(); }
+
+    // Nodes come from make_shared, so each allocation also holds a control
+    // block; out-of-line values are one more allocation each
+    MemoryUsage memory_usage() const {
+        MemoryUsage usage = memory::nodeAllocations(size_, memory::sharedAllocationBytes<Node>());
+        if constexpr (!INLINE_VALUES) {
+            MemoryUsage values = memory::nodeAllocations(size_, sizeof(V));
+            usage.nodeBytes += values.nodeBytes;
+            usage.allocatorOverhead += values.allocatorOverhead;
+        }
+        if constexpr (HeapSize<K>::ownsHeap || HeapSize<V>::ownsHeap) {
+            scanInorder([&usage](const K& key, const V& value) {
+                usage.payloadHeapBytes += HeapSize<K>::of(key) + HeapSize<V>::of(value);
+            });
+        }
+        return usage;
+    }
+
+    // Modifiers
+
+    // Inserts key with V(args...) unless it is present, in which case
+    // nothing is constructed. Returns the key's value and whether it was
+    // inserted.
+    template<typename... Args>
+    std::pair<V*, bool> try_emplace(const K& key, Args&&... args) {
+        Node* hit = nullptr;
+        size_t before = size_;
+        stats_.beginPath();
+        root_ = insertImpl(root_, key, hit, std::forward<Args>(args)...);
+        stats_.endPath();
+        return {&valueOf(*hit), size_ != before};
+    }
+
+    // Inserts key or overwrites its value; true if the key was new
+    template<typename Value>
+    std::pair<V*, bool> insert_or_assign(const K& key, Value&& value) {
+        auto result = try_emplace(key, std::forward<Value>(value));
+        if (!result.second) *result.first = std::forward<Value>(value);
+        return result;
+    }
+
+    // Value for key, value-initialized first if the key is new
+    V& operator[](const K& key) {
+        return *try_emplace(key).first;
+    }
+
+    bool remove(const K& key) {
+        bool found = false;
+        stats_.beginPath();
+        root_ = removeImpl(root_, key, found);
+        stats_.endPath();
+        return found;
+    }
+
+    void clear() noexcept {
+        root_.reset();
+        size_ = 0;
+    }
+
+    // Replaces the contents with entries already sorted by unique key, O(n)
+    void assignSorted(std::vector<std::pair<K, V>> entries) {
+        root_ = buildBalanced(entries, 0, entries.size());
+        size_ = entries.size();
+    }
+
+    // Binary snapshot in AVLMap's format; K and V need a ds::Serializer
+    void save(std::ostream& out) const {
+        snapshot::writeHeader<K>(out, size_);
+        scanInorder([&out](const K& key, const V& value) {
+            Serializer<K>::write(out, key);
+            Serializer<V>::write(out, value);
+        });
+        if (!out) throw std::runtime_error("Failed to write snapshot");
+    }
+
+    // Rebuilds a balanced map from a snapshot in O(n)
+    void load(std::istream& in) {
+        uint64_t count = snapshot::readHeader<K>(in);
+        std::vector<std::pair<K, V>> entries;
+        entries.reserve(std::min(count, snapshot::READ_CHUNK));
+        for (uint64_t i = 0; i < count && in; i++) {
+            K key = Serializer<K>::read(in);
+            if (in && !entries.empty()) snapshot::requireOrder(entries.back().first, key);
+            entries.emplace_back(std::move(key), Serializer<V>::read(in));
+        }
+        if (!in) throw std::runtime_error("Truncated snapshot");
+        assignSorted(std::move(entries));
+    }
+
+    // Lookup
+
+    // Value for key, or nullptr when absent
+    V* find(const K& key) noexcept {
+        Node* node = findNode(key);
+        return node ? &valueOf(*node) : nullptr;
+    }
+
+    const V* find(const K& key) const noexcept {
+        Node* node = findNode(key);
+        return node ? &valueOf(*node) : nullptr;
+    }
+
+    V& at(const K& key) {
+        if (V* value = find(key)) return *value;
+        throw std::out_of_range("Key not found");
+    }
+
+    const V& at(const K& key) const {
+        if (const V* value = find(key)) return *value;
+        throw std::out_of_range("Key not found");
+    }
+
+    bool contains(const K& key) const noexcept {
+        return findNode(key) != nullptr;
+    }
+
+    // First entry whose key is not less than key
+    iterator lower_bound(const K& key) noexcept {
+        iterator it;
+        Node* current = root_.get();
+        while (current) {
+            if (current->key < key) {
+                current = current->right.get();
+            } else {
+                it.stack_[it.depth_++] = current;
+                current = current->left.get();
+            }
+        }
+        it.current_ = it.depth_ == 0 ? nullptr : it.stack_[it.depth_ - 1];
+        return it;
+    }
+
+    // First entry whose key is greater than key
+    iterator upper_bound(const K& key) noexcept {
+        iterator it;
+        Node* current = root_.get();
+        while (current) {
+            if (key < current->key) {
+                it.stack_[it.depth_++] = current;
+                current = current->left.get();
+            } else {
+                current = current->right.get();
+            }
+        }
+        it.current_ = it.depth_ == 0 ? nullptr : it.stack_[it.depth_ - 1];
+        return it;
+    }
+
+    // Up to k entries following the token, in O(log n + k)
+    Page<std::pair<K, V>, K> page(const PageToken<K>& token, size_t k) const {
+        return collectPage(token.atStart() ? nullptr : &*token.last_, k, token);
+    }
+
+    // Up to k entries with keys strictly after key
+    Page<std::pair<K, V>, K> pageAfter(const K& key, size_t k) const {
+        return collectPage(&key, k, PageToken<K>(key));
+    }
+
+    // Traversal methods
+    void inorder(const std::function<void(const K&, const V&)>& func) const {
+        scanInorder(func);
+    }
+
+    // Read-only in-order scan without recursion or heap allocation; no
+    // shared_ptr reference counts are touched
+    template<typename Func>
+    void scanInorder(Func&& func) const {
+        const Node* stack[MAX_HEIGHT];
+        size_t depth = 0;
+        const Node* current = root_.get();
+        while (current || depth > 0) {
+            while (current) {
+                stack[depth++] = current;
+                current = current->left.get();
+            }
+            current = stack[--depth];
+            func(current->key, valueOf(*current));
+            current = current->right.get();
+        }
+    }
+
+private:
+    // Helper methods
+    NodePtr clone(const NodePtr& node) const {
+        if (!node) return nullptr;
+        NodePtr newNode = std::make_shared<Node>(node->key, valueOf(*node));
+        newNode->left = clone(node->left);
+        newNode->right = clone(node->right);
+        newNode->height = node->height;
+        return newNode;
+    }
+
+    Page<std::pair<K, V>, K> collectPage(const K* after, size_t k, const PageToken<K>& from) const {
+        Page<std::pair<K, V>, K> result;
+        result.next = from;
+        result.items.reserve(std::min(k, size()));  // k may be far larger, even SIZE_MAX
+
+        // Seek: the stack holds the ancestors still to be visited
+        const Node* stack[MAX_HEIGHT];
+        size_t depth = 0;
+        const Node* current = root_.get();
+        while (current) {
+            if (!after || *after < current->key) {
+                stack[depth++] = current;
+                current = current->left.get();
+            } else {
+                current = current->right.get();
+            }
+        }
+
+        while (depth > 0 && result.items.size() < k) {
+            current = stack[--depth];
+            result.items.emplace_back(current->key, valueOf(*current));
+            for (current = current->right.get(); current; current = current->left.get()) {
+                stack[depth++] = current;
+            }
+        }
+
+        if (!result.items.empty()) {
+            result.next = PageToken<K>(result.items.back().first);
+        }
+        result.hasMore = depth > 0;
+        return result;
+    }
+
+    NodePtr buildBalanced(std::vector<std::pair<K, V>>& entries, size_t lo, size_t hi) {
+        if (lo >= hi) return nullptr;
+        size_t mid = lo + (hi - lo) / 2;
+        NodePtr node = std::make_shared<Node>(std::move(entries[mid].first), std::move(entries[mid].second));
+        node->left = buildBalanced(entries, lo, mid);
+        node->right = buildBalanced(entries, mid + 1, hi);
+        updateHeight(node);
+        return node;
+    }
+
+    Node* findNode(const K& key) const noexcept {
+        stats_.beginPath();
+        Node* current = root_.get();
+        while (current) {
+            stats_.visit();
+            if (lessThan(key, current->key)) {
+                current = current->left.get();
+            } else if (lessThan(current->key, key)) {
+                current = current->right.get();
+            } else {
+                break;
+            }
+        }
+        stats_.endPath();
+        return current;
+    }
+
+    bool lessThan(const K& a, const K& b) const {
+        stats_.compare();
+        return a < b;
+    }
+
+    int getHeight(const NodePtr& node) const noexcept {
+        return node ? node->height : 0;
+    }
+
+    void updateHeight(NodePtr& node) noexcept {
+        if (node) {
+            stats_.heightUpdate();
+            node->height = 1 + std::max(getHeight(node->left), getHeight(node->right));
+        }
+    }
+
+    int balanceFactor(const NodePtr& node) const noexcept {
+        return node ? getHeight(node->left) - getHeight(node->right) : 0;
+    }
+
+    NodePtr rotateRight(NodePtr& y) {
+        NodePtr x = y->left;
+        y->left = x->right;
+        x->right = y;
+
+        updateHeight(y);
+        updateHeight(x);
+
+        return x;
+    }
+
+    NodePtr rotateLeft(NodePtr& x) {
+        NodePtr y = x->right;
+        x->right = y->left;
+        y->left = x;
+
+        updateHeight(x);
+        updateHeight(y);
+
+        return y;
+    }
+
+    NodePtr balance(NodePtr& node) {
+        int oldHeight = node->height;
+        updateHeight(node);
+        int balance = balanceFactor(node);
+
+        // Left Heavy
+        if (balance > 1) {
+            stats_.retraceStep();
+            if (balanceFactor(node->left) < 0) {
+                stats_.rotate(Rotation::LeftRight);
+                node->left = rotateLeft(node->left);
+            } else {
+                stats_.rotate(Rotation::Right);
+            }
+            return rotateRight(node);
+        }
+
+        // Right Heavy
+        if (balance < -1) {
+            stats_.retraceStep();
+            if (balanceFactor(node->right) > 0) {
+                stats_.rotate(Rotation::RightLeft);
+                node->right = rotateRight(node->right);
+            } else {
+                stats_.rotate(Rotation::Left);
+            }
+            return rotateLeft(node);
+        }
+
+        if (node->height != oldHeight) stats_.retraceStep();
+        return node;
+    }
+
+    template<typename... Args>
+    NodePtr insertImpl(NodePtr& node, const K& key, Node*& hit, Args&&... args) {
+        if (!node) {
+            size_++;
+            NodePtr created = std::make_shared<Node>(key, std::forward<Args>(args)...);
+            hit = created.get();
+            return created;
+        }
+
+        stats_.visit();
+        if (lessThan(key, node->key)) {
+            node->left = insertImpl(node->left, key, hit, std::forward<Args>(args)...);
+        } else if (lessThan(node->key, key)) {
+            node->right = insertImpl(node->right, key, hit, std::forward<Args>(args)...);
+        } else {
+            hit = node.get();
+            return node;
+        }
+
+        return balance(node);
+    }
+
+    // Unlinks the leftmost node below node into min
+    NodePtr detachMin(NodePtr& node, NodePtr& min) {
+        stats_.visit();
+        if (!node->left) {
+            min = node;
+            return node->right;
+        }
+        node->left = detachMin(node->left, min);
+        return balance(node);
+    }
+
+    NodePtr removeImpl(NodePtr& node, const K& key, bool& found) {
+        if (!node) return nullptr;
+
+        stats_.visit();
+        if (lessThan(key, node->key)) {
+            node->left = removeImpl(node->left, key, found);
+        }
+        else if (lessThan(node->key, key)) {
+            node->right = removeImpl(node->right, key, found);
+        }
+        else {
+            found = true;
+            size_--;
+
+            // Zero or one child
+            if (!node->left) return node->right;
+            if (!node->right) return node->left;
+
+            // Two children: relink the in-order successor into this position
+            NodePtr successor;
+            NodePtr right = detachMin(node->right, successor);
+            successor->left = node->left;
+            successor->right = right;
+            return balance(successor);
+        }
+
+        return balance(node);
+    }
+};
+
+}
+
+#endif
@@ -0,0 +1,448 @@
+#ifndef BTREE_H
+#define BTREE_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <utility>
+
+namespace ds {
+
+// Ordered set stored as a B+ tree: every key lives in a leaf, leaves are
+// chained for iteration, and inner nodes hold separators only. Nodes are
+// sized to NodeBytes (a few cache lines by default, or a page), so a lookup
+// touches about log_B(n) nodes instead of log2(n), and the sorted keys of a
+// node are searched in place. T must be default constructible and
+// move assignable; keys are moved within nodes on insert and remove.
+template<typename T, size_t NodeBytes = 256>
+class BTree {
+private:
+    struct NodeBase {
+        uint32_t count;     // Keys in use
+        bool leaf;
+    };
+
+    // One slack slot in each array lets a node overflow by one key before it
+    // is split, which keeps insertion a plain shift
+    static constexpr size_t fitLeaf() {
+        size_t header = sizeof(NodeBase) + sizeof(void*);
+        size_t fit = NodeBytes > header ? (NodeBytes - header) / sizeof(T) : 0;
+        return fit > 5 ? fit - 1 : 4;
+    }
+
+    static constexpr size_t fitInner() {
+        size_t header = sizeof(NodeBase) + sizeof(void*);     // The extra child slot
+        size_t fit = NodeBytes > header ? (NodeBytes - header) / (sizeof(T) + sizeof(void*)) : 0;
+        return fit > 5 ? fit - 1 : 4;
+    }
+
+public:
+    static constexpr size_t LEAF_CAPACITY = fitLeaf();
+    static constexpr size_t INNER_CAPACITY = fitInner();
+
+private:
+    static constexpr size_t LEAF_MIN = LEAF_CAPACITY / 2;
+    static constexpr size_t INNER_MIN = INNER_CAPACITY / 2;
+
+    // Cache-line aligned so a node spans as few lines as its size allows
+    struct alignas(64) Leaf : NodeBase {
+        Leaf* next{nullptr};
+        T keys[LEAF_CAPACITY + 1];
+
+        Leaf() : NodeBase{0, true} {}
+    };
+
+    struct alignas(64) Inner : NodeBase {
+        T keys[INNER_CAPACITY + 1];                 // keys[i] <= every key under children[i + 1]
+        NodeBase* children[INNER_CAPACITY + 2]{};
+
+        Inner() : NodeBase{0, false} {}
+    };
+
+    NodeBase* root_{nullptr};
+    size_t size_{0};
+    int height_{0};
+
+    static Leaf* asLeaf(NodeBase* node) { return static_cast<Leaf*>(node); }
+    static Inner* asInner(NodeBase* node) { return static_cast<Inner*>(node); }
+    static const Leaf* asLeaf(const NodeBase* node) { return static_cast<const Leaf*>(node); }
+    static const Inner* asInner(const NodeBase* node) { return static_cast<const Inner*>(node); }
+
+    // Number of keys[0, count) less than value (or not greater, if inclusive).
+    // Binary search narrows large nodes to a short run, which is then counted
+    // without branches so the compiler can vectorize it.
+    template<bool Inclusive>
+    static size_t rank(const T* keys, size_t count, const T& value) {
+        auto before = [&value](const T& key) { return Inclusive ? !(value < key) : key < value; };
+        size_t base = 0;
+        while (count > 16) {
+            size_t half = count / 2;
+            if (before(keys[base + half - 1])) base += half;
+            count -= half;
+        }
+        size_t result = base;
+        for (size_t i = base; i < base + count; i++) result += before(keys[i]);
+        return result;
+    }
+
+    static void destroy(NodeBase* node) {
+        if (!node) return;
+        if (node->leaf) {
+            delete asLeaf(node);
+            return;
+        }
+        Inner* inner = asInner(node);
+        for (size_t i = 0; i <= inner->count; i++) destroy(inner->children[i]);
+        delete inner;
+    }
+
+    // Copies a subtree, chaining its leaves after *lastLeaf in key order
+    static NodeBase* clone(const NodeBase* node, Leaf*& lastLeaf) {
+        if (node->leaf) {
+            const Leaf* source = asLeaf(node);
+            Leaf* copy = new Leaf();
+            copy->count = source->count;
+            std::copy(source->keys, source->keys + source->count, copy->keys);
+            if (lastLeaf) lastLeaf->next = copy;
+            lastLeaf = copy;
+            return copy;
+        }
+        const Inner* source = asInner(node);
+        Inner* copy = new Inner();
+        copy->count = source->count;
+        std::copy(source->keys, source->keys + source->count, copy->keys);
+        for (size_t i = 0; i <= source->count; i++) {
+            copy->children[i] = clone(source->children[i], lastLeaf);
+        }
+        return copy;
+    }
+
+    struct Split {
+        NodeBase* right{nullptr};   // New right sibling, if the node split
+        T separator{};
+    };
+
+    // Inserts into the subtree; returns false for a duplicate
+    bool insertInto(NodeBase* node, const T& value, Split& split) {
+        if (node->leaf) {
+            Leaf* leaf = asLeaf(node);
+            size_t pos = rank<false>(leaf->keys, leaf->count, value);
+            if (pos < leaf->count && !(value < leaf->keys[pos])) return false;
+            std::move_backward(leaf->keys + pos, leaf->keys + leaf->count, leaf->keys + leaf->count + 1);
+            leaf->keys[pos] = value;
+            if (++leaf->count > LEAF_CAPACITY) splitLeaf(leaf, split);
+            return true;
+        }
+
+        Inner* inner = asInner(node);
+        size_t child = rank<true>(inner->keys, inner->count, value);
+        Split below;
+        if (!insertInto(inner->children[child], value, below)) return false;
+        if (below.right) {
+            std::move_backward(inner->keys + child, inner->keys + inner->count, inner->keys + inner->count + 1);
+            std::copy_backward(inner->children + child + 1, inner->children + inner->count + 1,
+                               inner->children + inner->count + 2);
+            inner->keys[child] = std::move(below.separator);
+            inner->children[child + 1] = below.right;
+            if (++inner->count > INNER_CAPACITY) splitInner(inner, split);
+        }
+        return true;
+    }
+
+    static void splitLeaf(Leaf* leaf, Split& split) {
+        Leaf* right = new Leaf();
+        size_t keep = leaf->count / 2;
+        right->count = leaf->count - static_cast<uint32_t>(keep);
+        std::move(leaf->keys + keep, leaf->keys + leaf->count, right->keys);
+        leaf->count = static_cast<uint32_t>(keep);
+        right->next = leaf->next;
+        leaf->next = right;
+        split.right = right;
+        split.separator = right->keys[0];
+    }
+
+    static void splitInner(Inner* inner, Split& split) {
+        Inner* right = new Inner();
+        size_t mid = inner->count / 2;
+        right->count = inner->count - static_cast<uint32_t>(mid) - 1;
+        std::move(inner->keys + mid + 1, inner->keys + inner->count, right->keys);
+        std::copy(inner->children + mid + 1, inner->children + inner->count + 1, right->children);
+        split.separator = std::move(inner->keys[mid]);
+        inner->count = static_cast<uint32_t>(mid);
+        split.right = right;
+    }
+
+    bool removeFrom(NodeBase* node, const T& value) {
+        if (node->leaf) {
+            Leaf* leaf = asLeaf(node);
+            size_t pos = rank<false>(leaf->keys, leaf->count, value);
+            if (pos == leaf->count || value < leaf->keys[pos]) return false;
+            std::move(leaf->keys + pos + 1, leaf->keys + leaf->count, leaf->keys + pos);
+            leaf->count--;
+            return true;
+        }
+
+        Inner* inner = asInner(node);
+        size_t child = rank<true>(inner->keys, inner->count, value);
+        if (!removeFrom(inner->children[child], value)) return false;
+        NodeBase* below = inner->children[child];
+        if (below->count < (below->leaf ? LEAF_MIN : INNER_MIN)) refill(inner, child);
+        return true;
+    }
+
+    // children[i] of parent fell below its minimum: borrow a key from a
+    // sibling that can spare one, otherwise merge with a sibling
+    static void refill(Inner* parent, size_t i) {
+        bool leaves = parent->children[i]->leaf;
+        size_t minimum = leaves ? LEAF_MIN : INNER_MIN;
+        if (i > 0 && parent->children[i - 1]->count > minimum) {
+            leaves ? borrowLeft(asLeaf(parent->children[i - 1]), asLeaf(parent->children[i]), parent->keys[i - 1])
+                   : borrowLeft(asInner(parent->children[i - 1]), asInner(parent->children[i]), parent->keys[i - 1]);
+        } else if (i < parent->count && parent->children[i + 1]->count > minimum) {
+            leaves ? borrowRight(asLeaf(parent->children[i]), asLeaf(parent->children[i + 1]), parent->keys[i])
+                   : borrowRight(asInner(parent->children[i]), asInner(parent->children[i + 1]), parent->keys[i]);
+        } else {
+            size_t left = i < parent->count ? i : i - 1;     // Merge children[left + 1] into children[left]
+            leaves ? mergeInto(asLeaf(parent->children[left]), asLeaf(parent->children[left + 1]))
+                   : mergeInto(asInner(parent->children[left]), asInner(parent->children[left + 1]), parent->keys[left]);
+            std::move(parent->keys + left + 1, parent->keys + parent->count, parent->keys + left);
+            std::copy(parent->children + left + 2, parent->children + parent->count + 1, parent->children + left + 1);
+            parent->count--;
+        }
+    }
+
+    static void borrowLeft(Leaf* left, Leaf* node, T& separator) {
+        std::move_backward(node->keys, node->keys + node->count, node->keys + node->count + 1);
+        node->keys[0] = std::move(left->keys[--left->count]);
+        node->count++;
+        separator = node->keys[0];
+    }
+
+    static void borrowRight(Leaf* node, Leaf* right, T& separator) {
+        node->keys[node->count++] = std::move(right->keys[0]);
+        std::move(right->keys + 1, right->keys + right->count, right->keys);
+        right->count--;
+        separator = right->keys[0];
+    }
+
+    static void mergeInto(Leaf* left, Leaf* right) {
+        std::move(right->keys, right->keys + right->count, left->keys + left->count);
+        left->count += right->count;
+        left->next = right->next;
+        delete right;
+    }
+
+    static void borrowLeft(Inner* left, Inner* node, T& separator) {
+        std::move_backward(node->keys, node->keys + node->count, node->keys + node->count + 1);
+        std::copy_backward(node->children, node->children + node->count + 1, node->children + node->count + 2);
+        node->keys[0] = std::move(separator);
+        node->children[0] = left->children[left->count];
+        node->count++;
+        separator = std::move(left->keys[--left->count]);
+    }
+
+    static void borrowRight(Inner* node, Inner* right, T& separator) {
+        node->keys[node->count] = std::move(separator);
+        node->children[++node->count] = right->children[0];
+        separator = std::move(right->keys[0]);
+        std::move(right->keys + 1, right->keys + right->count, right->keys);
+        std::copy(right->children + 1, right->children + right->count + 1, right->children);
+        right->count--;
+    }
+
+    static void mergeInto(Inner* left, Inner* right, T& separator) {
+        left->keys[left->count] = std::move(separator);
+        std::move(right->keys, right->keys + right->count, left->keys + left->count + 1);
+        std::copy(right->children, right->children + right->count + 1, left->children + left->count + 1);
+        left->count += right->count + 1;
+        delete right;
+    }
+
+    const Leaf* findLeaf(const T& value) const {
+        const NodeBase* node = root_;
+        while (node && !node->leaf) {
+            const Inner* inner = asInner(node);
+            node = inner->children[rank<true>(inner->keys, inner->count, value)];
+        }
+        return asLeaf(node);
+    }
+
+    const Leaf* firstLeaf() const {
+        const NodeBase* node = root_;
+        while (node && !node->leaf) node = asInner(node)->children[0];
+        return asLeaf(node);
+    }
+
+public:
+    // Forward iterator over the leaf chain
+    class iterator {
+    private:
+        friend class BTree;
+
+        const Leaf* leaf_{nullptr};
+        size_t index_{0};
+
+        iterator(const Leaf* leaf, size_t index) : leaf_(leaf), index_(index) {
+            skipExhausted();
+        }
+
+        void skipExhausted() {
+            while (leaf_ && index_ >= leaf_->count) {
+                leaf_ = leaf_->next;
+                index_ = 0;
+            }
+        }
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const T*;
+        using reference = const T&;
+
+        iterator() = default;
+
+        reference operator*() const { return leaf_->keys[index_]; }
+        pointer operator->() const { return &leaf_->keys[index_]; }
+
+        iterator& operator++() {
+            index_++;
+            skipExhausted();
+            return *this;
+        }
+
+        iterator operator++(int) {
+            iterator tmp = *this;
+            ++(*this);
+            return tmp;
+        }
+
+        bool operator==(const iterator& other) const {
+            return leaf_ == other.leaf_ && index_ == other.index_;
+        }
+
+        bool operator!=(const iterator& other) const {
+            return !(*this == other);
+        }
+    };
+
+    BTree() = default;
+
+    BTree(const BTree& other) : size_(other.size_), height_(other.height_) {
+        Leaf* lastLeaf = nullptr;
+        root_ = other.root_ ? clone(other.root_, lastLeaf) : nullptr;
+    }
+
+    BTree(BTree&& other) noexcept
+        : root_(std::exchange(other.root_, nullptr)),
+          size_(std::exchange(other.size_, 0)),
+          height_(std::exchange(other.height_, 0)) {}
+
+    BTree& operator=(const BTree& other) {
+        if (this != &other) {
+            BTree temp(other);
+            swap(temp);
+        }
+        return *this;
+    }
+
+    BTree& operator=(BTree&& other) noexcept {
+        if (this != &other) {
+            clear();
+            swap(other);
+        }
+        return *this;
+    }
+
+    ~BTree() { destroy(root_); }
+
+    void swap(BTree& other) noexcept {
+        std::swap(root_, other.root_);
+        std::swap(size_, other.size_);
+        std::swap(height_, other.height_);
+    }
+
+    iterator begin() const { return iterator(firstLeaf(), 0); }
+    iterator end() const { return iterator(); }
+
+    void insert(const T& value) {
+        if (!root_) {
+            root_ = new Leaf();
+            height_ = 1;
+        }
+        Split split;
+        if (!insertInto(root_, value, split)) return;
+        size_++;
+        if (split.right) {
+            Inner* root = new Inner();
+            root->count = 1;
+            root->keys[0] = std::move(split.separator);
+            root->children[0] = root_;
+            root->children[1] = split.right;
+            root_ = root;
+            height_++;
+        }
+    }
+
+    bool remove(const T& value) {
+        if (!root_ || !removeFrom(root_, value)) return false;
+        size_--;
+        if (root_->count == 0) {
+            NodeBase* old = root_;
+            root_ = root_->leaf ? nullptr : asInner(root_)->children[0];
+            if (old->leaf) delete asLeaf(old); else delete asInner(old);
+            height_--;
+        }
+        return true;
+    }
+
+    void clear() {
+        destroy(root_);
+        root_ = nullptr;
+        size_ = 0;
+        height_ = 0;
+    }
+
+    bool contains(const T& value) const {
+        const Leaf* leaf = findLeaf(value);
+        if (!leaf) return false;
+        size_t pos = rank<false>(leaf->keys, leaf->count, value);
+        return pos < leaf->count && !(value < leaf->keys[pos]);
+    }
+
+    // First element not less than value
+    iterator lower_bound(const T& value) const {
+        const Leaf* leaf = findLeaf(value);
+        return leaf ? iterator(leaf, rank<false>(leaf->keys, leaf->count, value)) : end();
+    }
+
+    // First element greater than value
+    iterator upper_bound(const T& value) const {
+        const Leaf* leaf = findLeaf(value);
+        return leaf ? iterator(leaf, rank<true>(leaf->keys, leaf->count, value)) : end();
+    }
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    // Levels from the root to the leaves; every leaf is at the same depth
+    int height() const { return height_; }
+
+    void inorder(const std::function<void(const T&)>& callback) const {
+        scanInorder(callback);
+    }
+
+    // Walks the leaf chain: sequential keys, no stack
+    template<typename Callback>
+    void scanInorder(Callback&& callback) const {
+        for (const Leaf* leaf = firstLeaf(); leaf; leaf = leaf->next) {
+            for (size_t i = 0; i < leaf->count; i++) callback(leaf->keys[i]);
+        }
+    }
+};
+
+}
+
+#endif
@@ -0,0 +1,739 @@
+#ifndef BALANCED_TREE_H
+#define BALANCED_TREE_H
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <utility>
+#include <vector>
+#include "TreeStats.h"
+
+namespace ds {
+
+// Binary search tree core whose rebalancing is chosen at compile time.
+// Lookup, iteration, insertion and removal are shared; a BalancePolicy
+// supplies the per-node balance data (Meta) and repairs the tree after each
+// structural change through two hooks:
+//   inserted(tree, node)                      node was linked in as a leaf
+//   erased(tree, removed, child, parent, left) removed (still readable) was
+//       unlinked; child took its place under parent, on the left if `left`
+// and a check used by verify():
+//   valid(root)                               the policy's invariant holds
+// Policies rebalance with the tree's rotateLeft()/rotateRight(). Nodes carry
+// parent links, so rebalancing walks up without recursion and removal never
+// copies keys. Stats works as for AVLTree (see TreeStats.h); here double
+// rotations are counted as their two single rotations.
+template<typename T, typename Policy, typename Stats = NoStats>
+class BalancedTree {
+private:
+    friend Policy;
+
+    struct Node {
+        T data;
+        Node* left{nullptr};
+        Node* right{nullptr};
+        Node* parent{nullptr};
+        [[no_unique_address]] typename Policy::Meta meta{};
+
+        explicit Node(const T& value) : data(value) {}
+    };
+
+    Node* root_{nullptr};
+    size_t size_{0};
+    [[no_unique_address]] mutable Stats stats_;
+
+    static Node* leftmost(Node* node) {
+        while (node && node->left) node = node->left;
+        return node;
+    }
+
+    static void destroy(Node* node) {
+        while (node) {
+            // Turn the left subtree into a right spine, then free top-down
+            if (node->left) {
+                Node* left = node->left;
+                node->left = left->right;
+                left->right = node;
+                node = left;
+            } else {
+                Node* right = node->right;
+                delete node;
+                node = right;
+            }
+        }
+    }
+
+    static Node* copyNode(const Node* node, Node* parent) {
+        Node* copy = new Node(node->data);
+        copy->meta = node->meta;
+        copy->parent = parent;
+        return copy;
+    }
+
+    // Copies the tree in pre-order, stepping back up through parent links
+    // instead of recursing: an unbalanced tree can be a chain of n nodes
+    static Node* clone(const Node* source) {
+        if (!source) return nullptr;
+        Node* root = copyNode(source, nullptr);
+        try {
+            const Node* from = source;
+            Node* to = root;
+            while (true) {
+                if (from->left && !to->left) {
+                    to->left = copyNode(from->left, to);
+                    from = from->left;
+                    to = to->left;
+                } else if (from->right && !to->right) {
+                    to->right = copyNode(from->right, to);
+                    from = from->right;
+                    to = to->right;
+                } else if (from == source) {
+                    return root;
+                } else {
+                    from = from->parent;
+                    to = to->parent;
+                }
+            }
+        } catch (...) {
+            destroy(root);
+            throw;
+        }
+    }
+
+    void replaceChild(Node* parent, Node* old, Node* child) {
+        if (!parent) {
+            root_ = child;
+        } else if (parent->left == old) {
+            parent->left = child;
+        } else {
+            parent->right = child;
+        }
+        if (child) child->parent = parent;
+    }
+
+    // x's right child takes x's place
+    void rotateLeft(Node* x) {
+        stats_.rotate(Rotation::Left);
+        Node* y = x->right;
+        x->right = y->left;
+        if (y->left) y->left->parent = x;
+        replaceChild(x->parent, x, y);
+        y->left = x;
+        x->parent = y;
+    }
+
+    // x's left child takes x's place
+    void rotateRight(Node* x) {
+        stats_.rotate(Rotation::Right);
+        Node* y = x->left;
+        x->left = y->right;
+        if (y->right) y->right->parent = x;
+        replaceChild(x->parent, x, y);
+        y->right = x;
+        x->parent = y;
+    }
+
+    Node* root() const { return root_; }
+
+    Node* find(const T& value) const {
+        stats_.beginPath();
+        Node* current = root_;
+        while (current) {
+            stats_.visit();
+            stats_.compare();
+            if (value < current->data) {
+                current = current->left;
+                continue;
+            }
+            stats_.compare();
+            if (current->data < value) {
+                current = current->right;
+                continue;
+            }
+            break;
+        }
+        stats_.endPath();
+        return current;
+    }
+
+    // Swaps the tree positions (not the keys) of node and its in-order
+    // successor, which must be in node's right subtree
+    void swapWithSuccessor(Node* node, Node* successor) {
+        std::swap(node->meta, successor->meta);
+        Node* nodeParent = node->parent;
+        Node* nodeLeft = node->left;
+        Node* successorRight = successor->right;
+
+        if (successor == node->right) {
+            replaceChild(nodeParent, node, successor);
+            successor->right = node;
+            node->parent = successor;
+        } else {
+            Node* successorParent = successor->parent;
+            replaceChild(nodeParent, node, successor);
+            successor->right = node->right;
+            successor->right->parent = successor;
+            successorParent->left = node;
+            node->parent = successorParent;
+        }
+        successor->left = nodeLeft;
+        nodeLeft->parent = successor;
+        node->left = nullptr;
+        node->right = successorRight;
+        if (successorRight) successorRight->parent = node;
+    }
+
+    // In-order walk with an explicit stack (it does not trust the parent
+    // links it is checking): keys strictly increase and every child points
+    // back at its parent
+    bool ordered() const {
+        std::vector<const Node*> path;
+        const Node* previous = nullptr;
+        const Node* node = root_;
+        while (node || !path.empty()) {
+            for (; node; node = node->left) {
+                if (node->left && node->left->parent != node) return false;
+                if (node->right && node->right->parent != node) return false;
+                path.push_back(node);
+            }
+            node = path.back();
+            path.pop_back();
+            if (previous && !(previous->data < node->data)) return false;
+            previous = node;
+            node = node->right;
+        }
+        return true;
+    }
+
+public:
+    // In-order iterator; steps through parent links, so it holds one pointer
+    class iterator {
+    private:
+        friend class BalancedTree;
+
+        const Node* node_{nullptr};
+
+        explicit iterator(const Node* node) : node_(node) {}
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const T*;
+        using reference = const T&;
+
+        iterator() = default;
+
+        reference operator*() const { return node_->data; }
+        pointer operator->() const { return &node_->data; }
+
+        iterator& operator++() {
+            if (node_->right) {
+                node_ = node_->right;
+                while (node_->left) node_ = node_->left;
+            } else {
+                const Node* child = node_;
+                node_ = node_->parent;
+                while (node_ && node_->right == child) {
+                    child = node_;
+                    node_ = node_->parent;
+                }
+            }
+            return *this;
+        }
+
+        iterator operator++(int) {
+            iterator tmp = *this;
+            ++(*this);
+            return tmp;
+        }
+
+        bool operator==(const iterator& other) const { return node_ == other.node_; }
+        bool operator!=(const iterator& other) const { return node_ != other.node_; }
+    };
+
+    BalancedTree() = default;
+
+    BalancedTree(const BalancedTree& other) : root_(clone(other.root_)), size_(other.size_) {}
+
+    BalancedTree(BalancedTree&& other) noexcept
+        : root_(std::exchange(other.root_, nullptr)), size_(std::exchange(other.size_, 0)) {}
+
+    BalancedTree& operator=(const BalancedTree& other) {
+        if (this != &other) {
+            BalancedTree temp(other);
+            std::swap(root_, temp.root_);
+            std::swap(size_, temp.size_);
+        }
+        return *this;
+    }
+
+    BalancedTree& operator=(BalancedTree&& other) noexcept {
+        if (this != &other) {
+            clear();
+            std::swap(root_, other.root_);
+            std::swap(size_, other.size_);
+        }
+        return *this;
+    }
+
+    ~BalancedTree() { destroy(root_); }
+
+    iterator begin() const { return iterator(leftmost(root_)); }
+    iterator end() const { return iterator(); }
+
+    void insert(const T& value) {
+        stats_.beginPath();
+        Node* parent = nullptr;
+        Node** link = &root_;
+        while (*link) {
+            parent = *link;
+            stats_.visit();
+            stats_.compare();
+            if (value < parent->data) {
+                link = &parent->left;
+                continue;
+            }
+            stats_.compare();
+            if (parent->data < value) {
+                link = &parent->right;
+                continue;
+            }
+            stats_.endPath();
+            return;     // Duplicate value
+        }
+        Node* node = new Node(value);
+        node->parent = parent;
+        *link = node;
+        size_++;
+        Policy::inserted(*this, node);
+        stats_.endPath();
+    }
+
+    bool remove(const T& value) {
+        Node* node = find(value);
+        if (!node) return false;
+        if (node->left && node->right) swapWithSuccessor(node, leftmost(node->right));
+
+        // node now has at most one child
+        Node* child = node->left ? node->left : node->right;
+        Node* parent = node->parent;
+        bool left = parent && parent->left == node;
+        replaceChild(parent, node, child);
+        Policy::erased(*this, node, child, parent, left);
+        delete node;
+        size_--;
+        return true;
+    }
+
+    void clear() {
+        destroy(root_);
+        root_ = nullptr;
+        size_ = 0;
+    }
+
+    bool contains(const T& value) const { return find(value) != nullptr; }
+
+    // First element not less than value
+    iterator lower_bound(const T& value) const {
+        const Node* result = nullptr;
+        for (const Node* current = root_; current;) {
+            if (current->data < value) {
+                current = current->right;
+            } else {
+                result = current;
+                current = current->left;
+            }
+        }
+        return iterator(result);
+    }
+
+    // First element greater than value
+    iterator upper_bound(const T& value) const {
+        const Node* result = nullptr;
+        for (const Node* current = root_; current;) {
+            if (value < current->data) {
+                result = current;
+                current = current->left;
+            } else {
+                current = current->right;
+            }
+        }
+        return iterator(result);
+    }
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    // Structural counters (TreeStats only)
+    const Stats& stats() const { return stats_; }
+    void resetStats() { stats_.reset(); }
+
+    void inorder(const std::function<void(const T&)>& callback) const {
+        scanInorder(callback);
+    }
+
+    template<typename Callback>
+    void scanInorder(Callback&& callback) const {
+        for (iterator it = begin(); it != end(); ++it) callback(*it);
+    }
+
+    // O(n) check of key order, parent links and the policy's invariant
+    bool verify() const {
+        return (!root_ || !root_->parent) && ordered() && Policy::valid(root_);
+    }
+};
+
+namespace balance {
+
+// Visits every node of the subtree at root in pre-order with an explicit
+// stack, so checking a degenerate tree cannot overflow the call stack.
+// visit(node, carry) receives its parent's carry (initial for the root),
+// may update it for the node's children, and returns false to stop.
+template<typename Node, typename Carry, typename Visit>
+bool preorder(const Node* root, Carry initial, Visit&& visit) {
+    if (!root) return true;
+    std::vector<std::pair<const Node*, Carry>> pending = {{root, initial}};
+    while (!pending.empty()) {
+        auto [node, carry] = pending.back();
+        pending.pop_back();
+        if (!visit(node, carry)) return false;
+        if (node->right) pending.emplace_back(node->right, carry);
+        if (node->left) pending.emplace_back(node->left, carry);
+    }
+    return true;
+}
+
+}
+
+// No rebalancing: a plain BST whose shape follows the insertion order
+struct NoBalance {
+    static constexpr const char* name = "Unbalanced";
+
+    struct Meta {};
+
+    template<typename Tree, typename Node>
+    static void inserted(Tree&, Node*) {}
+
+    template<typename Tree, typename Node>
+    static void erased(Tree&, Node*, Node*, Node*, bool) {}
+
+    template<typename Node>
+    static bool valid(const Node*) { return true; }
+};
+
+// AVL: subtree heights differ by at most one. Lowest height of the four
+// policies (<= 1.44 log2 n), at the price of rotations on removal.
+struct AVLBalance {
+    static constexpr const char* name = "AVL";
+
+    struct Meta {
+        int height = 1;
+    };
+
+    template<typename Node>
+    static int height(const Node* node) { return node ? node->meta.height : 0; }
+
+    template<typename Node>
+    static void update(Node* node) {
+        node->meta.height = 1 + std::max(height(node->left), height(node->right));
+    }
+
+    template<typename Node>
+    static int factor(const Node* node) { return height(node->left) - height(node->right); }
+
+    // Restores the AVL property at node; returns the subtree's new top
+    template<typename Tree, typename Node>
+    static Node* rebalance(Tree& tree, Node* node) {
+        update(node);
+        int balance = factor(node);
+        if (balance > 1) {
+            Node* left = node->left;
+            if (factor(left) < 0) {
+                tree.rotateLeft(left);
+                update(left);
+                update(left->parent);
+            }
+            tree.rotateRight(node);
+        } else if (balance < -1) {
+            Node* right = node->right;
+            if (factor(right) > 0) {
+                tree.rotateRight(right);
+                update(right);
+                update(right->parent);
+            }
+            tree.rotateLeft(node);
+        } else {
+            return node;
+        }
+        update(node);
+        update(node->parent);
+        return node->parent;
+    }
+
+    // Walks up until a subtree keeps its previous height
+    template<typename Tree, typename Node>
+    static void retrace(Tree& tree, Node* node) {
+        while (node) {
+            int before = node->meta.height;
+            Node* top = rebalance(tree, node);
+            tree.stats_.heightUpdate();
+            if (top->meta.height == before) {
+                if (top != node) tree.stats_.retraceStep();
+                break;
+            }
+            tree.stats_.retraceStep();
+            node = top->parent;
+        }
+    }
+
+    template<typename Tree, typename Node>
+    static void inserted(Tree& tree, Node* node) {
+        retrace(tree, node->parent);
+    }
+
+    template<typename Tree, typename Node>
+    static void erased(Tree& tree, Node*, Node*, Node* parent, bool) {
+        retrace(tree, parent);
+    }
+
+    // Checked node by node: each stored height is one more than its taller
+    // child's and the children differ by at most one, which by induction
+    // from the leaves makes every stored height the real one
+    template<typename Node>
+    static bool valid(const Node* root) {
+        return balance::preorder(root, 0, [](const Node* node, int&) {
+            int left = height(node->left);
+            int right = height(node->right);
+            return left - right <= 1 && right - left <= 1 && node->meta.height == 1 + std::max(left, right);
+        });
+    }
+};
+
+// Red-black: no red node has a red child and every path has the same number
+// of black nodes. Height up to 2 log2 n, but at most two rotations per insert
+// and three per removal.
+struct RedBlackBalance {
+    static constexpr const char* name = "RedBlack";
+
+    struct Meta {
+        bool red = true;
+    };
+
+    template<typename Node>
+    static bool isRed(const Node* node) { return node && node->meta.red; }
+
+    template<typename Tree, typename Node>
+    static void inserted(Tree& tree, Node* node) {
+        while (isRed(node->parent)) {
+            Node* parent = node->parent;
+            Node* grand = parent->parent;       // Exists: a red parent is never the root
+            bool parentLeft = parent == grand->left;
+            Node* uncle = parentLeft ? grand->right : grand->left;
+            tree.stats_.retraceStep();
+            if (isRed(uncle)) {
+                parent->meta.red = false;
+                uncle->meta.red = false;
+                grand->meta.red = true;
+                node = grand;
+                continue;
+            }
+            if (parentLeft) {
+                if (node == parent->right) {
+                    tree.rotateLeft(parent);
+                    std::swap(node, parent);
+                }
+                tree.rotateRight(grand);
+            } else {
+                if (node == parent->left) {
+                    tree.rotateRight(parent);
+                    std::swap(node, parent);
+                }
+                tree.rotateLeft(grand);
+            }
+            parent->meta.red = false;
+            grand->meta.red = true;
+            break;
+        }
+        tree.root()->meta.red = false;
+    }
+
+    template<typename Tree, typename Node>
+    static void erased(Tree& tree, Node* removed, Node* child, Node* parent, bool left) {
+        if (removed->meta.red) return;
+        if (isRed(child)) {
+            child->meta.red = false;
+            return;
+        }
+
+        // child carries an extra black; push it up or rotate it away
+        Node* node = child;
+        while (node != tree.root() && !isRed(node)) {
+            tree.stats_.retraceStep();
+            if (node) left = node == parent->left;
+            Node* sibling = left ? parent->right : parent->left;
+            if (isRed(sibling)) {
+                sibling->meta.red = false;
+                parent->meta.red = true;
+                left ? tree.rotateLeft(parent) : tree.rotateRight(parent);
+                sibling = left ? parent->right : parent->left;
+            }
+            Node* nearChild = left ? sibling->left : sibling->right;
+            Node* farChild = left ? sibling->right : sibling->left;
+            if (!isRed(nearChild) && !isRed(farChild)) {
+                sibling->meta.red = true;
+                node = parent;
+                parent = node->parent;
+                continue;
+            }
+            if (!isRed(farChild)) {
+                nearChild->meta.red = false;
+                sibling->meta.red = true;
+                left ? tree.rotateRight(sibling) : tree.rotateLeft(sibling);
+                farChild = sibling;
+                sibling = left ? parent->right : parent->left;
+            }
+            sibling->meta.red = parent->meta.red;
+            parent->meta.red = false;
+            farChild->meta.red = false;
+            left ? tree.rotateLeft(parent) : tree.rotateRight(parent);
+            node = tree.root();
+            break;
+        }
+        if (node) node->meta.red = false;
+    }
+
+    // The carry is the number of black nodes from the root down to the
+    // node; every node missing a child ends a path and must agree on it
+    template<typename Node>
+    static bool valid(const Node* root) {
+        if (isRed(root)) return false;
+        int pathBlacks = -1;
+        return balance::preorder(root, 0, [&pathBlacks](const Node* node, int& blacks) {
+            if (isRed(node) && (isRed(node->left) || isRed(node->right))) return false;
+            if (!isRed(node)) blacks++;
+            if (node->left && node->right) return true;
+            if (pathBlacks < 0) pathBlacks = blacks;
+            return blacks == pathBlacks;
+        });
+    }
+};
+
+// Weak AVL (Haeupler, Sen and Tarjan): nodes carry ranks, every rank
+// difference is 1 or 2 and leaves have rank 0. Built by inserts only it is
+// exactly an AVL tree; removals need at most two rotations and leave the
+// height within 2 log2 n, so write-heavy trees rotate less than with AVL.
+struct WAVLBalance {
+    static constexpr const char* name = "WAVL";
+
+    struct Meta {
+        int rank = 0;
+    };
+
+    template<typename Node>
+    static int rank(const Node* node) { return node ? node->meta.rank : -1; }
+
+    template<typename Node>
+    static int difference(const Node* parent, const Node* child) { return rank(parent) - rank(child); }
+
+    template<typename Tree, typename Node>
+    static void inserted(Tree& tree, Node* node) {
+        Node* parent = node->parent;
+        while (parent && difference(parent, node) == 0) {
+            tree.stats_.retraceStep();
+            bool left = node == parent->left;
+            Node* sibling = left ? parent->right : parent->left;
+            if (difference(parent, sibling) == 1) {
+                parent->meta.rank++;       // Promote and continue upwards
+                node = parent;
+                parent = node->parent;
+                continue;
+            }
+
+            // Sibling is a 2-child: one rotation finishes the repair
+            Node* inner = left ? node->right : node->left;
+            if (!inner || difference(node, inner) == 2) {
+                left ? tree.rotateRight(parent) : tree.rotateLeft(parent);
+                parent->meta.rank--;
+            } else {
+                left ? tree.rotateLeft(node) : tree.rotateRight(node);
+                left ? tree.rotateRight(parent) : tree.rotateLeft(parent);
+                inner->meta.rank++;
+                node->meta.rank--;
+                parent->meta.rank--;
+            }
+            break;
+        }
+    }
+
+    template<typename Tree, typename Node>
+    static void erased(Tree& tree, Node*, Node* child, Node* parent, bool left) {
+        if (!parent) return;
+
+        // A leaf of rank 1 (now 2,2) demotes first
+        Node* node = child;
+        if (!parent->left && !parent->right && parent->meta.rank == 1) {
+            parent->meta.rank = 0;
+            node = parent;
+            parent = node->parent;
+            if (parent) left = node == parent->left;
+        }
+
+        while (parent && difference(parent, node) == 3) {
+            tree.stats_.retraceStep();
+            Node* sibling = left ? parent->right : parent->left;
+            if (difference(parent, sibling) == 2) {
+                parent->meta.rank--;
+            } else if (difference(sibling, sibling->left) == 2 && difference(sibling, sibling->right) == 2) {
+                parent->meta.rank--;
+                sibling->meta.rank--;
+            } else {
+                Node* outer = left ? sibling->right : sibling->left;
+                Node* inner = left ? sibling->left : sibling->right;
+                if (difference(sibling, outer) == 1) {
+                    left ? tree.rotateLeft(parent) : tree.rotateRight(parent);
+                    sibling->meta.rank++;
+                    parent->meta.rank--;
+                    if (!parent->left && !parent->right) parent->meta.rank--;
+                } else {
+                    left ? tree.rotateRight(sibling) : tree.rotateLeft(sibling);
+                    left ? tree.rotateLeft(parent) : tree.rotateRight(parent);
+                    inner->meta.rank += 2;
+                    sibling->meta.rank--;
+                    parent->meta.rank -= 2;
+                }
+                break;
+            }
+            node = parent;
+            parent = node->parent;
+            if (parent) left = node == parent->left;
+        }
+    }
+
+    template<typename Node>
+    static bool valid(const Node* root) {
+        return balance::preorder(root, 0, [](const Node* node, int&) {
+            int left = difference(node, node->left);
+            int right = difference(node, node->right);
+            if (left < 1 || left > 2 || right < 1 || right > 2) return false;
+            return node->left || node->right || node->meta.rank == 0;
+        });
+    }
+};
+
+template<typename T, typename Stats = NoStats>
+using AVLSet = BalancedTree<T, AVLBalance, Stats>;
+
+template<typename T, typename Stats = NoStats>
+using RedBlackTree = BalancedTree<T, RedBlackBalance, Stats>;
+
+template<typename T, typename Stats = NoStats>
+using WAVLTree = BalancedTree<T, WAVLBalance, Stats>;
+
+template<typename T, typename Stats = NoStats>
+using UnbalancedTree = BalancedTree<T, NoBalance, Stats>;
+
+}
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef CURSOR_H
+#define CURSOR_H
+
+#include <optional>
+#include <vector>
+
+namespace ds {
+
+template<typename T, typename Stats> class AVLTree;
+template<typename T, typename Stats> class BST;
+template<typename K, typename V, typename Stats> class AVLMap;
+template<typename K, typename V, typename Stats> class BSTMap;
+
+// Opaque resume position for paged listings. It records the last key handed
+// out rather than a node, so it stays valid while the tree is modified; the
+// next page simply starts at the first key greater than it.
+template<typename T>
+class PageToken {
+public:
+    PageToken() = default;  // Start of the listing
+
+    bool atStart() const noexcept { return !last_.has_value(); }
+
+private:
+    template<typename, typename> friend class AVLTree;
+    template<typename, typename> friend class BST;
+    template<typename, typename, typename> friend class AVLMap;
+    template<typename, typename, typename> friend class BSTMap;
+
+    explicit PageToken(const T& last) : last_(last) {}
+
+    std::optional<T> last_;
+};
+
+// Maps hand out key/value pairs but resume from the last key alone
+template<typename T, typename Key = T>
+struct Page {
+    std::vector<T> items;
+    PageToken<Key> next;    // Pass back to fetch the following page
+    bool hasMore{false};
+};
+
+}
+
+#endif
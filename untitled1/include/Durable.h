@@ -0,0 +1,449 @@
+#ifndef DURABLE_H
+#define DURABLE_H
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include "AVL.h"
+#include "AVLMap.h"
+#include "Serialize.h"
+
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace ds {
+
+// When buffered WAL records are written and fsynced as one group
+struct GroupCommit {
+    size_t maxBytes = 64 * 1024;                    // Commit once this much is pending
+    std::chrono::microseconds window{1000};         // ...or the oldest record is this old
+};
+
+namespace wal {
+
+// Append-only log file with explicit durability points
+class LogFile {
+public:
+    explicit LogFile(const std::string& path) {
+#ifdef _WIN32
+        fd_ = ::_open(path.c_str(), _O_WRONLY | _O_CREAT | _O_APPEND | _O_BINARY, _S_IREAD | _S_IWRITE);
+#else
+        fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+#endif
+        if (fd_ < 0) throw std::runtime_error("Cannot open WAL " + path);
+    }
+
+    LogFile(const LogFile&) = delete;
+    LogFile& operator=(const LogFile&) = delete;
+
+    ~LogFile() {
+#ifdef _WIN32
+        ::_close(fd_);
+#else
+        ::close(fd_);
+#endif
+    }
+
+    // Writes bytes from offset written on, advancing written as data
+    // reaches the file; after a failure it tells the caller how much of
+    // bytes is already in the log
+    void append(const std::string& bytes, size_t& written) {
+        while (written < bytes.size()) {
+#ifdef _WIN32
+            int n = ::_write(fd_, bytes.data() + written, static_cast<unsigned>(bytes.size() - written));
+#else
+            ssize_t n = ::write(fd_, bytes.data() + written, bytes.size() - written);
+#endif
+            if (n < 0) throw std::runtime_error("WAL write failed");
+            written += static_cast<size_t>(n);
+        }
+    }
+
+    void sync() {
+#ifdef _WIN32
+        if (::_commit(fd_) != 0) throw std::runtime_error("WAL sync failed");
+#else
+        if (::fsync(fd_) != 0) throw std::runtime_error("WAL sync failed");
+#endif
+    }
+
+private:
+    int fd_{-1};
+};
+
+// Flushes an already-written file (or, on POSIX, a directory) to stable storage
+inline void syncPath(const std::string& path) {
+#ifdef _WIN32
+    int fd = ::_open(path.c_str(), _O_RDWR | _O_BINARY);
+    if (fd >= 0) {
+        ::_commit(fd);
+        ::_close(fd);
+    }
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd >= 0) {
+        ::fsync(fd);
+        ::close(fd);
+    }
+#endif
+}
+
+// Record: op (1 byte), payload length (4), FNV-1a checksum of both (4), payload
+enum class Op : uint8_t { Insert = 1, Remove = 2 };
+constexpr size_t RECORD_HEADER = 9;
+
+inline uint32_t checksum(uint8_t op, const char* data, size_t length) {
+    uint32_t hash = 2166136261u;
+    hash = (hash ^ op) * 16777619u;
+    for (size_t i = 0; i < length; i++) {
+        hash = (hash ^ static_cast<uint8_t>(data[i])) * 16777619u;
+    }
+    return hash;
+}
+
+// Write-ahead log plus snapshot in one directory, shared by the durable
+// containers. Records are buffered and fsynced in groups (GroupCommit);
+// the container supplies the payloads and applies them on recovery.
+class Journal {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    Journal(const std::string& directory, GroupCommit policy)
+        : dir_(directory), policy_(policy) {
+        std::filesystem::create_directories(dir_);
+    }
+
+    Journal(const Journal&) = delete;
+    Journal& operator=(const Journal&) = delete;
+
+    ~Journal() {
+        try {
+            sync();
+        } catch (...) {
+            // Destructors must not throw; unsynced records are lost as in a crash
+        }
+    }
+
+    // Loads the snapshot with load(istream&), replays each valid record
+    // with apply(op, payload stream) and opens the log for appending. A
+    // torn or unknown record ends the replay and is cut off.
+    template<typename Load, typename Apply>
+    void recover(Load&& load, Apply&& apply) {
+        if (std::filesystem::exists(snapshotPath())) {
+            std::ifstream in(snapshotPath(), std::ios::binary);
+            load(in);
+        }
+        if (std::filesystem::exists(walPath())) replay(apply);
+        log_ = std::make_unique<LogFile>(walPath());
+    }
+
+    // Logs one change ahead of applying it: the record is buffered first
+    // (write(ostream&) serializes its payload), then apply() makes the
+    // change, and the group is committed once full or old enough. If apply()
+    // throws, the record is dropped again. If the commit throws, the change
+    // stays applied and its record pending; the next sync() retries it.
+    template<typename Write, typename Apply>
+    void record(Op op, Write&& write, Apply&& apply) {
+        size_t start = pending_.size();
+        buffer(op, write);
+        try {
+            apply();
+        } catch (...) {
+            pending_.resize(start);
+            throw;
+        }
+        poll();
+    }
+
+    // Commits every pending record now
+    void sync() {
+        if (!pending_.empty()) {
+            size_t written = 0;
+            try {
+                log_->append(pending_, written);
+            } catch (...) {
+                // Those bytes are in the file; a retry must not log them twice
+                pending_.erase(0, written);
+                unsynced_ = unsynced_ || written > 0;
+                throw;
+            }
+            pending_.clear();
+            unsynced_ = true;
+        }
+        if (!unsynced_) return;
+        log_->sync();
+        unsynced_ = false;
+        groups_++;
+    }
+
+    // Commits pending records once they fill a group or the oldest one's
+    // window has run out. This is otherwise only checked when a record is
+    // logged, so a writer that goes idle should call it periodically (or
+    // sync()).
+    void poll() {
+        if (pending_.empty()) return;
+        if (pending_.size() >= policy_.maxBytes || Clock::now() - oldestPending_ >= policy_.window) sync();
+    }
+
+    // Writes a fresh snapshot with save(ostream&) and starts an empty log
+    template<typename Save>
+    void checkpoint(Save&& save) {
+        sync();
+        std::string tmp = snapshotPath() + ".tmp";
+        {
+            std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+            save(out);
+            if (!out.flush()) throw std::runtime_error("Failed to write snapshot");
+        }
+        syncPath(tmp);
+        std::filesystem::rename(tmp, snapshotPath());
+        syncPath(dir_);
+
+        // Replaying old records over the new snapshot would be harmless
+        // (each one redoes a change the snapshot already holds, in order),
+        // so a crash here loses nothing
+        log_.reset();
+        std::filesystem::resize_file(walPath(), 0);
+        log_ = std::make_unique<LogFile>(walPath());
+    }
+
+    // Number of fsynced groups since open
+    size_t commitCount() const { return groups_; }
+
+private:
+    std::string dir_;
+    GroupCommit policy_;
+    std::unique_ptr<LogFile> log_;
+    std::string pending_;
+    bool unsynced_{false};     // Written to the log but not yet fsynced
+    Clock::time_point oldestPending_;
+    std::ostringstream record_;
+    size_t groups_{0};
+
+    // Appends a whole record to pending_, or nothing if it throws
+    template<typename Write>
+    void buffer(Op op, Write& write) {
+        record_.str("");
+        write(record_);
+        std::string payload = record_.str();
+        if (payload.size() > UINT32_MAX) throw std::length_error("WAL record too large");
+
+        uint8_t code = static_cast<uint8_t>(op);
+        uint32_t length = static_cast<uint32_t>(payload.size());
+        uint32_t sum = checksum(code, payload.data(), payload.size());
+
+        std::string bytes;
+        bytes.reserve(RECORD_HEADER + payload.size());
+        bytes.push_back(static_cast<char>(code));
+        bytes.append(reinterpret_cast<const char*>(&length), sizeof(length));
+        bytes.append(reinterpret_cast<const char*>(&sum), sizeof(sum));
+        bytes.append(payload);
+
+        if (pending_.empty()) oldestPending_ = Clock::now();
+        pending_.append(bytes);
+    }
+
+    std::string walPath() const { return (std::filesystem::path(dir_) / "wal.log").string(); }
+    std::string snapshotPath() const { return (std::filesystem::path(dir_) / "snapshot.bin").string(); }
+
+    template<typename Apply>
+    void replay(Apply& apply) {
+        uint64_t fileBytes = std::filesystem::file_size(walPath());
+        std::ifstream in(walPath(), std::ios::binary);
+        std::string payload;
+        uint64_t validBytes = 0;
+        while (true) {
+            char header[RECORD_HEADER];
+            if (!in.read(header, sizeof(header))) break;
+            uint8_t code = static_cast<uint8_t>(header[0]);
+            uint32_t length, sum;
+            std::memcpy(&length, header + 1, sizeof(length));
+            std::memcpy(&sum, header + 5, sizeof(sum));
+
+            if (length > fileBytes - validBytes - RECORD_HEADER) break;
+            payload.resize(length);
+            if (!in.read(payload.data(), length)) break;
+            if (checksum(code, payload.data(), length) != sum) break;
+            if (code != static_cast<uint8_t>(Op::Insert) && code != static_cast<uint8_t>(Op::Remove)) break;
+
+            std::istringstream record(payload);
+            apply(static_cast<Op>(code), record);
+            validBytes += RECORD_HEADER + length;
+        }
+        in.close();
+
+        // Drop a torn tail so new records are appended after valid ones
+        if (validBytes != fileBytes) {
+            std::filesystem::resize_file(walPath(), validBytes);
+        }
+    }
+};
+
+}
+
+// AVLTree whose inserts and removes survive a crash. Each mutation is
+// buffered in a write-ahead log before it is applied in memory; the log is
+// fsynced in groups (GroupCommit), so a mutation is durable once the group
+// containing it commits. If a commit fails the mutation stays applied and
+// pending, and is committed by a later successful sync(). The commit window is only checked on each mutation: a writer that
+// goes idle must call poll() periodically (or sync()) to commit the tail;
+// the destructor commits whatever is still pending. On open, the latest snapshot is
+// loaded and the log replayed on top of it; a torn record at the end of the
+// log (crash mid-write) is discarded.
+template<typename T>
+class DurableAVLTree {
+public:
+    using Clock = wal::Journal::Clock;
+
+    explicit DurableAVLTree(const std::string& directory, GroupCommit policy = {})
+        : journal_(directory, policy) {
+        journal_.recover(
+            [this](std::istream& in) { tree_.load(in); },
+            [this](wal::Op op, std::istream& record) {
+                T value = Serializer<T>::read(record);
+                if (op == wal::Op::Insert) {
+                    tree_.insert(value);
+                } else {
+                    tree_.remove(value);
+                }
+            });
+    }
+
+    void insert(const T& value) {
+        if (tree_.contains(value)) return;
+        log(wal::Op::Insert, value, [&] { tree_.insert(value); });
+    }
+
+    bool remove(const T& value) {
+        if (!tree_.contains(value)) return false;
+        log(wal::Op::Remove, value, [&] { tree_.remove(value); });
+        return true;
+    }
+
+    bool contains(const T& value) const { return tree_.contains(value); }
+    size_t size() const { return tree_.size(); }
+    bool empty() const { return tree_.empty(); }
+
+    void inorder(const std::function<void(const T&)>& callback) const {
+        tree_.inorder(callback);
+    }
+
+    // Read access to the in-memory tree (paging, iteration, ...)
+    const AVLTree<T>& tree() const { return tree_; }
+
+    // Commits every pending record now
+    void sync() { journal_.sync(); }
+
+    // Commits pending records once the group-commit window has run out
+    void poll() { journal_.poll(); }
+
+    // Writes a fresh snapshot and starts an empty log
+    void checkpoint() {
+        journal_.checkpoint([this](std::ostream& out) { tree_.save(out); });
+    }
+
+    // Number of fsynced groups since open
+    size_t commitCount() const { return journal_.commitCount(); }
+
+private:
+    wal::Journal journal_;
+    AVLTree<T> tree_;
+
+    template<typename Apply>
+    void log(wal::Op op, const T& value, Apply&& apply) {
+        journal_.record(op, [&value](std::ostream& out) { Serializer<T>::write(out, value); }, apply);
+    }
+};
+
+// AVLMap with the same durability as DurableAVLTree. An Insert record holds
+// a key and its new value, a Remove record just the key. Values are only
+// changed through insert_or_assign, so every change reaches the log.
+template<typename K, typename V>
+class DurableAVLMap {
+public:
+    explicit DurableAVLMap(const std::string& directory, GroupCommit policy = {})
+        : journal_(directory, policy) {
+        journal_.recover(
+            [this](std::istream& in) { map_.load(in); },
+            [this](wal::Op op, std::istream& record) {
+                K key = Serializer<K>::read(record);
+                if (op == wal::Op::Insert) {
+                    map_.insert_or_assign(key, Serializer<V>::read(record));
+                } else {
+                    map_.remove(key);
+                }
+            });
+    }
+
+    // Inserts key or overwrites its value; true if the key was new
+    bool insert_or_assign(const K& key, const V& value) {
+        bool inserted = false;
+        logInsert(key, value, [&] { inserted = map_.insert_or_assign(key, value).second; });
+        return inserted;
+    }
+
+    // Inserts key with value unless it is already present
+    bool try_emplace(const K& key, const V& value) {
+        if (map_.contains(key)) return false;
+        logInsert(key, value, [&] { map_.try_emplace(key, value); });
+        return true;
+    }
+
+    bool remove(const K& key) {
+        if (!map_.contains(key)) return false;
+        journal_.record(wal::Op::Remove, [&key](std::ostream& out) { Serializer<K>::write(out, key); },
+                        [&] { map_.remove(key); });
+        return true;
+    }
+
+    const V* find(const K& key) const { return map_.find(key); }
+    bool contains(const K& key) const { return map_.contains(key); }
+    size_t size() const { return map_.size(); }
+    bool empty() const { return map_.empty(); }
+
+    // Read access to the in-memory map (paging, iteration, ...)
+    const AVLMap<K, V>& map() const { return map_; }
+
+    // Commits every pending record now
+    void sync() { journal_.sync(); }
+
+    // Commits pending records once the group-commit window has run out
+    void poll() { journal_.poll(); }
+
+    // Writes a fresh snapshot and starts an empty log
+    void checkpoint() {
+        journal_.checkpoint([this](std::ostream& out) { map_.save(out); });
+    }
+
+    // Number of fsynced groups since open
+    size_t commitCount() const { return journal_.commitCount(); }
+
+private:
+    wal::Journal journal_;
+    AVLMap<K, V> map_;
+
+    template<typename Apply>
+    void logInsert(const K& key, const V& value, Apply&& apply) {
+        journal_.record(wal::Op::Insert, [&](std::ostream& out) {
+            Serializer<K>::write(out, key);
+            Serializer<V>::write(out, value);
+        }, apply);
+    }
+};
+
+}
+
+#endif
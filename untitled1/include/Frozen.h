@@ -0,0 +1,255 @@
+#ifndef FROZEN_H
+#define FROZEN_H
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <istream>
+#include <iterator>
+#include <new>
+#include <ostream>
+#include <stdexcept>
+#include <vector>
+#include "MemoryUsage.h"
+#include "Serialize.h"
+#include "TreeStats.h"
+
+namespace ds {
+
+template<typename T, typename Stats>
+class AVLTree;
+
+// Immutable ordered set in one array, in Eytzinger (BFS) order: the root
+// at index 1 and the children of k at 2k and 2k + 1. Made by freeze() on
+// AVLTree or BST for data that is built once and then only read; thaw()
+// turns it back into a pointer tree.
+//
+// Lookups descend without branching on the comparison (k = 2k + (key <
+// value)) and prefetch the cache line holding k's descendants log2(keys
+// per line) levels down, so the loads of successive levels overlap. The
+// top levels share a few hot lines instead of one node each. Iteration
+// is still in key order: the in-order successor comes from index
+// arithmetic. Safe for any number of concurrent readers.
+template<typename T>
+class FrozenTree {
+private:
+    // Line-aligned storage, so index k * PREFETCH_STRIDE starts a line
+    template<typename U>
+    struct LineAllocator {
+        using value_type = U;
+
+        LineAllocator() = default;
+        template<typename V>
+        LineAllocator(const LineAllocator<V>&) {}
+
+        U* allocate(size_t n) {
+            return static_cast<U*>(::operator new(n * sizeof(U), std::align_val_t(64)));
+        }
+
+        void deallocate(U* p, size_t) {
+            ::operator delete(p, std::align_val_t(64));
+        }
+
+        bool operator==(const LineAllocator&) const { return true; }
+        bool operator!=(const LineAllocator&) const { return false; }
+    };
+
+    static constexpr size_t PREFETCH_STRIDE = sizeof(T) < 64 ? 64 / sizeof(T) : 1;
+
+    std::vector<T, LineAllocator<T>> keys_;     // keys_[0] unused
+    size_t size_{0};
+
+    size_t firstIndex() const {
+        if (size_ == 0) return 0;
+        size_t k = 1;
+        while (2 * k <= size_) k *= 2;
+        return k;
+    }
+
+    // In-order successor: the leftmost node of the right subtree, or else
+    // the first ancestor reached from a left child (0 past the end)
+    size_t nextIndex(size_t k) const {
+        if (2 * k + 1 <= size_) {
+            k = 2 * k + 1;
+            while (2 * k <= size_) k *= 2;
+            return k;
+        }
+        return k >> (std::countr_one(k) + 1);
+    }
+
+    void prefetch(size_t k) const {
+#if defined(__GNUC__) || defined(__clang__)
+        // Integer arithmetic: the line may lie past the end of the array
+        __builtin_prefetch(reinterpret_cast<const void*>(
+            reinterpret_cast<uintptr_t>(keys_.data()) + k * PREFETCH_STRIDE * sizeof(T)));
+#else
+        (void)k;
+#endif
+    }
+
+    // Index of the first key not less than value (strictly greater, if
+    // Upper); 0 when there is none. The descent ends below a leaf, and
+    // the answer is the last node where it went left: strip the trailing
+    // right turns (1 bits) and the left turn before them.
+    template<bool Upper>
+    size_t descend(const T& value) const {
+        const T* keys = keys_.data();
+        size_t k = 1;
+        while (k <= size_) {
+            prefetch(k);
+            k = 2 * k + (Upper ? !(value < keys[k]) : keys[k] < value);
+        }
+        return k >> (std::countr_one(k) + 1);
+    }
+
+    // Places keys, arriving in sorted order, at their Eytzinger positions
+    template<typename Scan>
+    void fill(size_t count, Scan&& scan) {
+        keys_.assign(count + 1, T{});
+        size_ = count;
+        size_t k = firstIndex();
+        scan([this, &k](const T& key) {
+            keys_[k] = key;
+            k = nextIndex(k);
+        });
+    }
+
+public:
+    // In-order iterator over the array; holds an Eytzinger index (0 at the end)
+    class iterator {
+    private:
+        friend class FrozenTree;
+
+        const FrozenTree* tree_{nullptr};
+        size_t index_{0};
+
+        iterator(const FrozenTree* tree, size_t index) : tree_(tree), index_(index) {}
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const T*;
+        using reference = const T&;
+
+        iterator() = default;
+
+        reference operator*() const { return tree_->keys_[index_]; }
+        pointer operator->() const { return &tree_->keys_[index_]; }
+
+        iterator& operator++() {
+            index_ = tree_->nextIndex(index_);
+            return *this;
+        }
+
+        iterator operator++(int) {
+            iterator tmp = *this;
+            ++(*this);
+            return tmp;
+        }
+
+        bool operator==(const iterator& other) const {
+            return index_ == other.index_;
+        }
+
+        bool operator!=(const iterator& other) const {
+            return !(*this == other);
+        }
+    };
+
+    FrozenTree() = default;
+
+    // From keys that are already sorted and unique, O(n)
+    explicit FrozenTree(const std::vector<T>& sorted) {
+        fill(sorted.size(), [&sorted](auto&& place) {
+            for (const T& key : sorted) place(key);
+        });
+    }
+
+    // From any tree with size() and an in-order scanInorder(callback)
+    template<typename Tree>
+    static FrozenTree of(const Tree& tree) {
+        FrozenTree frozen;
+        frozen.fill(tree.size(), [&tree](auto&& place) { tree.scanInorder(place); });
+        return frozen;
+    }
+
+    // Back to a pointer tree (AVLTree by default; any tree with
+    // assignSorted), rebuilt balanced in O(n)
+    template<typename Tree = AVLTree<T, NoStats>>
+    Tree thaw() const {
+        std::vector<T> sorted;
+        sorted.reserve(size_);
+        scanInorder([&sorted](const T& key) { sorted.push_back(key); });
+        Tree tree;
+        tree.assignSorted(std::move(sorted));
+        return tree;
+    }
+
+    iterator begin() const { return iterator(this, firstIndex()); }
+    iterator end() const { return iterator(this, 0); }
+
+    bool contains(const T& value) const {
+        size_t k = descend<false>(value);
+        return k != 0 && !(value < keys_[k]);
+    }
+
+    // First element not less than value
+    iterator lower_bound(const T& value) const {
+        return iterator(this, descend<false>(value));
+    }
+
+    // First element greater than value
+    iterator upper_bound(const T& value) const {
+        return iterator(this, descend<true>(value));
+    }
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    // Levels of the implicit tree: floor(log2 n) + 1, 0 when empty
+    int height() const { return static_cast<int>(std::bit_width(size_)); }
+
+    // One flat allocation; key heap bytes need a HeapSize<T> specialization
+    MemoryUsage memory_usage() const {
+        MemoryUsage usage;
+        usage.nodes = size_;
+        if (keys_.capacity() > 0) {
+            usage.nodeBytes = keys_.capacity() * sizeof(T);
+            usage.allocatorOverhead = memory::allocatorOverhead(usage.nodeBytes);
+        }
+        if constexpr (HeapSize<T>::ownsHeap) {
+            scanInorder([&usage](const T& value) { usage.payloadHeapBytes += HeapSize<T>::of(value); });
+        }
+        return usage;
+    }
+
+    // Binary snapshot (see Serialize.h), in the same format as the trees
+    void save(std::ostream& out) const {
+        snapshot::writeHeader<T>(out, size_);
+        snapshot::KeyWriter<T> writer(out);
+        scanInorder(writer);
+        writer.finish();
+        if (!out) throw std::runtime_error("Failed to write snapshot");
+    }
+
+    void load(std::istream& in) {
+        uint64_t count = snapshot::readHeader<T>(in);
+        *this = FrozenTree(snapshot::readKeys<T>(in, count));
+    }
+
+    // Traversal with Callback Func
+    void inorder(const std::function<void(const T&)>& callback) const {
+        scanInorder(callback);
+    }
+
+    template<typename Callback>
+    void scanInorder(Callback&& callback) const {
+        for (size_t k = firstIndex(); k != 0; k = nextIndex(k)) callback(keys_[k]);
+    }
+};
+
+}
+
+#endif
@@ -0,0 +1,330 @@
+#ifndef KARYTREE_H
+#define KARYTREE_H
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <istream>
+#include <iterator>
+#include <limits>
+#include <ostream>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+#include "MemoryUsage.h"
+#include "Serialize.h"
+
+#if defined(__AVX2__) || defined(__SSE2__) || defined(_M_X64)
+#include <immintrin.h>
+#endif
+
+namespace ds {
+
+// Read-mostly ordered set of numeric keys, laid out as a static k-ary
+// search tree (an implicit B+ tree). The sorted keys are stored in blocks
+// of KEYS = NodeBytes / sizeof(T), and above them each index node holds
+// KEYS separators for KEYS + 1 children, so a lookup reads one block per
+// level: log_{KEYS+1}(n) cache lines instead of log2(n) scattered nodes.
+// Each block is searched with vector compares and movemasks (AVX2 or SSE,
+// chosen at compile time, with a scalar loop otherwise) that count the keys
+// less than the value; that count is the child to descend into.
+//
+// There are no per-node pointers: children are found by index arithmetic
+// and blocks are full, so the index costs about 1/KEYS of the keys. The
+// price is that the structure is built in one go: assign/assignSorted
+// rebuild it in O(n), and there is no single-key insert or remove.
+template<typename T, size_t NodeBytes = 64>
+class KaryTree {
+    static_assert(std::is_arithmetic_v<T>, "KaryTree keys must be integers or floating point");
+    static_assert(NodeBytes % 64 == 0 && NodeBytes / sizeof(T) >= 2, "NodeBytes must be whole cache lines");
+    static_assert(NodeBytes / sizeof(T) <= 64, "A block's compare mask must fit 64 bits");
+
+public:
+    static constexpr size_t KEYS = NodeBytes / sizeof(T);
+
+    // Which block search this build uses: "avx2", "sse" or "scalar"
+#if defined(__AVX2__)
+    static constexpr const char* simd = "avx2";
+#elif defined(__SSE2__) || defined(_M_X64)
+    static constexpr const char* simd = "sse";
+#else
+    static constexpr const char* simd = "scalar";
+#endif
+
+private:
+    struct alignas(64) Block {
+        T keys[KEYS];
+    };
+
+    // Pads partial blocks: never less than a key, so never counted
+    static constexpr T PAD = std::numeric_limits<T>::has_infinity
+        ? std::numeric_limits<T>::infinity() : std::numeric_limits<T>::max();
+
+    std::vector<Block> leaves_;         // Sorted keys, PAD after the last
+    std::vector<Block> index_;          // Index levels, root level first
+    std::vector<size_t> levelStart_;    // First block of each index level
+    size_t size_{0};
+
+    // Number of keys in the block less than value. Blocks are sorted, so
+    // the less-than lanes of the compare form a prefix: the movemasks are
+    // joined into one word and the count is its run of trailing ones.
+    static size_t countLess(const T* keys, T value) {
+        uint64_t mask = 0;
+#if defined(__AVX2__)
+        if constexpr (std::is_same_v<T, int32_t>) {
+            __m256i probe = _mm256_set1_epi32(value);
+            for (size_t i = 0; i < KEYS; i += 8) {
+                __m256i block = _mm256_load_si256(reinterpret_cast<const __m256i*>(keys + i));
+                mask |= uint64_t(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(probe, block)))) << i;
+            }
+            return std::countr_one(mask);
+        } else if constexpr (std::is_same_v<T, int64_t>) {
+            __m256i probe = _mm256_set1_epi64x(value);
+            for (size_t i = 0; i < KEYS; i += 4) {
+                __m256i block = _mm256_load_si256(reinterpret_cast<const __m256i*>(keys + i));
+                mask |= uint64_t(_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(probe, block)))) << i;
+            }
+            return std::countr_one(mask);
+        } else if constexpr (std::is_same_v<T, float>) {
+            __m256 probe = _mm256_set1_ps(value);
+            for (size_t i = 0; i < KEYS; i += 8) {
+                mask |= uint64_t(_mm256_movemask_ps(_mm256_cmp_ps(_mm256_load_ps(keys + i), probe, _CMP_LT_OQ))) << i;
+            }
+            return std::countr_one(mask);
+        } else if constexpr (std::is_same_v<T, double>) {
+            __m256d probe = _mm256_set1_pd(value);
+            for (size_t i = 0; i < KEYS; i += 4) {
+                mask |= uint64_t(_mm256_movemask_pd(_mm256_cmp_pd(_mm256_load_pd(keys + i), probe, _CMP_LT_OQ))) << i;
+            }
+            return std::countr_one(mask);
+        }
+#elif defined(__SSE2__) || defined(_M_X64)
+        if constexpr (std::is_same_v<T, int32_t>) {
+            __m128i probe = _mm_set1_epi32(value);
+            for (size_t i = 0; i < KEYS; i += 4) {
+                __m128i block = _mm_load_si128(reinterpret_cast<const __m128i*>(keys + i));
+                mask |= uint64_t(_mm_movemask_ps(_mm_castsi128_ps(_mm_cmplt_epi32(block, probe)))) << i;
+            }
+            return std::countr_one(mask);
+        } else if constexpr (std::is_same_v<T, float>) {
+            __m128 probe = _mm_set1_ps(value);
+            for (size_t i = 0; i < KEYS; i += 4) {
+                mask |= uint64_t(_mm_movemask_ps(_mm_cmplt_ps(_mm_load_ps(keys + i), probe))) << i;
+            }
+            return std::countr_one(mask);
+        } else if constexpr (std::is_same_v<T, double>) {
+            __m128d probe = _mm_set1_pd(value);
+            for (size_t i = 0; i < KEYS; i += 2) {
+                mask |= uint64_t(_mm_movemask_pd(_mm_cmplt_pd(_mm_load_pd(keys + i), probe))) << i;
+            }
+            return std::countr_one(mask);
+        }
+#endif
+        // Other key types (and 64-bit integers without AVX2): a branch-free
+        // count the compiler can vectorize itself
+        (void)mask;
+        size_t count = 0;
+        for (size_t i = 0; i < KEYS; i++) count += keys[i] < value;
+        return count;
+    }
+
+    // Position of the first key not less than value, in [0, size_]. A NaN
+    // probe is unordered with every key (each block compare says "not
+    // less", which would give 0), so it is sent to the end instead.
+    size_t lowerIndex(T value) const {
+        if constexpr (std::is_floating_point_v<T>) {
+            if (std::isnan(value)) return size_;
+        }
+        if (size_ == 0) return 0;
+        size_t node = 0;
+        for (size_t start : levelStart_) {
+            node = node * (KEYS + 1) + countLess(index_[start + node].keys, value);
+        }
+        return std::min(size_, node * KEYS + countLess(leaves_[node].keys, value));
+    }
+
+    const T& at(size_t pos) const {
+        return leaves_[pos / KEYS].keys[pos % KEYS];
+    }
+
+    // Separators for each level bottom-up: an index node's j-th key is the
+    // smallest key under its child j + 1, and missing children get PAD
+    void buildIndex() {
+        index_.clear();
+        levelStart_.clear();
+        std::vector<T> mins(leaves_.size());
+        for (size_t b = 0; b < leaves_.size(); b++) mins[b] = leaves_[b].keys[0];
+
+        std::vector<std::vector<Block>> levels;
+        while (mins.size() > 1) {
+            size_t parents = (mins.size() + KEYS) / (KEYS + 1);
+            std::vector<Block> level(parents);
+            std::vector<T> parentMins(parents);
+            for (size_t p = 0; p < parents; p++) {
+                size_t first = p * (KEYS + 1);
+                parentMins[p] = mins[first];
+                for (size_t j = 0; j < KEYS; j++) {
+                    level[p].keys[j] = first + j + 1 < mins.size() ? mins[first + j + 1] : PAD;
+                }
+            }
+            levels.push_back(std::move(level));
+            mins = std::move(parentMins);
+        }
+
+        for (auto level = levels.rbegin(); level != levels.rend(); ++level) {
+            levelStart_.push_back(index_.size());
+            index_.insert(index_.end(), level->begin(), level->end());
+        }
+    }
+
+public:
+    // Random-access position in the sorted keys
+    class iterator {
+    private:
+        friend class KaryTree;
+
+        const KaryTree* tree_{nullptr};
+        size_t pos_{0};
+
+        iterator(const KaryTree* tree, size_t pos) : tree_(tree), pos_(pos) {}
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const T*;
+        using reference = const T&;
+
+        iterator() = default;
+
+        reference operator*() const { return tree_->at(pos_); }
+        pointer operator->() const { return &tree_->at(pos_); }
+
+        iterator& operator++() {
+            pos_++;
+            return *this;
+        }
+
+        iterator operator++(int) {
+            iterator tmp = *this;
+            ++(*this);
+            return tmp;
+        }
+
+        bool operator==(const iterator& other) const {
+            return pos_ == other.pos_;
+        }
+
+        bool operator!=(const iterator& other) const {
+            return !(*this == other);
+        }
+    };
+
+    KaryTree() = default;
+
+    // Builds from keys in any order; duplicates are dropped
+    explicit KaryTree(std::vector<T> keys) {
+        assign(std::move(keys));
+    }
+
+    iterator begin() const { return iterator(this, 0); }
+    iterator end() const { return iterator(this, size_); }
+
+    // Replaces the contents with keys in any order, O(n log n)
+    void assign(std::vector<T> keys) {
+        std::sort(keys.begin(), keys.end());
+        keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+        assignSorted(std::move(keys));
+    }
+
+    // Replaces the contents with keys that are already sorted and unique, O(n)
+    void assignSorted(std::vector<T> keys) {
+        if constexpr (std::is_floating_point_v<T>) {
+            for (T key : keys) {
+                if (std::isnan(key)) throw std::invalid_argument("KaryTree keys cannot be NaN");
+            }
+        }
+        size_ = keys.size();
+        leaves_.assign((size_ + KEYS - 1) / KEYS, Block{});
+        for (size_t i = 0; i < leaves_.size() * KEYS; i++) {
+            leaves_[i / KEYS].keys[i % KEYS] = i < size_ ? keys[i] : PAD;
+        }
+        buildIndex();
+    }
+
+    void clear() {
+        leaves_.clear();
+        index_.clear();
+        levelStart_.clear();
+        size_ = 0;
+    }
+
+    bool contains(T value) const {
+        size_t pos = lowerIndex(value);
+        return pos < size_ && !(value < at(pos));
+    }
+
+    // First element not less than value
+    iterator lower_bound(T value) const {
+        return iterator(this, lowerIndex(value));
+    }
+
+    // First element greater than value
+    iterator upper_bound(T value) const {
+        size_t pos = lowerIndex(value);
+        if (pos < size_ && !(value < at(pos))) pos++;
+        return iterator(this, pos);
+    }
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    // Blocks read by a lookup: the index levels plus one block of keys
+    int height() const {
+        return size_ == 0 ? 0 : static_cast<int>(levelStart_.size()) + 1;
+    }
+
+    // Two flat allocations: the key blocks and the index
+    MemoryUsage memory_usage() const {
+        MemoryUsage usage;
+        usage.nodes = size_;
+        for (size_t blocks : {leaves_.capacity(), index_.capacity()}) {
+            if (blocks == 0) continue;
+            usage.nodeBytes += blocks * sizeof(Block);
+            usage.allocatorOverhead += memory::allocatorOverhead(blocks * sizeof(Block));
+        }
+        return usage;
+    }
+
+    // Binary snapshot (see Serialize.h), compatible with the other trees
+    void save(std::ostream& out) const {
+        snapshot::writeHeader<T>(out, size_);
+        snapshot::KeyWriter<T> writer(out);
+        scanInorder(writer);
+        writer.finish();
+        if (!out) throw std::runtime_error("Failed to write snapshot");
+    }
+
+    // Rebuilds from a snapshot in O(n)
+    void load(std::istream& in) {
+        uint64_t count = snapshot::readHeader<T>(in);
+        assignSorted(snapshot::readKeys<T>(in, count));
+    }
+
+    // Traversal with Callback Func
+    void inorder(const std::function<void(const T&)>& callback) const {
+        scanInorder(callback);
+    }
+
+    template<typename Callback>
+    void scanInorder(Callback&& callback) const {
+        for (size_t i = 0; i < size_; i++) callback(at(i));
+    }
+};
+
+}
+
+#endif
@@ -0,0 +1,267 @@
+#ifndef MAPPED_TREE_H
+#define MAPPED_TREE_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "AVL.h"
+#include "BST.h"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace ds {
+
+namespace mapped {
+
+// File layout: a 64-byte header followed by the keys in sorted order
+// (implicit layout, no pointers). Opening only maps and checks the header;
+// key pages are faulted in by the OS as lookups touch them.
+constexpr char MAGIC[4] = {'D', 'S', 'M', 'T'};
+constexpr uint32_t VERSION = 1;
+constexpr uint64_t DATA_OFFSET = 64;
+
+struct Header {
+    char magic[4];
+    uint32_t version;
+    uint32_t keySize;
+    uint32_t keyAlign;
+    uint64_t count;
+    uint64_t dataOffset;
+    char reserved[DATA_OFFSET - 32];
+};
+static_assert(sizeof(Header) == DATA_OFFSET);
+
+// Flushes a written file to stable storage
+inline void syncFile(const std::string& path) {
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_WRITE, FILE_SHARE_READ, nullptr,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    bool synced = file != INVALID_HANDLE_VALUE && FlushFileBuffers(file);
+    if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    bool synced = fd >= 0 && ::fsync(fd) == 0;
+    if (fd >= 0) ::close(fd);
+#endif
+    if (!synced) throw std::runtime_error("Cannot sync " + path);
+}
+
+template<typename T, typename Tree>
+void write(const Tree& tree, const std::string& path) {
+    static_assert(std::is_trivially_copyable_v<T>, "mapped trees need trivially copyable keys");
+    static_assert(alignof(T) <= DATA_OFFSET);
+
+    // Written beside the target, synced and renamed over it, never
+    // truncated in place: a reader still mapping the old file keeps its
+    // inode, where touching truncated pages would raise SIGBUS. Windows
+    // readers open with FILE_SHARE_DELETE so the rename is allowed there too.
+    const std::string temp = path + ".tmp";
+    std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+    if (!out) throw std::runtime_error("Cannot create " + temp);
+
+    Header header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.keySize = sizeof(T);
+    header.keyAlign = alignof(T);
+    header.count = tree.size();
+    header.dataOffset = DATA_OFFSET;
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    std::vector<T> buffer;
+    buffer.reserve(4096);
+    auto flush = [&]() {
+        out.write(reinterpret_cast<const char*>(buffer.data()),
+                  static_cast<std::streamsize>(buffer.size() * sizeof(T)));
+        buffer.clear();
+    };
+    tree.scanInorder([&](const T& key) {
+        buffer.push_back(key);
+        if (buffer.size() == buffer.capacity()) flush();
+    });
+    flush();
+    out.close();
+    try {
+        if (!out) throw std::runtime_error("Failed to write " + path);
+        syncFile(temp);
+        std::filesystem::rename(temp, path);
+    } catch (...) {
+        std::error_code ignored;
+        std::filesystem::remove(temp, ignored);    // Never leave the temp file behind
+        throw;
+    }
+}
+
+}
+
+// Freezes a tree into a file that mapped_tree<T> can open without loading
+template<typename T, typename Stats>
+void writeMappedTree(const AVLTree<T, Stats>& tree, const std::string& path) {
+    mapped::write<T>(tree, path);
+}
+
+template<typename T, typename Stats>
+void writeMappedTree(const BST<T, Stats>& tree, const std::string& path) {
+    mapped::write<T>(tree, path);
+}
+
+// Read-only ordered set served straight from a memory-mapped file
+template<typename T>
+class mapped_tree {
+    static_assert(std::is_trivially_copyable_v<T>, "mapped trees need trivially copyable keys");
+
+public:
+    using iterator = const T*;
+
+    explicit mapped_tree(const std::string& path) {
+        map(path);
+        try {
+            validate();
+        } catch (...) {
+            unmap();
+            throw;
+        }
+    }
+
+    mapped_tree(const mapped_tree&) = delete;
+    mapped_tree& operator=(const mapped_tree&) = delete;
+
+    mapped_tree(mapped_tree&& other) noexcept { steal(other); }
+
+    mapped_tree& operator=(mapped_tree&& other) noexcept {
+        if (this != &other) {
+            unmap();
+            steal(other);
+        }
+        return *this;
+    }
+
+    ~mapped_tree() { unmap(); }
+
+    size_t size() const noexcept { return size_; }
+    bool empty() const noexcept { return size_ == 0; }
+
+    iterator begin() const noexcept { return keys_; }
+    iterator end() const noexcept { return keys_ + size_; }
+
+    // First key not less than value
+    iterator lower_bound(const T& value) const {
+        return std::lower_bound(begin(), end(), value);
+    }
+
+    bool contains(const T& value) const {
+        iterator it = lower_bound(value);
+        return it != end() && !(value < *it);
+    }
+
+private:
+    void* base_{nullptr};
+    size_t bytes_{0};
+    const T* keys_{nullptr};
+    size_t size_{0};
+#ifdef _WIN32
+    HANDLE file_{INVALID_HANDLE_VALUE};
+    HANDLE mapping_{nullptr};
+#endif
+
+    void map(const std::string& path) {
+#ifdef _WIN32
+        // FILE_SHARE_DELETE lets a writer rename a new version over the file
+        file_ = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr,
+                            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file_ == INVALID_HANDLE_VALUE) throw std::runtime_error("Cannot open " + path);
+        LARGE_INTEGER fileSize;
+        GetFileSizeEx(file_, &fileSize);
+        bytes_ = static_cast<size_t>(fileSize.QuadPart);
+        mapping_ = bytes_ ? CreateFileMappingA(file_, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr;
+        base_ = mapping_ ? MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0) : nullptr;
+        if (!base_) {
+            unmap();
+            throw std::runtime_error("Cannot map " + path);
+        }
+#else
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) throw std::runtime_error("Cannot open " + path);
+        struct stat info {};
+        if (::fstat(fd, &info) != 0 || info.st_size == 0) {
+            ::close(fd);
+            throw std::runtime_error("Cannot map " + path);
+        }
+        bytes_ = static_cast<size_t>(info.st_size);
+        void* base = ::mmap(nullptr, bytes_, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);  // The mapping keeps the file alive
+        if (base == MAP_FAILED) throw std::runtime_error("Cannot map " + path);
+        base_ = base;
+#endif
+    }
+
+    void validate() {
+        if (bytes_ < sizeof(mapped::Header)) throw std::runtime_error("Not a mapped tree file");
+        const auto* header = static_cast<const mapped::Header*>(base_);
+        if (std::memcmp(header->magic, mapped::MAGIC, sizeof(mapped::MAGIC)) != 0) {
+            throw std::runtime_error("Not a mapped tree file");
+        }
+        if (header->version != mapped::VERSION) throw std::runtime_error("Unsupported mapped tree version");
+        if (header->keySize != sizeof(T) || header->keyAlign != alignof(T)) {
+            throw std::runtime_error("Mapped tree key type mismatch");
+        }
+        if (header->dataOffset < sizeof(mapped::Header) || header->dataOffset > bytes_ ||
+            header->dataOffset % alignof(T) != 0 ||
+            header->count > (bytes_ - header->dataOffset) / sizeof(T)) {
+            throw std::runtime_error("Truncated mapped tree file");
+        }
+        keys_ = reinterpret_cast<const T*>(static_cast<const char*>(base_) + header->dataOffset);
+        size_ = static_cast<size_t>(header->count);
+    }
+
+    void unmap() noexcept {
+#ifdef _WIN32
+        if (base_) UnmapViewOfFile(base_);
+        if (mapping_) CloseHandle(mapping_);
+        if (file_ != INVALID_HANDLE_VALUE) CloseHandle(file_);
+        mapping_ = nullptr;
+        file_ = INVALID_HANDLE_VALUE;
+#else
+        if (base_) ::munmap(base_, bytes_);
+#endif
+        base_ = nullptr;
+        keys_ = nullptr;
+        bytes_ = size_ = 0;
+    }
+
+    void steal(mapped_tree& other) noexcept {
+        base_ = other.base_;
+        bytes_ = other.bytes_;
+        keys_ = other.keys_;
+        size_ = other.size_;
+#ifdef _WIN32
+        file_ = other.file_;
+        mapping_ = other.mapping_;
+        other.file_ = INVALID_HANDLE_VALUE;
+        other.mapping_ = nullptr;
+#endif
+        other.base_ = nullptr;
+        other.keys_ = nullptr;
+        other.bytes_ = other.size_ = 0;
+    }
+};
+
+}
+
+#endif
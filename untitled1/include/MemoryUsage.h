@@ -0,0 +1,104 @@
+#ifndef MEMORY_USAGE_H
+#define MEMORY_USAGE_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace ds {
+
+// Memory held by a container. nodeBytes is what the container asks the
+// allocator for; allocatorOverhead estimates what malloc adds on top.
+struct MemoryUsage {
+    size_t nodes = 0;
+    size_t nodeBytes = 0;           // Node allocations, including control blocks
+    size_t allocatorOverhead = 0;   // Node chunk headers and rounding (estimated)
+    size_t payloadHeapBytes = 0;    // Heap owned by the keys, via HeapSize<T>
+
+    size_t totalBytes() const {
+        return nodeBytes + allocatorOverhead + payloadHeapBytes;
+    }
+
+    double bytesPerKey() const {
+        return nodes ? static_cast<double>(totalBytes()) / static_cast<double>(nodes) : 0.0;
+    }
+};
+
+namespace memory {
+
+// Bytes malloc spends beyond a request of `bytes`, modelled on glibc's
+// allocator: one size word of header, 16-byte granularity, 32-byte minimum
+// chunk (on 64-bit). Other allocators differ by a few bytes per block.
+inline constexpr size_t allocatorOverhead(size_t bytes) {
+    constexpr size_t header = sizeof(size_t);
+    constexpr size_t align = 2 * sizeof(size_t);
+    constexpr size_t minChunk = 4 * sizeof(size_t);
+    size_t chunk = (bytes + header + align - 1) & ~(align - 1);
+    if (chunk < minChunk) chunk = minChunk;
+    return chunk - bytes;
+}
+
+// make_shared places a control block (vtable pointer plus use and weak
+// counts) ahead of the object in the same allocation
+template<typename Object>
+inline constexpr size_t sharedAllocationBytes() {
+#if defined(_LIBCPP_VERSION)
+    constexpr size_t control = sizeof(void*) + 2 * sizeof(long);
+#else
+    constexpr size_t control = sizeof(void*) + 2 * sizeof(int);
+#endif
+    constexpr size_t align = alignof(Object);
+    return (control + align - 1) / align * align + sizeof(Object);
+}
+
+// Usage of `count` equal-sized node allocations; payload is added separately
+inline MemoryUsage nodeAllocations(size_t count, size_t bytesPerNode) {
+    MemoryUsage usage;
+    usage.nodes = count;
+    usage.nodeBytes = count * bytesPerNode;
+    usage.allocatorOverhead = count * allocatorOverhead(bytesPerNode);
+    return usage;
+}
+
+}
+
+// Heap bytes owned by a value beyond sizeof(T), including malloc overhead.
+// Zero unless specialized; specialize for key types that allocate (see
+// std::string below).
+template<typename T, typename Enable = void>
+struct HeapSize {
+    static constexpr bool ownsHeap = false;
+    static size_t of(const T&) { return 0; }
+};
+
+template<typename C, typename Traits, typename Alloc>
+struct HeapSize<std::basic_string<C, Traits, Alloc>> {
+    static constexpr bool ownsHeap = true;
+
+    static size_t of(const std::basic_string<C, Traits, Alloc>& value) {
+        // Short strings live inside the object itself
+        auto data = reinterpret_cast<const char*>(value.data());
+        auto self = reinterpret_cast<const char*>(&value);
+        if (data >= self && data < self + sizeof(value)) return 0;
+        size_t bytes = (value.capacity() + 1) * sizeof(C);
+        return bytes + memory::allocatorOverhead(bytes);
+    }
+};
+
+template<typename U, typename Alloc>
+struct HeapSize<std::vector<U, Alloc>> {
+    static constexpr bool ownsHeap = true;
+
+    static size_t of(const std::vector<U, Alloc>& value) {
+        size_t bytes = value.capacity() * sizeof(U);
+        if (bytes > 0) bytes += memory::allocatorOverhead(bytes);
+        if constexpr (HeapSize<U>::ownsHeap) {
+            for (const U& item : value) bytes += HeapSize<U>::of(item);
+        }
+        return bytes;
+    }
+};
+
+}
+
+#endif
@@ -0,0 +1,906 @@
+#ifndef MULTISET_H
+#define MULTISET_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <istream>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <ostream>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include "MemoryUsage.h"
+#include "Serialize.h"
+#include "TreeStats.h"
+
+namespace ds {
+
+// AVLMultiset's bucket: the number of copies of a node's key
+struct CopyCount {
+    uint32_t copies{0};
+
+    size_t size() const { return copies; }
+    bool empty() const { return copies == 0; }
+};
+
+// AVLMultimap's bucket: the payloads sharing one key, in insertion order.
+// The first sits in the node itself, so a key with a single payload (the
+// usual case) costs no allocation beyond its node; the rest go to a
+// vector, so a hot key takes more payloads in amortized O(1).
+template<typename V>
+class PayloadBucket {
+public:
+    size_t size() const { return first_ ? 1 + more_.size() : 0; }
+    bool empty() const { return !first_; }
+
+    const V& operator[](size_t i) const { return i == 0 ? *first_ : more_[i - 1]; }
+
+    // Position of the first payload equal to value, or size() if none
+    size_t find(const V& value) const {
+        for (size_t i = 0; i < size(); i++) {
+            if ((*this)[i] == value) return i;
+        }
+        return size();
+    }
+
+    void push_back(V value) {
+        if (!first_) {
+            first_.emplace(std::move(value));
+        } else {
+            more_.push_back(std::move(value));
+        }
+    }
+
+    // Removes payload i, keeping the others in order
+    void erase(size_t i) {
+        if (i == 0) {
+            if (more_.empty()) {
+                first_.reset();
+                return;
+            }
+            *first_ = std::move(more_.front());
+            i = 1;
+        }
+        more_.erase(more_.begin() + static_cast<std::ptrdiff_t>(i - 1));
+    }
+
+    // Removes payload i in O(1) by moving the last payload into its place
+    void swapErase(size_t i) {
+        if (more_.empty()) {
+            first_.reset();
+            return;
+        }
+        if (i + 1 < size()) {
+            V& slot = i == 0 ? *first_ : more_[i - 1];
+            slot = std::move(more_.back());
+        }
+        more_.pop_back();
+    }
+
+    // Heap behind the spill vector and the payloads themselves
+    size_t heapBytes() const {
+        size_t bytes = HeapSize<std::vector<V>>::of(more_);
+        if constexpr (HeapSize<V>::ownsHeap) {
+            if (first_) bytes += HeapSize<V>::of(*first_);
+        }
+        return bytes;
+    }
+
+private:
+    std::optional<V> first_;
+    std::vector<V> more_;
+};
+
+template<typename V>
+struct HeapSize<PayloadBucket<V>> {
+    static constexpr bool ownsHeap = true;
+    static size_t of(const PayloadBucket<V>& bucket) { return bucket.heapBytes(); }
+};
+
+// Shared core of AVLMultiset and AVLMultimap: an AVL tree with one node per
+// distinct key, each holding a Bucket of that key's entries (anything with
+// size() and empty()). Balance and depth depend only on the number of
+// distinct keys, however many entries pile up on one of them. Every node
+// also stores the number of entries in its subtree, so rank and select
+// count entries in O(log n). A bucket that becomes empty takes its node
+// out of the tree.
+template<typename K, typename Bucket, typename Stats = NoStats>
+class MultiTree {
+private:
+    struct Node {
+        K key;
+        int height{1};
+        size_t total{0};    // Entries in this subtree
+        std::unique_ptr<Node> left;
+        std::unique_ptr<Node> right;
+        Bucket bucket;
+
+        explicit Node(const K& k) : key(k) {}
+        Node(K&& k, Bucket&& b) : key(std::move(k)), bucket(std::move(b)) {}
+    };
+
+    std::unique_ptr<Node> root;
+    size_t distinct_{0};
+    [[no_unique_address]] mutable Stats stats_;
+
+    bool lessThan(const K& a, const K& b) const {
+        stats_.compare();
+        return a < b;
+    }
+
+    static int heightOf(const Node* node) {
+        return node ? node->height : 0;
+    }
+
+    static size_t totalOf(const Node* node) {
+        return node ? node->total : 0;
+    }
+
+    static int getBalance(const Node* node) {
+        return heightOf(node->left.get()) - heightOf(node->right.get());
+    }
+
+    void refresh(Node* node) {
+        stats_.heightUpdate();
+        node->height = 1 + std::max(heightOf(node->left.get()), heightOf(node->right.get()));
+        node->total = totalOf(node->left.get()) + totalOf(node->right.get()) + node->bucket.size();
+    }
+
+    std::unique_ptr<Node> rightRotate(std::unique_ptr<Node> y) {
+        auto x = std::move(y->left);
+        y->left = std::move(x->right);
+        refresh(y.get());
+        x->right = std::move(y);
+        refresh(x.get());
+        return x;
+    }
+
+    std::unique_ptr<Node> leftRotate(std::unique_ptr<Node> x) {
+        auto y = std::move(x->right);
+        x->right = std::move(y->left);
+        refresh(x.get());
+        y->left = std::move(x);
+        refresh(y.get());
+        return y;
+    }
+
+    // Recomputes height and total; rotates if the node is out of balance
+    std::unique_ptr<Node> balance(std::unique_ptr<Node> node) {
+        int oldHeight = node->height;
+        refresh(node.get());
+        int balance = getBalance(node.get());
+
+        if (balance > 1) {
+            stats_.retraceStep();
+            if (getBalance(node->left.get()) < 0) {
+                stats_.rotate(Rotation::LeftRight);
+                node->left = leftRotate(std::move(node->left));
+            } else {
+                stats_.rotate(Rotation::Right);
+            }
+            return rightRotate(std::move(node));
+        }
+
+        if (balance < -1) {
+            stats_.retraceStep();
+            if (getBalance(node->right.get()) > 0) {
+                stats_.rotate(Rotation::RightLeft);
+                node->right = rightRotate(std::move(node->right));
+            } else {
+                stats_.rotate(Rotation::Left);
+            }
+            return leftRotate(std::move(node));
+        }
+
+        if (node->height != oldHeight) stats_.retraceStep();
+        return node;
+    }
+
+    // Applies fn to key's bucket (creating the node first if create is set)
+    // and refreshes the totals on the way back up. Links stay in the tree
+    // throughout, so if fn throws the tree is left as it was.
+    template<typename Fn>
+    void update(std::unique_ptr<Node>& node, const K& key, bool create, Fn& fn, bool& found) {
+        if (!node) {
+            if (!create) return;
+            found = true;
+            auto created = std::make_unique<Node>(key);
+            fn(created->bucket);
+            if (created->bucket.empty()) return;
+            distinct_++;
+            refresh(created.get());
+            node = std::move(created);
+            return;
+        }
+
+        stats_.visit();
+        if (lessThan(key, node->key)) {
+            update(node->left, key, create, fn, found);
+        } else if (lessThan(node->key, key)) {
+            update(node->right, key, create, fn, found);
+        } else {
+            found = true;
+            fn(node->bucket);
+            if (node->bucket.empty()) {
+                node = unlink(std::move(node));
+                return;
+            }
+        }
+
+        node = balance(std::move(node));
+    }
+
+    // Takes node out of the tree, relinking its in-order successor into
+    // its position
+    std::unique_ptr<Node> unlink(std::unique_ptr<Node> node) {
+        distinct_--;
+        if (!node->left) return std::move(node->right);
+        if (!node->right) return std::move(node->left);
+
+        std::unique_ptr<Node> successor;
+        node->right = detachMin(std::move(node->right), successor);
+        successor->left = std::move(node->left);
+        successor->right = std::move(node->right);
+        return balance(std::move(successor));
+    }
+
+    std::unique_ptr<Node> detachMin(std::unique_ptr<Node> node, std::unique_ptr<Node>& min) {
+        stats_.visit();
+        if (!node->left) {
+            auto right = std::move(node->right);
+            min = std::move(node);
+            return right;
+        }
+        node->left = detachMin(std::move(node->left), min);
+        return balance(std::move(node));
+    }
+
+    std::unique_ptr<Node> clone(const Node* node) const {
+        if (!node) return nullptr;
+        auto copy = std::make_unique<Node>(node->key);
+        copy->bucket = node->bucket;
+        copy->height = node->height;
+        copy->total = node->total;
+        copy->left = clone(node->left.get());
+        copy->right = clone(node->right.get());
+        return copy;
+    }
+
+    // Perfectly balanced subtree from entries[lo, hi); no comparisons needed
+    std::unique_ptr<Node> buildBalanced(std::vector<std::pair<K, Bucket>>& entries, size_t lo, size_t hi) {
+        if (lo >= hi) return nullptr;
+        size_t mid = lo + (hi - lo) / 2;
+        auto node = std::make_unique<Node>(std::move(entries[mid].first), std::move(entries[mid].second));
+        node->left = buildBalanced(entries, lo, mid);
+        node->right = buildBalanced(entries, mid + 1, hi);
+        refresh(node.get());
+        return node;
+    }
+
+public:
+    // Upper bound on AVL height for up to 2^64 nodes (1.44 * log2(n + 2)).
+    static constexpr size_t MAX_HEIGHT = 96;
+
+    // In-order iterator over the distinct keys and their buckets
+    class iterator {
+    private:
+        friend class MultiTree;
+
+        const Node* stack_[MAX_HEIGHT]{};
+        size_t depth_{0};
+
+        void pushLeft(const Node* node) {
+            while (node) {
+                stack_[depth_++] = node;
+                node = node->left.get();
+            }
+        }
+
+    public:
+        iterator() = default;
+
+        explicit iterator(const Node* root) {
+            pushLeft(root);
+        }
+
+        const K& key() const { return stack_[depth_ - 1]->key; }
+        const Bucket& bucket() const { return stack_[depth_ - 1]->bucket; }
+
+        iterator& operator++() {
+            const Node* node = stack_[--depth_];
+            pushLeft(node->right.get());
+            return *this;
+        }
+
+        bool operator==(const iterator& other) const {
+            if (depth_ == 0 || other.depth_ == 0) return depth_ == other.depth_;
+            return stack_[depth_ - 1] == other.stack_[other.depth_ - 1];
+        }
+
+        bool operator!=(const iterator& other) const {
+            return !(*this == other);
+        }
+    };
+
+    MultiTree() = default;
+
+    MultiTree(const MultiTree& other) : root(clone(other.root.get())), distinct_(other.distinct_) {}
+
+    MultiTree(MultiTree&& other) noexcept : root(std::move(other.root)), distinct_(other.distinct_) {
+        other.distinct_ = 0;
+    }
+
+    MultiTree& operator=(const MultiTree& other) {
+        if (this != &other) {
+            MultiTree temp(other);
+            std::swap(root, temp.root);
+            std::swap(distinct_, temp.distinct_);
+        }
+        return *this;
+    }
+
+    MultiTree& operator=(MultiTree&& other) noexcept {
+        if (this != &other) {
+            root = std::move(other.root);
+            distinct_ = other.distinct_;
+            other.distinct_ = 0;
+        }
+        return *this;
+    }
+
+    iterator begin() const { return iterator(root.get()); }
+    iterator end() const { return iterator(); }
+
+    // Runs fn(Bucket&) on key's bucket, adding the key first if it is
+    // absent; O(log n) plus fn. The key is dropped if fn empties the bucket.
+    // fn must leave the bucket unchanged if it throws.
+    template<typename Fn>
+    void update(const K& key, Fn&& fn) {
+        bool found = false;
+        stats_.beginPath();
+        update(root, key, true, fn, found);
+        stats_.endPath();
+    }
+
+    // As update(), but only for a key already present; false otherwise
+    template<typename Fn>
+    bool updateExisting(const K& key, Fn&& fn) {
+        bool found = false;
+        stats_.beginPath();
+        update(root, key, false, fn, found);
+        stats_.endPath();
+        return found;
+    }
+
+    // Removes key and its whole bucket; returns how many entries went
+    size_t removeAll(const K& key) {
+        size_t removed = 0;
+        updateExisting(key, [&removed](Bucket& bucket) {
+            removed = bucket.size();
+            bucket = Bucket{};
+        });
+        return removed;
+    }
+
+    void clear() {
+        root.reset();
+        distinct_ = 0;
+    }
+
+    // key's bucket, or nullptr if the key is absent
+    const Bucket* find(const K& key) const {
+        stats_.beginPath();
+        const Node* current = root.get();
+        while (current) {
+            stats_.visit();
+            if (lessThan(key, current->key)) {
+                current = current->left.get();
+            } else if (lessThan(current->key, key)) {
+                current = current->right.get();
+            } else {
+                break;
+            }
+        }
+        stats_.endPath();
+        return current ? &current->bucket : nullptr;
+    }
+
+    // First key not less than key
+    iterator lower_bound(const K& key) const {
+        iterator it;
+        for (const Node* current = root.get(); current;) {
+            if (current->key < key) {
+                current = current->right.get();
+            } else {
+                it.stack_[it.depth_++] = current;
+                current = current->left.get();
+            }
+        }
+        return it;
+    }
+
+    // First key greater than key
+    iterator upper_bound(const K& key) const {
+        iterator it;
+        for (const Node* current = root.get(); current;) {
+            if (key < current->key) {
+                it.stack_[it.depth_++] = current;
+                current = current->left.get();
+            } else {
+                current = current->right.get();
+            }
+        }
+        return it;
+    }
+
+    // Number of entries with keys less than key, O(log n)
+    size_t rank(const K& key) const {
+        size_t result = 0;
+        for (const Node* current = root.get(); current;) {
+            if (current->key < key) {
+                result += totalOf(current->left.get()) + current->bucket.size();
+                current = current->right.get();
+            } else {
+                current = current->left.get();
+            }
+        }
+        return result;
+    }
+
+    // The node holding the entry with k entries before it (0-based), and
+    // that entry's position in its bucket; O(log n)
+    std::pair<iterator, size_t> select(size_t k) const {
+        if (k >= size()) throw std::out_of_range("select index out of range");
+        iterator it;
+        const Node* current = root.get();
+        for (;;) {
+            size_t left = totalOf(current->left.get());
+            if (k < left) {
+                it.stack_[it.depth_++] = current;
+                current = current->left.get();
+            } else if (k - left < current->bucket.size()) {
+                it.stack_[it.depth_++] = current;
+                return {it, k - left};
+            } else {
+                k -= left + current->bucket.size();
+                current = current->right.get();
+            }
+        }
+    }
+
+    // Entries, counting every one in every bucket
+    size_t size() const { return totalOf(root.get()); }
+    size_t distinct() const { return distinct_; }
+    bool empty() const { return !root; }
+
+    // Stored height of the root; 0 when empty
+    int height() const { return heightOf(root.get()); }
+
+    // Heights, totals, AVL balance, key order and non-empty buckets all
+    // check out; O(n), for tests
+    bool verify() const {
+        std::function<bool(const Node*, const K*, const K*)> check =
+            [&check](const Node* node, const K* low, const K* high) {
+                if (!node) return true;
+                if ((low && !(*low < node->key)) || (high && !(node->key < *high))) return false;
+                const Node* left = node->left.get();
+                const Node* right = node->right.get();
+                if (node->bucket.empty() || std::abs(heightOf(left) - heightOf(right)) > 1) return false;
+                if (node->height != 1 + std::max(heightOf(left), heightOf(right))) return false;
+                if (node->total != totalOf(left) + totalOf(right) + node->bucket.size()) return false;
+                return check(left, low, &node->key) && check(right, &node->key, high);
+            };
+        size_t nodes = 0;
+        scanInorder([&nodes](const K&, const Bucket&) { nodes++; });
+        return nodes == distinct_ && check(root.get(), nullptr, nullptr);
+    }
+
+    // Structural counters for updates and lookups (TreeStats only)
+    const Stats& stats() const { return stats_; }
+    void resetStats() { stats_.reset(); }
+
+    // One allocation per distinct key, plus heap owned by keys and buckets
+    MemoryUsage memory_usage() const {
+        MemoryUsage usage = memory::nodeAllocations(distinct_, sizeof(Node));
+        if constexpr (HeapSize<K>::ownsHeap || HeapSize<Bucket>::ownsHeap) {
+            scanInorder([&usage](const K& key, const Bucket& bucket) {
+                usage.payloadHeapBytes += HeapSize<K>::of(key) + HeapSize<Bucket>::of(bucket);
+            });
+        }
+        return usage;
+    }
+
+    // Replaces the contents with non-empty buckets under sorted, unique keys, O(n)
+    void assignSorted(std::vector<std::pair<K, Bucket>> entries) {
+        root = buildBalanced(entries, 0, entries.size());
+        distinct_ = entries.size();
+    }
+
+    // Read-only traversal of (key, bucket): no recursion, no heap
+    template<typename Callback>
+    void scanInorder(Callback&& callback) const {
+        const Node* stack[MAX_HEIGHT];
+        size_t depth = 0;
+        const Node* current = root.get();
+        while (current || depth > 0) {
+            while (current) {
+                stack[depth++] = current;
+                current = current->left.get();
+            }
+            current = stack[--depth];
+            callback(current->key, current->bucket);
+            current = current->right.get();
+        }
+    }
+};
+
+// Ordered multiset: AVLTree's interface, but inserting a value that is
+// already present adds a copy instead of being ignored. Equal values share
+// one node with a count, so n copies cost one node and the tree's depth
+// depends on distinct values only. Iteration yields each value as many
+// times as it was inserted; rank/select count copies too.
+template<typename T, typename Stats = NoStats>
+class AVLMultiset {
+private:
+    using Tree = MultiTree<T, CopyCount, Stats>;
+
+    Tree tree_;
+
+public:
+    // In-order iterator over every copy
+    class iterator {
+    private:
+        friend class AVLMultiset;
+
+        typename Tree::iterator node_;
+        size_t copy_{0};
+
+        iterator(typename Tree::iterator node, size_t copy) : node_(node), copy_(copy) {}
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const T*;
+        using reference = const T&;
+
+        iterator() = default;
+
+        reference operator*() const { return node_.key(); }
+        pointer operator->() const { return &node_.key(); }
+
+        iterator& operator++() {
+            if (++copy_ == node_.bucket().size()) {
+                ++node_;
+                copy_ = 0;
+            }
+            return *this;
+        }
+
+        iterator operator++(int) {
+            iterator tmp = *this;
+            ++(*this);
+            return tmp;
+        }
+
+        bool operator==(const iterator& other) const {
+            return node_ == other.node_ && copy_ == other.copy_;
+        }
+
+        bool operator!=(const iterator& other) const {
+            return !(*this == other);
+        }
+    };
+
+    static constexpr size_t MAX_COPIES = std::numeric_limits<uint32_t>::max();
+
+    iterator begin() const { return iterator(tree_.begin(), 0); }
+    iterator end() const { return iterator(tree_.end(), 0); }
+
+    // Adds copies of value (one by default), O(log n)
+    void insert(const T& value, size_t copies = 1) {
+        if (copies == 0) return;
+        tree_.update(value, [copies](CopyCount& count) {
+            if (copies > MAX_COPIES - count.copies) throw std::length_error("Too many copies of one value");
+            count.copies += static_cast<uint32_t>(copies);
+        });
+    }
+
+    // Removes one copy of value; false if there was none
+    bool remove(const T& value) {
+        return tree_.updateExisting(value, [](CopyCount& count) { count.copies--; });
+    }
+
+    // Removes every copy of value; returns how many there were
+    size_t removeAll(const T& value) {
+        return tree_.removeAll(value);
+    }
+
+    void clear() { tree_.clear(); }
+
+    size_t count(const T& value) const {
+        const CopyCount* found = tree_.find(value);
+        return found ? found->copies : 0;
+    }
+
+    bool contains(const T& value) const { return tree_.find(value) != nullptr; }
+
+    // First copy of the first value not less than value
+    iterator lower_bound(const T& value) const { return iterator(tree_.lower_bound(value), 0); }
+
+    // First copy of the first value greater than value
+    iterator upper_bound(const T& value) const { return iterator(tree_.upper_bound(value), 0); }
+
+    // Number of copies less than value, O(log n)
+    size_t rank(const T& value) const { return tree_.rank(value); }
+
+    // The element with k smaller copies before it (0-based), O(log n)
+    const T& select(size_t k) const { return tree_.select(k).first.key(); }
+
+    // Number of copies in [low, high)
+    size_t countRange(const T& low, const T& high) const {
+        if (!(low < high)) return 0;
+        return rank(high) - rank(low);
+    }
+
+    // Every copy counts
+    size_t size() const { return tree_.size(); }
+    size_t distinct() const { return tree_.distinct(); }
+    bool empty() const { return tree_.empty(); }
+
+    // Stored height of the root, which depends on distinct() only
+    int height() const { return tree_.height(); }
+
+    bool verify() const { return tree_.verify(); }
+
+    const Stats& stats() const { return tree_.stats(); }
+    void resetStats() { tree_.resetStats(); }
+
+    // One node per distinct value; key heap bytes need a HeapSize<T> specialization
+    MemoryUsage memory_usage() const { return tree_.memory_usage(); }
+
+    // Replaces the contents with values in sorted order, duplicates allowed, O(n)
+    void assignSorted(std::vector<T> values) {
+        std::vector<std::pair<T, CopyCount>> runs;
+        for (T& value : values) {
+            if (runs.empty() || runs.back().first < value) {
+                runs.emplace_back(std::move(value), CopyCount{0});
+            }
+            if (runs.back().second.copies == MAX_COPIES) throw std::length_error("Too many copies of one value");
+            runs.back().second.copies++;
+        }
+        tree_.assignSorted(std::move(runs));
+    }
+
+    // Binary snapshot (see Serialize.h): every copy in order, so a value
+    // with n copies is written n times
+    void save(std::ostream& out) const {
+        snapshot::writeHeader<T>(out, size());
+        snapshot::KeyWriter<T> writer(out);
+        scanInorder(writer);
+        writer.finish();
+        if (!out) throw std::runtime_error("Failed to write snapshot");
+    }
+
+    void load(std::istream& in) {
+        uint64_t count = snapshot::readHeader<T>(in);
+        assignSorted(snapshot::readKeys<T>(in, count, true));
+    }
+
+    // Traversal with Callback Func, once per copy
+    void inorder(const std::function<void(const T&)>& callback) const {
+        scanInorder(callback);
+    }
+
+    template<typename Callback>
+    void scanInorder(Callback&& callback) const {
+        tree_.scanInorder([&callback](const T& value, const CopyCount& count) {
+            for (uint32_t i = 0; i < count.copies; i++) callback(value);
+        });
+    }
+};
+
+// Ordered multimap: any number of payloads per key, kept in insertion
+// order in a PayloadBucket inside the key's node. Adding a payload is
+// O(log n) (n distinct keys) however many the key already has, and the
+// tree's depth ignores how entries are spread over keys, so hot keys (a
+// busy price level, say) neither slow updates nor unbalance the tree.
+// Removing one particular payload searches its key's bucket, unless the
+// caller tracks positions and uses removeAt. Entries are ordered by key,
+// then insertion (until removeAt reorders a key's payloads); rank/select
+// count entries.
+template<typename K, typename V, typename Stats = NoStats>
+class AVLMultimap {
+private:
+    using Bucket = PayloadBucket<V>;
+    using Tree = MultiTree<K, Bucket, Stats>;
+
+    Tree tree_;
+
+public:
+    // In-order iterator over every entry; *it is a pair of references
+    class iterator {
+    private:
+        friend class AVLMultimap;
+
+        typename Tree::iterator node_;
+        size_t index_{0};
+
+        iterator(typename Tree::iterator node, size_t index) : node_(node), index_(index) {}
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = std::pair<const K&, const V&>;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = std::pair<const K&, const V&>;
+
+        iterator() = default;
+
+        const K& key() const { return node_.key(); }
+        const V& value() const { return node_.bucket()[index_]; }
+
+        reference operator*() const { return {key(), value()}; }
+
+        iterator& operator++() {
+            if (++index_ == node_.bucket().size()) {
+                ++node_;
+                index_ = 0;
+            }
+            return *this;
+        }
+
+        iterator operator++(int) {
+            iterator tmp = *this;
+            ++(*this);
+            return tmp;
+        }
+
+        bool operator==(const iterator& other) const {
+            return node_ == other.node_ && index_ == other.index_;
+        }
+
+        bool operator!=(const iterator& other) const {
+            return !(*this == other);
+        }
+    };
+
+    iterator begin() const { return iterator(tree_.begin(), 0); }
+    iterator end() const { return iterator(tree_.end(), 0); }
+
+    // Adds a payload under key, after any it already has; returns its
+    // position in key's bucket
+    size_t insert(const K& key, V value) {
+        size_t position = 0;
+        tree_.update(key, [&](Bucket& bucket) {
+            position = bucket.size();
+            bucket.push_back(std::move(value));
+        });
+        return position;
+    }
+
+    // Removes the payload at position in key's bucket by moving the key's
+    // last payload there: O(log n) however many payloads share the key.
+    // False if there is no such payload.
+    bool removeAt(const K& key, size_t position) {
+        bool removed = false;
+        tree_.updateExisting(key, [&](Bucket& bucket) {
+            if (position >= bucket.size()) return;
+            bucket.swapErase(position);
+            removed = true;
+        });
+        return removed;
+    }
+
+    // Removes the first payload under key equal to value; false if none
+    bool remove(const K& key, const V& value) {
+        bool removed = false;
+        tree_.updateExisting(key, [&](Bucket& bucket) {
+            size_t i = bucket.find(value);
+            if (i == bucket.size()) return;
+            bucket.erase(i);
+            removed = true;
+        });
+        return removed;
+    }
+
+    // Removes key with all its payloads; returns how many there were
+    size_t removeAll(const K& key) {
+        return tree_.removeAll(key);
+    }
+
+    void clear() { tree_.clear(); }
+
+    // Payloads under key in insertion order, or nullptr if there are none
+    const Bucket* find(const K& key) const { return tree_.find(key); }
+
+    size_t count(const K& key) const {
+        const Bucket* found = tree_.find(key);
+        return found ? found->size() : 0;
+    }
+
+    bool contains(const K& key) const { return tree_.find(key) != nullptr; }
+
+    // First entry whose key is not less than key
+    iterator lower_bound(const K& key) const { return iterator(tree_.lower_bound(key), 0); }
+
+    // First entry whose key is greater than key
+    iterator upper_bound(const K& key) const { return iterator(tree_.upper_bound(key), 0); }
+
+    // Number of entries with keys less than key, O(log n)
+    size_t rank(const K& key) const { return tree_.rank(key); }
+
+    // The entry with k entries before it (0-based), O(log n)
+    iterator select(size_t k) const {
+        auto [node, index] = tree_.select(k);
+        return iterator(node, index);
+    }
+
+    // Number of entries with keys in [low, high)
+    size_t countRange(const K& low, const K& high) const {
+        if (!(low < high)) return 0;
+        return rank(high) - rank(low);
+    }
+
+    // Every payload counts
+    size_t size() const { return tree_.size(); }
+    size_t distinct() const { return tree_.distinct(); }
+    bool empty() const { return tree_.empty(); }
+
+    // Stored height of the root, which depends on distinct() only
+    int height() const { return tree_.height(); }
+
+    bool verify() const { return tree_.verify(); }
+
+    const Stats& stats() const { return tree_.stats(); }
+    void resetStats() { tree_.resetStats(); }
+
+    // One node per distinct key, plus spilled payloads
+    MemoryUsage memory_usage() const { return tree_.memory_usage(); }
+
+    // Binary snapshot (see Serialize.h): the header for K, then each entry's
+    // key followed by its payload; K and V need a ds::Serializer
+    void save(std::ostream& out) const {
+        snapshot::writeHeader<K>(out, size());
+        scanInorder([&out](const K& key, const V& value) {
+            Serializer<K>::write(out, key);
+            Serializer<V>::write(out, value);
+        });
+        if (!out) throw std::runtime_error("Failed to write snapshot");
+    }
+
+    // Rebuilds a balanced multimap from a snapshot in O(n)
+    void load(std::istream& in) {
+        uint64_t count = snapshot::readHeader<K>(in);
+        std::vector<std::pair<K, Bucket>> runs;
+        for (uint64_t i = 0; i < count && in; i++) {
+            K key = Serializer<K>::read(in);
+            if (in && !runs.empty()) snapshot::requireOrder(runs.back().first, key, true);
+            if (runs.empty() || runs.back().first < key) runs.emplace_back(std::move(key), Bucket{});
+            runs.back().second.push_back(Serializer<V>::read(in));
+        }
+        if (!in) throw std::runtime_error("Truncated snapshot");
+        tree_.assignSorted(std::move(runs));
+    }
+
+    // Traversal with Callback Func, once per entry
+    void inorder(const std::function<void(const K&, const V&)>& callback) const {
+        scanInorder(callback);
+    }
+
+    template<typename Callback>
+    void scanInorder(Callback&& callback) const {
+        tree_.scanInorder([&callback](const K& key, const Bucket& bucket) {
+            for (size_t i = 0; i < bucket.size(); i++) callback(key, bucket[i]);
+        });
+    }
+};
+
+}
+
+#endif
@@ -0,0 +1,195 @@
+#ifndef SERIALIZE_H
+#define SERIALIZE_H
+
+#include <algorithm>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace ds {
+
+// Binary encoding of a single value. Specialize for your own key types:
+//   static void write(std::ostream&, const T&);
+//   static T read(std::istream&);
+// Setting fixedSize to sizeof(T) lets whole key arrays be copied in one go.
+template<typename T, typename Enable = void>
+struct Serializer;
+
+template<typename T>
+struct Serializer<T, std::enable_if_t<std::is_arithmetic_v<T>>> {
+    static constexpr uint32_t fixedSize = sizeof(T);
+
+    static void write(std::ostream& out, const T& value) {
+        out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    static T read(std::istream& in) {
+        T value{};
+        in.read(reinterpret_cast<char*>(&value), sizeof(T));
+        return value;
+    }
+};
+
+template<>
+struct Serializer<std::string> {
+    static constexpr uint32_t fixedSize = 0;
+
+    static void write(std::ostream& out, const std::string& value) {
+        if (value.size() > UINT32_MAX) throw std::length_error("String too long to serialize");
+        uint32_t length = static_cast<uint32_t>(value.size());
+        out.write(reinterpret_cast<const char*>(&length), sizeof(length));
+        out.write(value.data(), length);
+    }
+
+    static std::string read(std::istream& in) {
+        uint32_t length = 0;
+        in.read(reinterpret_cast<char*>(&length), sizeof(length));
+        // Grow with the data actually read, so a corrupt length fails on
+        // the missing bytes instead of a 4 GB allocation
+        std::string value;
+        while (in && value.size() < length) {
+            size_t offset = value.size();
+            size_t chunk = std::min<size_t>(length - offset, 1 << 16);
+            value.resize(offset + chunk);
+            in.read(value.data() + offset, static_cast<std::streamsize>(chunk));
+        }
+        return value;
+    }
+};
+
+namespace snapshot {
+
+// Layout: magic, version, byte-order mark, key size (0 = variable), key
+// kind, count, then every key in sorted order. Sorted keys are enough to
+// rebuild a perfectly balanced tree in O(n) without rotations; loading
+// checks the order in the same pass, since the trees trust it.
+constexpr char MAGIC[4] = {'D', 'S', 'N', 'P'};
+constexpr uint32_t VERSION = 2;
+constexpr uint32_t ENDIAN_MARK = 0x01020304;
+
+// Keys are allocated at most this many ahead of the data that fills them
+constexpr uint64_t READ_CHUNK = 1 << 16;
+
+// Recorded next to the key size, so keys of equal size but another type
+// (int32_t, uint32_t, float) are rejected instead of reinterpreted
+enum class KeyKind : uint32_t { Other = 0, Unsigned = 1, Signed = 2, Floating = 3, String = 4 };
+
+template<typename T>
+constexpr uint32_t keySize() {
+    if constexpr (requires { Serializer<T>::fixedSize; }) {
+        return Serializer<T>::fixedSize;
+    } else {
+        return 0;
+    }
+}
+
+template<typename T>
+constexpr KeyKind keyKind() {
+    if constexpr (std::is_floating_point_v<T>) {
+        return KeyKind::Floating;
+    } else if constexpr (std::is_integral_v<T>) {
+        return std::is_signed_v<T> ? KeyKind::Signed : KeyKind::Unsigned;
+    } else if constexpr (std::is_same_v<T, std::string>) {
+        return KeyKind::String;
+    } else {
+        return KeyKind::Other;
+    }
+}
+
+template<typename T>
+void writeHeader(std::ostream& out, uint64_t count) {
+    const uint32_t fields[4] = {VERSION, ENDIAN_MARK, keySize<T>(), static_cast<uint32_t>(keyKind<T>())};
+    out.write(MAGIC, sizeof(MAGIC));
+    out.write(reinterpret_cast<const char*>(fields), sizeof(fields));
+    out.write(reinterpret_cast<const char*>(&count), sizeof(count));
+}
+
+template<typename T>
+uint64_t readHeader(std::istream& in) {
+    char magic[4];
+    uint32_t fields[4] = {};
+    uint64_t count = 0;
+    in.read(magic, sizeof(magic));
+    in.read(reinterpret_cast<char*>(fields), sizeof(fields));
+    in.read(reinterpret_cast<char*>(&count), sizeof(count));
+    if (!in || !std::equal(magic, magic + 4, MAGIC)) throw std::runtime_error("Not a tree snapshot");
+    if (fields[0] != VERSION) throw std::runtime_error("Unsupported snapshot version");
+    if (fields[1] != ENDIAN_MARK) throw std::runtime_error("Snapshot byte order mismatch");
+    if (fields[2] != keySize<T>() || fields[3] != static_cast<uint32_t>(keyKind<T>())) {
+        throw std::runtime_error("Snapshot key type mismatch");
+    }
+    return count;
+}
+
+// Throws unless key sorts after previous (or, where duplicates are allowed,
+// not before it), so a corrupt or hand-edited file cannot build a tree
+// that lookups would search wrongly
+template<typename T>
+void requireOrder(const T& previous, const T& key, bool duplicates = false) {
+    if (duplicates ? key < previous : !(previous < key)) {
+        throw std::runtime_error("Snapshot keys out of order");
+    }
+}
+
+// Streams keys out in order, batching fixed-size keys into large writes.
+// Call finish() once all keys have been added.
+template<typename T>
+class KeyWriter {
+public:
+    explicit KeyWriter(std::ostream& out) : out_(out) {}
+
+    void operator()(const T& key) {
+        if constexpr (std::is_trivially_copyable_v<T> && keySize<T>() == sizeof(T)) {
+            buffer_.push_back(key);
+            if (buffer_.size() == BATCH) finish();
+        } else {
+            Serializer<T>::write(out_, key);
+        }
+    }
+
+    void finish() {
+        out_.write(reinterpret_cast<const char*>(buffer_.data()),
+                   static_cast<std::streamsize>(buffer_.size() * sizeof(T)));
+        buffer_.clear();
+    }
+
+private:
+    static constexpr size_t BATCH = 4096;
+    std::ostream& out_;
+    std::vector<T> buffer_;
+};
+
+// Reads count keys; trivially copyable fixed-size keys are read in bulk.
+// Storage grows by READ_CHUNK keys as they arrive, so a corrupt count
+// ends in "Truncated snapshot" rather than a huge up-front allocation.
+// The keys must be strictly increasing, or non-decreasing with duplicates.
+template<typename T>
+std::vector<T> readKeys(std::istream& in, uint64_t count, bool duplicates = false) {
+    std::vector<T> keys;
+    if constexpr (std::is_trivially_copyable_v<T> && keySize<T>() == sizeof(T)) {
+        for (uint64_t done = 0; done < count && in;) {
+            size_t chunk = static_cast<size_t>(std::min(count - done, READ_CHUNK));
+            keys.resize(done + chunk);
+            in.read(reinterpret_cast<char*>(keys.data() + done), static_cast<std::streamsize>(chunk * sizeof(T)));
+            done += chunk;
+        }
+    } else {
+        keys.reserve(std::min(count, READ_CHUNK));
+        for (uint64_t i = 0; i < count && in; i++) {
+            keys.push_back(Serializer<T>::read(in));
+        }
+    }
+    if (!in) throw std::runtime_error("Truncated snapshot");
+    for (size_t i = 1; i < keys.size(); i++) requireOrder(keys[i - 1], keys[i], duplicates);
+    return keys;
+}
+
+}
+
+}
+
+#endif
@@ -0,0 +1,269 @@
+#ifndef SMALLTREE_H
+#define SMALLTREE_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <istream>
+#include <iterator>
+#include <ostream>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+#include "AVL.h"
+#include "MemoryUsage.h"
+#include "Serialize.h"
+
+namespace ds {
+
+// Ordered set with AVLTree's interface for the common case of a few keys.
+// Up to N keys are kept sorted in an array inside the object, so a small
+// set costs no heap allocation and a lookup is one pass over contiguous
+// keys (a branch-free count the compiler vectorizes for numeric keys).
+// The insert that would make it N + 1 keys promotes the set to an
+// AVLTree; once removes bring that down to N / 2 it is demoted again. The
+// gap keeps a set hovering around N from converting on every operation.
+// T must be default constructible, like BTree's.
+template<typename T, size_t N = 32>
+class SmallTree {
+    static_assert(N >= 2, "SmallTree needs room for at least two inline keys");
+
+private:
+    struct Inline {
+        uint32_t count{0};
+        T items[N];
+    };
+
+    using Tree = AVLTree<T>;
+
+    std::variant<Inline, Tree> storage_;
+
+    // Position of the first inline key not less than value
+    static size_t lowerIndex(const Inline& small, const T& value) {
+        if constexpr (std::is_arithmetic_v<T>) {
+            size_t result = 0;
+            for (size_t i = 0; i < small.count; i++) result += small.items[i] < value;
+            return result;
+        } else {
+            return std::lower_bound(small.items, small.items + small.count, value) - small.items;
+        }
+    }
+
+    static bool equalAt(const Inline& small, size_t pos, const T& value) {
+        return pos < small.count && !(value < small.items[pos]);
+    }
+
+    void promote(const T& value, size_t pos) {
+        Inline& small = std::get<Inline>(storage_);
+        std::vector<T> keys;
+        keys.reserve(N + 1);
+        std::move(small.items, small.items + pos, std::back_inserter(keys));
+        keys.push_back(value);
+        std::move(small.items + pos, small.items + small.count, std::back_inserter(keys));
+        Tree tree;
+        tree.assignSorted(std::move(keys));
+        storage_ = std::move(tree);
+    }
+
+    void demote() {
+        Inline small;
+        std::get<Tree>(storage_).scanInorder([&small](const T& key) { small.items[small.count++] = key; });
+        storage_ = std::move(small);
+    }
+
+public:
+    // In-order iterator: a position in the inline array or an AVLTree
+    // iterator, whichever the set is using
+    class iterator {
+    private:
+        friend class SmallTree;
+
+        std::variant<const T*, typename Tree::iterator> it_;
+
+        explicit iterator(const T* item) : it_(item) {}
+        explicit iterator(typename Tree::iterator it) : it_(std::move(it)) {}
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const T*;
+        using reference = const T&;
+
+        iterator() = default;
+
+        reference operator*() const {
+            return it_.index() == 0 ? *std::get<0>(it_) : *std::get<1>(it_);
+        }
+
+        pointer operator->() const { return &**this; }
+
+        iterator& operator++() {
+            if (it_.index() == 0) {
+                ++std::get<0>(it_);
+            } else {
+                ++std::get<1>(it_);
+            }
+            return *this;
+        }
+
+        iterator operator++(int) {
+            iterator tmp = *this;
+            ++(*this);
+            return tmp;
+        }
+
+        bool operator==(const iterator& other) const {
+            return it_ == other.it_;
+        }
+
+        bool operator!=(const iterator& other) const {
+            return !(*this == other);
+        }
+    };
+
+    static constexpr size_t INLINE_CAPACITY = N;
+
+    SmallTree() = default;
+
+    iterator begin() const {
+        if (const Inline* small = std::get_if<Inline>(&storage_)) return iterator(small->items);
+        return iterator(std::get<Tree>(storage_).begin());
+    }
+
+    iterator end() const {
+        if (const Inline* small = std::get_if<Inline>(&storage_)) return iterator(small->items + small->count);
+        return iterator(std::get<Tree>(storage_).end());
+    }
+
+    void insert(const T& value) {
+        if (Tree* tree = std::get_if<Tree>(&storage_)) {
+            tree->insert(value);
+            return;
+        }
+        Inline& small = std::get<Inline>(storage_);
+        size_t pos = lowerIndex(small, value);
+        if (equalAt(small, pos, value)) return; // Duplicate value
+        if (small.count == N) {
+            promote(value, pos);
+            return;
+        }
+        std::move_backward(small.items + pos, small.items + small.count, small.items + small.count + 1);
+        small.items[pos] = value;
+        small.count++;
+    }
+
+    bool remove(const T& value) {
+        if (Tree* tree = std::get_if<Tree>(&storage_)) {
+            if (!tree->remove(value)) return false;
+            if (tree->size() <= N / 2) demote();
+            return true;
+        }
+        Inline& small = std::get<Inline>(storage_);
+        size_t pos = lowerIndex(small, value);
+        if (!equalAt(small, pos, value)) return false;
+        std::move(small.items + pos + 1, small.items + small.count, small.items + pos);
+        small.count--;
+        return true;
+    }
+
+    void clear() {
+        storage_ = Inline{};
+    }
+
+    // First element not less than value
+    iterator lower_bound(const T& value) const {
+        if (const Inline* small = std::get_if<Inline>(&storage_)) return iterator(small->items + lowerIndex(*small, value));
+        return iterator(std::get<Tree>(storage_).lower_bound(value));
+    }
+
+    // First element greater than value
+    iterator upper_bound(const T& value) const {
+        if (const Inline* small = std::get_if<Inline>(&storage_)) {
+            size_t pos = lowerIndex(*small, value);
+            return iterator(small->items + pos + (equalAt(*small, pos, value) ? 1 : 0));
+        }
+        return iterator(std::get<Tree>(storage_).upper_bound(value));
+    }
+
+    bool contains(const T& value) const {
+        if (const Inline* small = std::get_if<Inline>(&storage_)) return equalAt(*small, lowerIndex(*small, value), value);
+        return std::get<Tree>(storage_).contains(value);
+    }
+
+    size_t size() const {
+        if (const Inline* small = std::get_if<Inline>(&storage_)) return small->count;
+        return std::get<Tree>(storage_).size();
+    }
+
+    bool empty() const { return size() == 0; }
+
+    // True while the keys live in the inline array
+    bool isInline() const { return std::holds_alternative<Inline>(storage_); }
+
+    // The tree's height once promoted; an inline set counts as one level
+    int height() const {
+        if (const Inline* small = std::get_if<Inline>(&storage_)) return small->count > 0 ? 1 : 0;
+        return std::get<Tree>(storage_).height();
+    }
+
+    // Inline keys cost no heap; key heap bytes need a HeapSize<T> specialization
+    MemoryUsage memory_usage() const {
+        if (const Tree* tree = std::get_if<Tree>(&storage_)) return tree->memory_usage();
+        MemoryUsage usage;
+        usage.nodes = size();
+        if constexpr (HeapSize<T>::ownsHeap) {
+            scanInorder([&usage](const T& value) { usage.payloadHeapBytes += HeapSize<T>::of(value); });
+        }
+        return usage;
+    }
+
+    // Replaces the contents with keys that are already sorted and unique, O(n)
+    void assignSorted(std::vector<T> keys) {
+        if (keys.size() > N) {
+            Tree tree;
+            tree.assignSorted(std::move(keys));
+            storage_ = std::move(tree);
+            return;
+        }
+        Inline small;
+        std::move(keys.begin(), keys.end(), small.items);
+        small.count = static_cast<uint32_t>(keys.size());
+        storage_ = std::move(small);
+    }
+
+    // Binary snapshot (see Serialize.h); T needs a ds::Serializer
+    void save(std::ostream& out) const {
+        snapshot::writeHeader<T>(out, size());
+        snapshot::KeyWriter<T> writer(out);
+        scanInorder(writer);
+        writer.finish();
+        if (!out) throw std::runtime_error("Failed to write snapshot");
+    }
+
+    void load(std::istream& in) {
+        uint64_t count = snapshot::readHeader<T>(in);
+        assignSorted(snapshot::readKeys<T>(in, count));
+    }
+
+    // Traversal with Callback Func
+    void inorder(const std::function<void(const T&)>& callback) const {
+        scanInorder(callback);
+    }
+
+    template<typename Callback>
+    void scanInorder(Callback&& callback) const {
+        if (const Inline* small = std::get_if<Inline>(&storage_)) {
+            for (size_t i = 0; i < small->count; i++) callback(small->items[i]);
+        } else {
+            std::get<Tree>(storage_).scanInorder(callback);
+        }
+    }
+};
+
+}
+
+#endif
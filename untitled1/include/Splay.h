@@ -0,0 +1,408 @@
+#ifndef SPLAY_H
+#define SPLAY_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <istream>
+#include <iterator>
+#include <ostream>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include "MemoryUsage.h"
+#include "Serialize.h"
+#include "TreeStats.h"
+
+namespace ds {
+
+// Self-adjusting ordered set with the same set API as AVLTree. Every access
+// moves the key to the root (Sleator and Tarjan's top-down splay), so a
+// skewed workload runs in time close to log(working set) per operation
+// instead of log n, while a uniform one pays for the restructuring.
+// With splayEvery = k only every k-th lookup splays, which cuts the writes a
+// read-mostly workload does to hot nodes; the rest are plain descents.
+// Inserts and removes always splay.
+//
+// contains() restructures the tree although it is const, so unlike AVLTree
+// concurrent readers need external locking. Operations are O(log n)
+// amortized, but a single one can be O(n); nothing recurses on the depth.
+template<typename T, typename Stats = NoStats>
+class SplayTree {
+private:
+    struct Node {
+        T data;
+        Node* left{nullptr};
+        Node* right{nullptr};
+
+        explicit Node(const T& value) : data(value) {}
+    };
+
+    mutable Node* root_{nullptr};
+    size_t size_{0};
+    unsigned splayEvery_{1};
+    mutable unsigned accesses_{0};
+    [[no_unique_address]] mutable Stats stats_;
+
+    static void destroy(Node* node) {
+        while (node) {
+            // Turn the left subtree into a right spine, then free top-down
+            if (node->left) {
+                Node* left = node->left;
+                node->left = left->right;
+                left->right = node;
+                node = left;
+            } else {
+                Node* right = node->right;
+                delete node;
+                node = right;
+            }
+        }
+    }
+
+    // Balanced subtree from the next count keys of a sorted sequence
+    template<typename Iterator>
+    static Node* build(Iterator& it, size_t count) {
+        if (count == 0) return nullptr;
+        size_t leftCount = count / 2;
+        Node* left = build(it, leftCount);
+        Node* node = new Node(*it);
+        ++it;
+        node->left = left;
+        node->right = build(it, count - leftCount - 1);
+        return node;
+    }
+
+    // Top-down splay of value (or the last node on its search path) to the
+    // root. Nodes left of the path collect in a tree L linked through
+    // leftHook, nodes right of it in R through rightHook; both become the new
+    // root's subtrees.
+    Node* splay(Node* node, const T& value) const {
+        if (!node) return nullptr;
+        Node* leftTree = nullptr;
+        Node* rightTree = nullptr;
+        Node** leftHook = &leftTree;      // Empty right link of L's maximum
+        Node** rightHook = &rightTree;    // Empty left link of R's minimum
+
+        stats_.beginPath();
+        for (;;) {
+            stats_.visit();
+            stats_.compare();
+            if (value < node->data) {
+                if (!node->left) break;
+                stats_.compare();
+                if (value < node->left->data) {
+                    stats_.rotate(Rotation::Right);
+                    Node* child = node->left;
+                    node->left = child->right;
+                    child->right = node;
+                    node = child;
+                    if (!node->left) break;
+                }
+                *rightHook = node;
+                rightHook = &node->left;
+                node = node->left;
+                continue;
+            }
+            stats_.compare();
+            if (node->data < value) {
+                if (!node->right) break;
+                stats_.compare();
+                if (node->right->data < value) {
+                    stats_.rotate(Rotation::Left);
+                    Node* child = node->right;
+                    node->right = child->left;
+                    child->left = node;
+                    node = child;
+                    if (!node->right) break;
+                }
+                *leftHook = node;
+                leftHook = &node->right;
+                node = node->right;
+                continue;
+            }
+            break;
+        }
+        stats_.endPath();
+
+        *leftHook = node->left;
+        *rightHook = node->right;
+        node->left = leftTree;
+        node->right = rightTree;
+        return node;
+    }
+
+    // Plain descent, no restructuring
+    const Node* find(const T& value) const {
+        stats_.beginPath();
+        const Node* current = root_;
+        while (current) {
+            stats_.visit();
+            stats_.compare();
+            if (value < current->data) {
+                current = current->left;
+                continue;
+            }
+            stats_.compare();
+            if (current->data < value) {
+                current = current->right;
+                continue;
+            }
+            break;
+        }
+        stats_.endPath();
+        return current;
+    }
+
+public:
+    // In-order iterator. Splayed trees have no useful depth bound, so the
+    // ancestor stack lives on the heap. Any insert, remove or contains() may
+    // restructure the tree and invalidates iterators.
+    class iterator {
+    private:
+        friend class SplayTree;
+
+        std::vector<const Node*> stack_;
+
+        void pushLeft(const Node* node) {
+            while (node) {
+                stack_.push_back(node);
+                node = node->left;
+            }
+        }
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const T*;
+        using reference = const T&;
+
+        iterator() = default;
+
+        explicit iterator(const Node* root) {
+            pushLeft(root);
+        }
+
+        reference operator*() const { return stack_.back()->data; }
+        pointer operator->() const { return &stack_.back()->data; }
+
+        iterator& operator++() {
+            const Node* node = stack_.back();
+            stack_.pop_back();
+            pushLeft(node->right);
+            return *this;
+        }
+
+        iterator operator++(int) {
+            iterator tmp = *this;
+            ++(*this);
+            return tmp;
+        }
+
+        bool operator==(const iterator& other) const {
+            if (stack_.empty() || other.stack_.empty()) return stack_.empty() == other.stack_.empty();
+            return stack_.back() == other.stack_.back();
+        }
+
+        bool operator!=(const iterator& other) const {
+            return !(*this == other);
+        }
+    };
+
+    SplayTree() = default;
+
+    // splayEvery = k > 1 splays on every k-th lookup only
+    explicit SplayTree(unsigned splayEvery) : splayEvery_(splayEvery) {
+        if (splayEvery == 0) throw std::invalid_argument("splayEvery must be at least 1");
+    }
+
+    // Copies are rebuilt balanced; the access history is not copied
+    SplayTree(const SplayTree& other) : size_(other.size_), splayEvery_(other.splayEvery_) {
+        iterator it = other.begin();
+        root_ = build(it, other.size_);
+    }
+
+    SplayTree(SplayTree&& other) noexcept
+        : root_(std::exchange(other.root_, nullptr)), size_(std::exchange(other.size_, 0)),
+          splayEvery_(other.splayEvery_) {}
+
+    SplayTree& operator=(const SplayTree& other) {
+        if (this != &other) {
+            SplayTree temp(other);
+            std::swap(root_, temp.root_);
+            std::swap(size_, temp.size_);
+            splayEvery_ = other.splayEvery_;
+        }
+        return *this;
+    }
+
+    SplayTree& operator=(SplayTree&& other) noexcept {
+        if (this != &other) {
+            clear();
+            std::swap(root_, other.root_);
+            std::swap(size_, other.size_);
+            splayEvery_ = other.splayEvery_;
+        }
+        return *this;
+    }
+
+    ~SplayTree() { destroy(root_); }
+
+    iterator begin() const { return iterator(root_); }
+    iterator end() const { return iterator(); }
+
+    // Splays the new (or already present) key to the root
+    void insert(const T& value) {
+        root_ = splay(root_, value);
+        if (root_ && !(value < root_->data) && !(root_->data < value)) return;     // Duplicate value
+
+        Node* node = new Node(value);
+        if (root_) {
+            if (value < root_->data) {
+                node->left = root_->left;
+                node->right = root_;
+                root_->left = nullptr;
+            } else {
+                node->right = root_->right;
+                node->left = root_;
+                root_->right = nullptr;
+            }
+        }
+        root_ = node;
+        size_++;
+    }
+
+    // Splays the key to the root, then joins its subtrees under the largest
+    // key on the left
+    bool remove(const T& value) {
+        root_ = splay(root_, value);
+        if (!root_ || value < root_->data || root_->data < value) return false;
+
+        Node* node = root_;
+        if (!node->left) {
+            root_ = node->right;
+        } else {
+            root_ = splay(node->left, value);   // Every key there is smaller: max rises
+            root_->right = node->right;
+        }
+        delete node;
+        size_--;
+        return true;
+    }
+
+    void clear() {
+        destroy(root_);
+        root_ = nullptr;
+        size_ = 0;
+    }
+
+    // Splays the key (or its closest neighbour) on every splayEvery-th call
+    bool contains(const T& value) const {
+        if (++accesses_ < splayEvery_) return find(value) != nullptr;
+        accesses_ = 0;
+        root_ = splay(root_, value);
+        return root_ && !(value < root_->data) && !(root_->data < value);
+    }
+
+    // First element not less than value; does not splay
+    iterator lower_bound(const T& value) const {
+        iterator it;
+        for (const Node* current = root_; current;) {
+            if (current->data < value) {
+                current = current->right;
+            } else {
+                it.stack_.push_back(current);
+                current = current->left;
+            }
+        }
+        return it;
+    }
+
+    // First element greater than value; does not splay
+    iterator upper_bound(const T& value) const {
+        iterator it;
+        for (const Node* current = root_; current;) {
+            if (value < current->data) {
+                it.stack_.push_back(current);
+                current = current->left;
+            } else {
+                current = current->right;
+            }
+        }
+        return it;
+    }
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    unsigned splayEvery() const { return splayEvery_; }
+
+    // Real height, from an O(n) walk (no stored heights); 0 when empty
+    int height() const {
+        int result = 0;
+        std::vector<std::pair<const Node*, int>> pending;
+        if (root_) pending.emplace_back(root_, 1);
+        while (!pending.empty()) {
+            auto [node, depth] = pending.back();
+            pending.pop_back();
+            result = std::max(result, depth);
+            if (node->left) pending.emplace_back(node->left, depth + 1);
+            if (node->right) pending.emplace_back(node->right, depth + 1);
+        }
+        return result;
+    }
+
+    // Structural counters for the splays and plain lookups (TreeStats only).
+    // Rotations are the zig-zig steps; the links of a top-down splay are not
+    // counted.
+    const Stats& stats() const { return stats_; }
+    void resetStats() { stats_.reset(); }
+
+    // One heap allocation per node; key heap bytes need a HeapSize<T> specialization
+    MemoryUsage memory_usage() const {
+        MemoryUsage usage = memory::nodeAllocations(size_, sizeof(Node));
+        if constexpr (HeapSize<T>::ownsHeap) {
+            scanInorder([&usage](const T& value) { usage.payloadHeapBytes += HeapSize<T>::of(value); });
+        }
+        return usage;
+    }
+
+    // Replaces the contents with keys that are already sorted and unique, O(n)
+    void assignSorted(std::vector<T> keys) {
+        clear();
+        auto it = keys.cbegin();
+        root_ = build(it, keys.size());
+        size_ = keys.size();
+    }
+
+    // Binary snapshot (see Serialize.h); T needs a ds::Serializer
+    void save(std::ostream& out) const {
+        snapshot::writeHeader<T>(out, size_);
+        snapshot::KeyWriter<T> writer(out);
+        scanInorder(writer);
+        writer.finish();
+        if (!out) throw std::runtime_error("Failed to write snapshot");
+    }
+
+    // Rebuilds a balanced tree from a snapshot in O(n)
+    void load(std::istream& in) {
+        uint64_t count = snapshot::readHeader<T>(in);
+        assignSorted(snapshot::readKeys<T>(in, count));
+    }
+
+    // Traversal with Callback Func
+    void inorder(const std::function<void(const T&)>& callback) const {
+        scanInorder(callback);
+    }
+
+    template<typename Callback>
+    void scanInorder(Callback&& callback) const {
+        for (iterator it = begin(); it != end(); ++it) callback(*it);
+    }
+};
+
+}
+
+#endif
@@ -0,0 +1,321 @@
+#ifndef STRING_TREE_H
+#define STRING_TREE_H
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "MemoryUsage.h"
+
+namespace ds {
+
+// Append-only store of length-prefixed strings, addressed by 32-bit offsets.
+// Each distinct string is stored once: intern() looks it up in a hash index
+// of offsets first, so several trees may share one arena and a repeated
+// string costs one copy.
+class StringArena {
+public:
+    // Offset of value, appending it only if the arena doesn't hold it yet
+    uint32_t intern(std::string_view value) {
+        if ((count_ + 1) * 2 > index_.size()) growIndex();     // Load factor <= 1/2
+        size_t mask = index_.size() - 1;
+        size_t slot = std::hash<std::string_view>{}(value) & mask;
+        for (; index_[slot] != EMPTY; slot = (slot + 1) & mask) {
+            if (view(index_[slot]) == value) return index_[slot];
+        }
+        uint32_t offset = append(value);
+        index_[slot] = offset;
+        count_++;
+        return offset;
+    }
+
+    std::string_view view(uint32_t offset) const {
+        const char* p = data_.data() + offset;
+        size_t length = 0;
+        int shift = 0;
+        while (static_cast<unsigned char>(*p) & 0x80) {
+            length |= static_cast<size_t>(*p++ & 0x7F) << shift;
+            shift += 7;
+        }
+        length |= static_cast<size_t>(static_cast<unsigned char>(*p++)) << shift;
+        return std::string_view(p, length);
+    }
+
+    // Distinct strings stored
+    size_t strings() const { return count_; }
+
+    size_t bytes() const { return data_.size(); }
+
+    // String bytes plus the dedup index, as allocated
+    size_t capacityBytes() const { return data_.capacity() + index_.capacity() * sizeof(uint32_t); }
+
+    void reserve(size_t bytes) { data_.reserve(bytes); }
+
+private:
+    static constexpr uint32_t EMPTY = UINT32_MAX;
+
+    std::vector<char> data_;
+    std::vector<uint32_t> index_;   // Open addressing, linear probing; EMPTY or an offset
+    size_t count_{0};
+
+    uint32_t append(std::string_view value) {
+        // value may point into data_ itself; copy before growing
+        if (!data_.empty() && value.data() >= data_.data() && value.data() < data_.data() + data_.size()) {
+            std::string copy(value);
+            return append(std::string_view(copy));
+        }
+
+        size_t offset = data_.size();
+        if (offset + value.size() + 5 > UINT32_MAX) throw std::length_error("String arena full");
+
+        // Varint length: one byte for strings shorter than 128 characters
+        size_t length = value.size();
+        while (length >= 0x80) {
+            data_.push_back(static_cast<char>((length & 0x7F) | 0x80));
+            length >>= 7;
+        }
+        data_.push_back(static_cast<char>(length));
+        data_.insert(data_.end(), value.begin(), value.end());
+        return static_cast<uint32_t>(offset);
+    }
+
+    void growIndex() {
+        std::vector<uint32_t> old(std::max<size_t>(64, index_.size() * 2), EMPTY);
+        old.swap(index_);
+        size_t mask = index_.size() - 1;
+        for (uint32_t offset : old) {
+            if (offset == EMPTY) continue;
+            size_t slot = std::hash<std::string_view>{}(view(offset)) & mask;
+            while (index_[slot] != EMPTY) slot = (slot + 1) & mask;
+            index_[slot] = offset;
+        }
+    }
+};
+
+// String-keyed AVL set for large collections of (often similar) strings.
+// Nodes live in one vector and link by 32-bit index; each node holds only a
+// 32-bit offset into a StringArena instead of an inline std::string, which
+// brings a node down to 16 bytes with no per-key heap allocation.
+// Removing a key frees its node slot but not its arena bytes, which other
+// trees may share; inserting the string again reuses them.
+class StringTree {
+private:
+    static constexpr uint32_t NIL = UINT32_MAX;
+
+    struct Node {
+        uint32_t key;       // Arena offset
+        uint32_t left;
+        uint32_t right;
+        int32_t height;
+    };
+
+    std::shared_ptr<StringArena> arena_;
+    std::vector<Node> nodes_;
+    uint32_t root_{NIL};
+    uint32_t freeList_{NIL};    // Released slots, chained through Node::left
+    size_t size_{0};
+
+public:
+    explicit StringTree(std::shared_ptr<StringArena> arena = std::make_shared<StringArena>())
+        : arena_(std::move(arena)) {}
+
+    void insert(std::string_view value) {
+        root_ = insertImpl(root_, value);
+    }
+
+    bool remove(std::string_view value) {
+        bool found = false;
+        root_ = removeImpl(root_, value, found);
+        return found;
+    }
+
+    bool contains(std::string_view value) const {
+        uint32_t current = root_;
+        while (current != NIL) {
+            int cmp = value.compare(keyOf(current));
+            if (cmp == 0) return true;
+            current = cmp < 0 ? nodes_[current].left : nodes_[current].right;
+        }
+        return false;
+    }
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    void reserve(size_t entries) { nodes_.reserve(entries); }
+
+    void inorder(const std::function<void(std::string_view)>& callback) const {
+        uint32_t stack[96];     // AVL height bound, as in AVLTree::MAX_HEIGHT
+        size_t depth = 0;
+        uint32_t current = root_;
+        while (current != NIL || depth > 0) {
+            while (current != NIL) {
+                stack[depth++] = current;
+                current = nodes_[current].left;
+            }
+            current = stack[--depth];
+            callback(keyOf(current));
+            current = nodes_[current].right;
+        }
+    }
+
+    const StringArena& arena() const { return *arena_; }
+
+    // Bytes held by nodes plus the arena (shared arenas are counted in full)
+    size_t memoryBytes() const {
+        return nodes_.capacity() * sizeof(Node) + arena_->capacityBytes();
+    }
+
+    // Node slots (including spare capacity) as node bytes, the arena as payload
+    MemoryUsage memory_usage() const {
+        MemoryUsage usage;
+        usage.nodes = size_;
+        usage.nodeBytes = nodes_.capacity() * sizeof(Node);
+        usage.payloadHeapBytes = arena_->capacityBytes();
+        usage.allocatorOverhead = memory::allocatorOverhead(usage.nodeBytes) +
+                                  memory::allocatorOverhead(usage.payloadHeapBytes);
+        return usage;
+    }
+
+private:
+    std::string_view keyOf(uint32_t index) const {
+        return arena_->view(nodes_[index].key);
+    }
+
+    int heightOf(uint32_t index) const {
+        return index == NIL ? 0 : nodes_[index].height;
+    }
+
+    void updateHeight(uint32_t index) {
+        Node& node = nodes_[index];
+        node.height = 1 + std::max(heightOf(node.left), heightOf(node.right));
+    }
+
+    int getBalance(uint32_t index) const {
+        return heightOf(nodes_[index].left) - heightOf(nodes_[index].right);
+    }
+
+    uint32_t rightRotate(uint32_t y) {
+        uint32_t x = nodes_[y].left;
+        nodes_[y].left = nodes_[x].right;
+        nodes_[x].right = y;
+        updateHeight(y);
+        updateHeight(x);
+        return x;
+    }
+
+    uint32_t leftRotate(uint32_t x) {
+        uint32_t y = nodes_[x].right;
+        nodes_[x].right = nodes_[y].left;
+        nodes_[y].left = x;
+        updateHeight(x);
+        updateHeight(y);
+        return y;
+    }
+
+    uint32_t balance(uint32_t index) {
+        updateHeight(index);
+        int balance = getBalance(index);
+
+        if (balance > 1) {
+            if (getBalance(nodes_[index].left) < 0) {
+                nodes_[index].left = leftRotate(nodes_[index].left);
+            }
+            return rightRotate(index);
+        }
+
+        if (balance < -1) {
+            if (getBalance(nodes_[index].right) > 0) {
+                nodes_[index].right = rightRotate(nodes_[index].right);
+            }
+            return leftRotate(index);
+        }
+
+        return index;
+    }
+
+    uint32_t allocate(std::string_view value) {
+        uint32_t key = arena_->intern(value);
+        uint32_t index;
+        if (freeList_ != NIL) {
+            index = freeList_;
+            freeList_ = nodes_[index].left;
+        } else {
+            if (nodes_.size() >= NIL) throw std::length_error("StringTree full");
+            index = static_cast<uint32_t>(nodes_.size());
+            nodes_.emplace_back();
+        }
+        nodes_[index] = Node{key, NIL, NIL, 1};
+        return index;
+    }
+
+    // Indices stay valid across vector growth; references would not
+    uint32_t insertImpl(uint32_t index, std::string_view value) {
+        if (index == NIL) {
+            size_++;
+            return allocate(value);
+        }
+
+        int cmp = value.compare(keyOf(index));
+        if (cmp < 0) {
+            uint32_t child = insertImpl(nodes_[index].left, value);
+            nodes_[index].left = child;
+        } else if (cmp > 0) {
+            uint32_t child = insertImpl(nodes_[index].right, value);
+            nodes_[index].right = child;
+        } else {
+            return index;   // Duplicate value
+        }
+
+        return balance(index);
+    }
+
+    uint32_t removeImpl(uint32_t index, std::string_view value, bool& found) {
+        if (index == NIL) return NIL;
+
+        int cmp = value.compare(keyOf(index));
+        if (cmp < 0) {
+            nodes_[index].left = removeImpl(nodes_[index].left, value, found);
+        } else if (cmp > 0) {
+            nodes_[index].right = removeImpl(nodes_[index].right, value, found);
+        } else {
+            found = true;
+            size_--;
+            uint32_t left = nodes_[index].left;
+            uint32_t right = nodes_[index].right;
+            release(index);
+            if (left == NIL) return right;
+            if (right == NIL) return left;
+
+            uint32_t successor = NIL;
+            right = detachMin(right, successor);
+            nodes_[successor].left = left;
+            nodes_[successor].right = right;
+            return balance(successor);
+        }
+
+        return balance(index);
+    }
+
+    uint32_t detachMin(uint32_t index, uint32_t& min) {
+        if (nodes_[index].left == NIL) {
+            min = index;
+            return nodes_[index].right;
+        }
+        nodes_[index].left = detachMin(nodes_[index].left, min);
+        return balance(index);
+    }
+
+    void release(uint32_t index) {
+        nodes_[index].left = freeList_;
+        freeList_ = index;
+    }
+};
+
+}
+
+#endif
@@ -0,0 +1,135 @@
+#ifndef TICK_READER_H
+#define TICK_READER_H
+
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace ds {
+
+struct Tick {
+    std::string_view symbol;    // Points into the reader's buffer
+    double price;
+};
+
+// Streams "symbol,price" lines from a file or stdin. Input is read in large
+// chunks and parsed in place: symbols are views into the chunk (no per-line
+// std::string) and prices go through std::from_chars. Ticks are delivered in
+// batches; the views in a batch are only valid during the callback.
+class TickReader {
+public:
+    // "-" reads standard input
+    explicit TickReader(const std::string& path, size_t chunkBytes = 1 << 20)
+        : buffer_(chunkBytes) {
+        if (path == "-") {
+            file_ = stdin;
+        } else {
+            file_ = std::fopen(path.c_str(), "rb");
+            owned_ = true;
+        }
+        if (!file_) throw std::runtime_error("Cannot open " + path);
+    }
+
+    TickReader(const TickReader&) = delete;
+    TickReader& operator=(const TickReader&) = delete;
+
+    ~TickReader() {
+        if (owned_) std::fclose(file_);
+    }
+
+    // Calls onBatch(const std::vector<Tick>&) with up to batchSize ticks at a
+    // time until the input is exhausted. Returns the number of ticks read.
+    template<typename OnBatch>
+    size_t forEachBatch(OnBatch&& onBatch, size_t batchSize = 4096) {
+        std::vector<Tick> batch;
+        batch.reserve(batchSize);
+        size_t total = 0;
+        size_t filled = 0;  // Bytes of buffer_ holding unparsed input
+
+        while (true) {
+            size_t n = std::fread(buffer_.data() + filled, 1, buffer_.size() - filled, file_);
+            filled += n;
+            bool eof = n == 0;
+
+            const char* begin = buffer_.data();
+            const char* end = begin + filled;
+            const char* line = begin;
+            while (line < end) {
+                const char* newline = static_cast<const char*>(std::memchr(line, '\n', end - line));
+                if (!newline) {
+                    if (!eof) break;     // Partial line: wait for more input
+                    newline = end;       // Last line without a trailing newline
+                }
+                if (parseLine(line, newline, batch)) {
+                    total++;
+                    if (batch.size() == batchSize) {
+                        onBatch(static_cast<const std::vector<Tick>&>(batch));
+                        batch.clear();
+                    }
+                }
+                line = newline + 1;
+            }
+
+            // Views must not outlive the bytes they point at
+            if (!batch.empty()) {
+                onBatch(static_cast<const std::vector<Tick>&>(batch));
+                batch.clear();
+            }
+            if (eof) break;
+
+            size_t rest = line < end ? static_cast<size_t>(end - line) : 0;
+            std::memmove(buffer_.data(), line, rest);
+            filled = rest;
+            if (filled == buffer_.size()) buffer_.resize(buffer_.size() * 2);  // Very long line
+        }
+
+        if (std::ferror(file_)) throw std::runtime_error("Read error while ingesting ticks");
+        return total;
+    }
+
+    // Lines that were not empty but did not parse as symbol,price with a
+    // finite price
+    size_t skippedLines() const { return skipped_; }
+
+private:
+    std::FILE* file_{nullptr};
+    bool owned_{false};
+    std::vector<char> buffer_;
+    size_t skipped_{0};
+
+    bool parseLine(const char* line, const char* end, std::vector<Tick>& batch) {
+        if (end > line && end[-1] == '\r') --end;
+        if (line == end) return false;
+
+        const char* comma = static_cast<const char*>(std::memchr(line, ',', end - line));
+        if (!comma || comma == line) {
+            skipped_++;
+            return false;
+        }
+
+        const char* number = comma + 1;
+        while (number < end && *number == ' ') ++number;
+        double price = 0.0;
+        auto [ptr, ec] = std::from_chars(number, end, price);
+        if (ec != std::errc() || ptr != end) {
+            skipped_++;     // Includes a "symbol,price" header line
+            return false;
+        }
+        if (!std::isfinite(price)) {
+            skipped_++;     // from_chars accepts "nan" and "inf"
+            return false;
+        }
+
+        batch.push_back(Tick{std::string_view(line, comma - line), price});
+        return true;
+    }
+};
+
+}
+
+#endif
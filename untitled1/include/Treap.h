@@ -0,0 +1,592 @@
+#ifndef TREAP_H
+#define TREAP_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <istream>
+#include <iterator>
+#include <memory>
+#include <ostream>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "MemoryUsage.h"
+#include "Serialize.h"
+#include "TreeStats.h"
+
+namespace ds {
+
+// Randomized ordered set with the set API of AVLTree. Keys are in search
+// order and priorities in max-heap order, with each priority a hash of its
+// key. The shape therefore depends only on the key set: two treaps holding
+// the same keys are identical node for node, however they were built, and a
+// loaded snapshot reproduces the saved tree exactly. The expected depth is
+// about 2 ln n and needs no balance data beyond the priority.
+//
+// split and merge give cheap bulk operations: range erase, bulk insert,
+// and union/intersection/difference with another treap in
+// O(m log(n/m + 1)) expected work for sizes m <= n. The two halves of a set
+// operation are independent, so the top levels run on several threads.
+// Adversarial keys colliding under std::hash can degrade the shape.
+template<typename T, typename Stats = NoStats>
+class Treap {
+private:
+    struct Node {
+        T data;
+        uint64_t priority;
+        std::unique_ptr<Node> left;
+        std::unique_ptr<Node> right;
+
+        Node(const T& value, uint64_t priority) : data(value), priority(priority) {}
+        explicit Node(const T& value) : Node(value, priorityOf(value)) {}
+    };
+
+    using Link = std::unique_ptr<Node>;
+
+    Link root;
+    size_t size_;
+    [[no_unique_address]] mutable Stats stats_;
+
+    // Below this many keys a second thread costs more than it saves
+    static constexpr size_t PARALLEL_THRESHOLD = size_t(1) << 15;
+
+    // std::hash is the identity for integers; the splitmix64 finalizer
+    // spreads it over all 64 bits
+    static uint64_t priorityOf(const T& value) {
+        uint64_t x = static_cast<uint64_t>(std::hash<T>{}(value));
+        x += 0x9e3779b97f4a7c15ULL;
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+        return x ^ (x >> 31);
+    }
+
+    // Heap order; equal priorities fall back to key order so the shape
+    // stays a function of the key set
+    static bool above(const Node& a, uint64_t priority, const T& key) {
+        if (a.priority != priority) return a.priority > priority;
+        return a.data < key;
+    }
+
+    static bool above(const Node& a, const Node& b) { return above(a, b.priority, b.data); }
+
+    static int forkDepth(size_t work, unsigned threads) {
+        if (threads == 0) threads = std::thread::hardware_concurrency();
+        int depth = 0;
+        if (work >= PARALLEL_THRESHOLD) {
+            while ((2u << depth) <= threads && depth < 8) depth++;
+        }
+        return depth;
+    }
+
+    static Link clone(const Node* node) {
+        if (!node) return nullptr;
+        Link copy = std::make_unique<Node>(node->data, node->priority);
+        copy->left = clone(node->left.get());
+        copy->right = clone(node->right.get());
+        return copy;
+    }
+
+    static size_t count(const Node* node) {
+        return node ? 1 + count(node->left.get()) + count(node->right.get()) : 0;
+    }
+
+    // Splits node into keys < key and keys > key; a node equal to key is
+    // freed and reported
+    static bool split(Link node, const T& key, Link& less, Link& greater) {
+        Link* lessHook = &less;
+        Link* greaterHook = &greater;
+        while (node) {
+            if (node->data < key) {
+                *lessHook = std::move(node);
+                node = std::move((*lessHook)->right);
+                lessHook = &(*lessHook)->right;
+            } else if (key < node->data) {
+                *greaterHook = std::move(node);
+                node = std::move((*greaterHook)->left);
+                greaterHook = &(*greaterHook)->left;
+            } else {
+                *lessHook = std::move(node->left);
+                *greaterHook = std::move(node->right);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Splits node into keys < key and keys >= key
+    static void splitBelow(Link node, const T& key, Link& less, Link& rest) {
+        Link* lessHook = &less;
+        Link* restHook = &rest;
+        while (node) {
+            if (node->data < key) {
+                *lessHook = std::move(node);
+                node = std::move((*lessHook)->right);
+                lessHook = &(*lessHook)->right;
+            } else {
+                *restHook = std::move(node);
+                node = std::move((*restHook)->left);
+                restHook = &(*restHook)->left;
+            }
+        }
+    }
+
+    // Joins two treaps where every key of a is below every key of b
+    static Link merge(Link a, Link b) {
+        Link result;
+        Link* hook = &result;
+        while (a && b) {
+            if (above(*a, *b)) {
+                *hook = std::move(a);
+                a = std::move((*hook)->right);
+                hook = &(*hook)->right;
+            } else {
+                *hook = std::move(b);
+                b = std::move((*hook)->left);
+                hook = &(*hook)->left;
+            }
+        }
+        *hook = a ? std::move(a) : std::move(b);
+        return result;
+    }
+
+    // Runs left() on another thread while forkDepth > 0, right() here
+    template<typename Left, typename Right>
+    static void both(int forkDepth, Left&& left, Right&& right) {
+        if (forkDepth > 0) {
+            auto pending = std::async(std::launch::async, std::forward<Left>(left));
+            right();
+            pending.get();
+        } else {
+            left();
+            right();
+        }
+    }
+
+    // Union into out; returns the number of keys present in both
+    static size_t unite(Link a, Link b, Link& out, int forkDepth) {
+        if (!a || !b) {
+            out = a ? std::move(a) : std::move(b);
+            return 0;
+        }
+        if (!above(*a, *b)) std::swap(a, b);
+        Link less, greater;
+        size_t duplicates = split(std::move(b), a->data, less, greater) ? 1 : 0;
+        size_t leftDuplicates = 0, rightDuplicates = 0;
+        Node* top = a.get();
+        both(forkDepth,
+            [&] { leftDuplicates = unite(std::move(top->left), std::move(less), top->left, forkDepth - 1); },
+            [&] { rightDuplicates = unite(std::move(top->right), std::move(greater), top->right, forkDepth - 1); });
+        out = std::move(a);
+        return duplicates + leftDuplicates + rightDuplicates;
+    }
+
+    // Intersection into out; returns the number of keys kept
+    static size_t intersect(Link a, Link b, Link& out, int forkDepth) {
+        if (!a || !b) {
+            out = nullptr;
+            return 0;
+        }
+        if (!above(*a, *b)) std::swap(a, b);
+        Link less, greater;
+        bool found = split(std::move(b), a->data, less, greater);
+        Link left, right;
+        size_t leftKept = 0, rightKept = 0;
+        both(forkDepth,
+            [&] { leftKept = intersect(std::move(a->left), std::move(less), left, forkDepth - 1); },
+            [&] { rightKept = intersect(std::move(a->right), std::move(greater), right, forkDepth - 1); });
+        if (found) {
+            a->left = std::move(left);
+            a->right = std::move(right);
+            out = std::move(a);
+        } else {
+            out = merge(std::move(left), std::move(right));
+        }
+        return (found ? 1 : 0) + leftKept + rightKept;
+    }
+
+    // a minus b into out; returns the number of keys removed from a
+    static size_t subtract(Link a, Link b, Link& out, int forkDepth) {
+        if (!a || !b) {
+            out = std::move(a);
+            return 0;
+        }
+        Link less, greater;
+        bool found = split(std::move(b), a->data, less, greater);
+        Link left, right;
+        size_t leftRemoved = 0, rightRemoved = 0;
+        both(forkDepth,
+            [&] { leftRemoved = subtract(std::move(a->left), std::move(less), left, forkDepth - 1); },
+            [&] { rightRemoved = subtract(std::move(a->right), std::move(greater), right, forkDepth - 1); });
+        if (found) {
+            out = merge(std::move(left), std::move(right));
+        } else {
+            a->left = std::move(left);
+            a->right = std::move(right);
+            out = std::move(a);
+        }
+        return (found ? 1 : 0) + leftRemoved + rightRemoved;
+    }
+
+    // Treap of keys that are already sorted and unique, O(n): each key
+    // hangs below the last right-spine node that outranks it
+    template<typename Iterator>
+    static Link build(Iterator first, Iterator last) {
+        Link result;
+        std::vector<Node*> spine;
+        for (; first != last; ++first) {
+            Link node = std::make_unique<Node>(*first);
+            Node* raw = node.get();
+            while (!spine.empty() && above(*raw, *spine.back())) spine.pop_back();
+            if (spine.empty()) {
+                node->left = std::move(result);
+                result = std::move(node);
+            } else {
+                node->left = std::move(spine.back()->right);
+                spine.back()->right = std::move(node);
+            }
+            spine.push_back(raw);
+        }
+        return result;
+    }
+
+public:
+    // In-order iterator. Treap depth is only bounded in expectation, so the
+    // ancestor stack lives on the heap.
+    class iterator {
+    private:
+        friend class Treap;
+
+        std::vector<const Node*> stack_;
+
+        void pushLeft(const Node* node) {
+            while (node) {
+                stack_.push_back(node);
+                node = node->left.get();
+            }
+        }
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const T*;
+        using reference = const T&;
+
+        iterator() = default;
+
+        explicit iterator(const Node* root) {
+            pushLeft(root);
+        }
+
+        reference operator*() const { return stack_.back()->data; }
+        pointer operator->() const { return &stack_.back()->data; }
+
+        iterator& operator++() {
+            const Node* node = stack_.back();
+            stack_.pop_back();
+            pushLeft(node->right.get());
+            return *this;
+        }
+
+        iterator operator++(int) {
+            iterator tmp = *this;
+            ++(*this);
+            return tmp;
+        }
+
+        bool operator==(const iterator& other) const {
+            if (stack_.empty() || other.stack_.empty()) return stack_.empty() == other.stack_.empty();
+            return stack_.back() == other.stack_.back();
+        }
+
+        bool operator!=(const iterator& other) const {
+            return !(*this == other);
+        }
+    };
+
+    Treap() : size_(0) {}
+
+    Treap(const Treap& other) : root(clone(other.root.get())), size_(other.size_) {}
+
+    Treap(Treap&& other) noexcept : root(std::move(other.root)), size_(other.size_) {
+        other.size_ = 0;
+    }
+
+    Treap& operator=(const Treap& other) {
+        if (this != &other) {
+            Treap temp(other);
+            std::swap(root, temp.root);
+            std::swap(size_, temp.size_);
+        }
+        return *this;
+    }
+
+    Treap& operator=(Treap&& other) noexcept {
+        if (this != &other) {
+            root = std::move(other.root);
+            size_ = other.size_;
+            other.size_ = 0;
+        }
+        return *this;
+    }
+
+    iterator begin() const { return iterator(root.get()); }
+    iterator end() const { return iterator(); }
+
+    // Descends while the path outranks the new key, then splits the rest of
+    // the path under it. An equal key would sit exactly there.
+    void insert(const T& value) {
+        stats_.beginPath();
+        uint64_t priority = priorityOf(value);
+        Link* link = &root;
+        while (*link && above(**link, priority, value)) {
+            stats_.visit();
+            stats_.compare();
+            link = value < (*link)->data ? &(*link)->left : &(*link)->right;
+        }
+        if (*link && !((*link)->data < value) && !(value < (*link)->data)) {
+            stats_.endPath();
+            return;     // Duplicate value
+        }
+        Link node = std::make_unique<Node>(value, priority);
+        split(std::move(*link), value, node->left, node->right);
+        *link = std::move(node);
+        size_++;
+        stats_.endPath();
+    }
+
+    bool remove(const T& value) {
+        stats_.beginPath();
+        Link* link = &root;
+        while (*link) {
+            stats_.visit();
+            stats_.compare();
+            if (value < (*link)->data) {
+                link = &(*link)->left;
+                continue;
+            }
+            stats_.compare();
+            if ((*link)->data < value) {
+                link = &(*link)->right;
+                continue;
+            }
+            Link node = std::move(*link);
+            *link = merge(std::move(node->left), std::move(node->right));
+            size_--;
+            stats_.endPath();
+            return true;
+        }
+        stats_.endPath();
+        return false;
+    }
+
+    void clear() {
+        root.reset();
+        size_ = 0;
+    }
+
+    bool contains(const T& value) const {
+        stats_.beginPath();
+        const Node* current = root.get();
+        while (current) {
+            stats_.visit();
+            stats_.compare();
+            if (value < current->data) {
+                current = current->left.get();
+                continue;
+            }
+            stats_.compare();
+            if (current->data < value) {
+                current = current->right.get();
+                continue;
+            }
+            break;
+        }
+        stats_.endPath();
+        return current != nullptr;
+    }
+
+    // First element not less than value
+    iterator lower_bound(const T& value) const {
+        iterator it;
+        for (const Node* current = root.get(); current;) {
+            if (current->data < value) {
+                current = current->right.get();
+            } else {
+                it.stack_.push_back(current);
+                current = current->left.get();
+            }
+        }
+        return it;
+    }
+
+    // First element greater than value
+    iterator upper_bound(const T& value) const {
+        iterator it;
+        for (const Node* current = root.get(); current;) {
+            if (value < current->data) {
+                it.stack_.push_back(current);
+                current = current->left.get();
+            } else {
+                current = current->right.get();
+            }
+        }
+        return it;
+    }
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    // Real height, from an O(n) walk (no stored heights); 0 when empty
+    int height() const {
+        int result = 0;
+        std::vector<std::pair<const Node*, int>> pending;
+        if (root) pending.emplace_back(root.get(), 1);
+        while (!pending.empty()) {
+            auto [node, depth] = pending.back();
+            pending.pop_back();
+            result = std::max(result, depth);
+            if (node->left) pending.emplace_back(node->left.get(), depth + 1);
+            if (node->right) pending.emplace_back(node->right.get(), depth + 1);
+        }
+        return result;
+    }
+
+    // Removes the keys in [low, high); returns how many were removed
+    size_t eraseRange(const T& low, const T& high) {
+        if (!(low < high)) return 0;
+        Link less, rest, middle, greater;
+        splitBelow(std::move(root), low, less, rest);
+        splitBelow(std::move(rest), high, middle, greater);
+        size_t removed = count(middle.get());
+        middle.reset();
+        root = merge(std::move(less), std::move(greater));
+        size_ -= removed;
+        return removed;
+    }
+
+    // Moves the keys >= key into the returned treap, O(log n + moved keys)
+    Treap splitOff(const T& key) {
+        Link less, greater;
+        splitBelow(std::move(root), key, less, greater);
+        Treap upper;
+        upper.size_ = count(greater.get());
+        upper.root = std::move(greater);
+        root = std::move(less);
+        size_ -= upper.size_;
+        return upper;
+    }
+
+    // Appends a treap whose keys are all greater than this one's
+    void join(Treap other) {
+        if (!other.root) return;
+        if (root) {
+            const Node* max = root.get();
+            while (max->right) max = max->right.get();
+            const Node* min = other.root.get();
+            while (min->left) min = min->left.get();
+            if (!(max->data < min->data)) throw std::invalid_argument("join needs every key above this treap's keys");
+        }
+        root = merge(std::move(root), std::move(other.root));
+        size_ += other.size_;
+        other.size_ = 0;
+    }
+
+    // Set union with other. threads == 0 uses the hardware concurrency;
+    // small inputs stay on the calling thread.
+    void unite(Treap other, unsigned threads = 0) {
+        size_t total = size_ + other.size_;
+        size_t duplicates = unite(std::move(root), std::move(other.root), root, forkDepth(total, threads));
+        size_ = total - duplicates;
+        other.size_ = 0;
+    }
+
+    // Keeps only the keys also in other
+    void intersect(Treap other, unsigned threads = 0) {
+        size_ = intersect(std::move(root), std::move(other.root), root, forkDepth(size_ + other.size_, threads));
+        other.size_ = 0;
+    }
+
+    // Removes the keys that are in other
+    void subtract(Treap other, unsigned threads = 0) {
+        size_ -= subtract(std::move(root), std::move(other.root), root, forkDepth(size_ + other.size_, threads));
+        other.size_ = 0;
+    }
+
+    // Adds many keys at once: sorts them, builds a treap in O(m) and unites
+    void insertBulk(std::vector<T> keys, unsigned threads = 0) {
+        std::sort(keys.begin(), keys.end());
+        keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+        Treap batch;
+        batch.root = build(keys.cbegin(), keys.cend());
+        batch.size_ = keys.size();
+        unite(std::move(batch), threads);
+    }
+
+    // Structural counters for insert, remove and contains (TreeStats only)
+    const Stats& stats() const { return stats_; }
+    void resetStats() { stats_.reset(); }
+
+    // One heap allocation per node; key heap bytes need a HeapSize<T> specialization
+    MemoryUsage memory_usage() const {
+        MemoryUsage usage = memory::nodeAllocations(size_, sizeof(Node));
+        if constexpr (HeapSize<T>::ownsHeap) {
+            scanInorder([&usage](const T& value) { usage.payloadHeapBytes += HeapSize<T>::of(value); });
+        }
+        return usage;
+    }
+
+    // Replaces the contents with keys that are already sorted and unique, O(n).
+    // The result is the same tree inserting the keys one by one would give.
+    void assignSorted(std::vector<T> keys) {
+        root = build(keys.cbegin(), keys.cend());
+        size_ = keys.size();
+    }
+
+    // Binary snapshot (see Serialize.h); T needs a ds::Serializer
+    void save(std::ostream& out) const {
+        snapshot::writeHeader<T>(out, size_);
+        snapshot::KeyWriter<T> writer(out);
+        scanInorder(writer);
+        writer.finish();
+        if (!out) throw std::runtime_error("Failed to write snapshot");
+    }
+
+    // Rebuilds the identical treap from a snapshot in O(n)
+    void load(std::istream& in) {
+        uint64_t count = snapshot::readHeader<T>(in);
+        assignSorted(snapshot::readKeys<T>(in, count));
+    }
+
+    // Traversal with Callback Func
+    void inorder(const std::function<void(const T&)>& callback) const {
+        scanInorder(callback);
+    }
+
+    template<typename Callback>
+    void scanInorder(Callback&& callback) const {
+        for (iterator it = begin(); it != end(); ++it) callback(*it);
+    }
+
+    // Visits keys in pre-order; equal treaps (same keys) visit identically
+    template<typename Callback>
+    void scanPreorder(Callback&& callback) const {
+        std::vector<const Node*> pending;
+        if (root) pending.push_back(root.get());
+        while (!pending.empty()) {
+            const Node* node = pending.back();
+            pending.pop_back();
+            callback(node->data);
+            if (node->right) pending.push_back(node->right.get());
+            if (node->left) pending.push_back(node->left.get());
+        }
+    }
+};
+
+}
+
+#endif
@@ -0,0 +1,220 @@
+#ifndef TREE_SHAPE_H
+#define TREE_SHAPE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <map>
+#include <thread>
+#include <vector>
+
+namespace ds {
+
+// Measured shape of a tree, from one O(n) walk over the actual nodes.
+// Depths count nodes from the root (root = 1), i.e. the nodes a lookup of
+// that key visits.
+struct TreeShape {
+    size_t nodes = 0;
+    int height = 0;                         // Real height; 0 for an empty tree
+    double averageDepth = 0;
+    std::vector<size_t> depthHistogram;     // [depth] -> nodes; [0] is unused
+    std::map<int, size_t> balanceFactors;   // left height - right height -> nodes
+    size_t avlViolations = 0;               // Nodes with |balance factor| > 1
+    size_t heightMismatches = 0;            // Stored height differs from the real one
+    size_t orderViolations = 0;             // Keys out of order with a neighbour
+    bool sizeMatches = true;                // nodes == the tree's size()
+
+    int maxDepth() const { return height; }
+
+    bool isAVL() const { return avlViolations == 0 && orderViolations == 0; }
+
+    // Every invariant the trees maintain holds
+    bool valid() const { return isAVL() && heightMismatches == 0 && sizeMatches; }
+};
+
+namespace shape {
+
+// Below this many nodes a second thread costs more than it saves
+constexpr size_t PARALLEL_THRESHOLD = size_t(1) << 15;
+
+template<typename Node>
+struct Subtree {
+    int height = 0;
+    const Node* min = nullptr;
+    const Node* max = nullptr;
+};
+
+// Per-walk counters, kept in flat vectors so recording a node is O(1)
+// without allocation; converted into a TreeShape once the walk is done
+struct Tally {
+    size_t nodes = 0;
+    std::vector<size_t> depths;         // [depth] -> nodes
+    std::vector<size_t> leftHeavy;      // [factor] -> nodes, factor >= 0
+    std::vector<size_t> rightHeavy;     // [-factor] -> nodes, factor < 0
+    size_t avlViolations = 0;
+    size_t heightMismatches = 0;
+    size_t orderViolations = 0;
+};
+
+inline void bump(std::vector<size_t>& counts, size_t index) {
+    if (counts.size() <= index) counts.resize(index + 1, 0);
+    counts[index]++;
+}
+
+inline void add(std::vector<size_t>& into, const std::vector<size_t>& from) {
+    if (into.size() < from.size()) into.resize(from.size(), 0);
+    for (size_t i = 0; i < from.size(); i++) into[i] += from[i];
+}
+
+inline void merge(Tally& into, const Tally& from) {
+    into.nodes += from.nodes;
+    add(into.depths, from.depths);
+    add(into.leftHeavy, from.leftHeavy);
+    add(into.rightHeavy, from.rightHeavy);
+    into.avlViolations += from.avlViolations;
+    into.heightMismatches += from.heightMismatches;
+    into.orderViolations += from.orderViolations;
+}
+
+// Records `node` at `depth` once both of its subtrees have been walked
+template<typename Node>
+Subtree<Node> record(const Node* node, size_t depth, const Subtree<Node>& left, const Subtree<Node>& right, Tally& out) {
+    Subtree<Node> result;
+    result.height = 1 + (left.height > right.height ? left.height : right.height);
+    result.min = left.min ? left.min : node;
+    result.max = right.max ? right.max : node;
+
+    out.nodes++;
+    bump(out.depths, depth);
+    int factor = left.height - right.height;
+    if (factor >= 0) {
+        bump(out.leftHeavy, static_cast<size_t>(factor));
+    } else {
+        bump(out.rightHeavy, static_cast<size_t>(-factor));
+    }
+    if (factor > 1 || factor < -1) out.avlViolations++;
+    if (node->height != result.height) out.heightMismatches++;
+    if (left.max && !(left.max->data < node->data)) out.orderViolations++;
+    if (right.min && !(node->data < right.min->data)) out.orderViolations++;
+    return result;
+}
+
+// Post-order walk of the subtree at `node` on the calling thread. Uses an
+// explicit stack, so a degenerate (list-shaped) tree cannot overflow the
+// call stack.
+template<typename Node>
+Subtree<Node> walkSerial(const Node* node, size_t depth, Tally& out) {
+    if (!node) return {};
+    struct Frame {
+        const Node* node;
+        size_t depth;
+        bool expanded;
+    };
+    std::vector<Frame> pending = {{node, depth, false}};
+    std::vector<Subtree<Node>> finished;    // Results of walked subtrees, left before right
+    while (!pending.empty()) {
+        Frame frame = pending.back();
+        if (!frame.expanded) {
+            pending.back().expanded = true;
+            if (frame.node->right) pending.push_back({frame.node->right.get(), frame.depth + 1, false});
+            if (frame.node->left) pending.push_back({frame.node->left.get(), frame.depth + 1, false});
+            continue;
+        }
+        pending.pop_back();
+        Subtree<Node> left, right;
+        if (frame.node->right) {
+            right = finished.back();
+            finished.pop_back();
+        }
+        if (frame.node->left) {
+            left = finished.back();
+            finished.pop_back();
+        }
+        finished.push_back(record(frame.node, frame.depth, left, right, out));
+    }
+    return finished.back();
+}
+
+// Walk of the subtree at `node`, whose root sits at `depth`. While
+// forkDepth > 0 the left subtree is walked on another thread; recursion
+// stops at forkDepth levels and the rest is walked by walkSerial.
+template<typename Node>
+Subtree<Node> walk(const Node* node, size_t depth, int forkDepth, Tally& out) {
+    const Node* leftChild = node ? node->left.get() : nullptr;
+    const Node* rightChild = node ? node->right.get() : nullptr;
+    if (forkDepth <= 0 || !leftChild || !rightChild) return walkSerial(node, depth, out);
+
+    Tally leftTally;
+    auto pending = std::async(std::launch::async, [&] {
+        return walk(leftChild, depth + 1, forkDepth - 1, leftTally);
+    });
+    Subtree<Node> right = walk(rightChild, depth + 1, forkDepth - 1, out);
+    Subtree<Node> left = pending.get();
+    merge(out, leftTally);
+    return record(node, depth, left, right, out);
+}
+
+// threads == 0 uses the hardware concurrency; small trees are walked on
+// the calling thread
+template<typename Node>
+TreeShape analyze(const Node* root, size_t size, unsigned threads) {
+    if (threads == 0) threads = std::thread::hardware_concurrency();
+    int forkDepth = 0;
+    if (size >= PARALLEL_THRESHOLD) {
+        while ((2u << forkDepth) <= threads && forkDepth < 8) forkDepth++;
+    }
+
+    Tally tally;
+    TreeShape shape;
+    shape.height = walk(root, 1, forkDepth, tally).height;
+    shape.nodes = tally.nodes;
+    shape.depthHistogram = std::move(tally.depths);
+    for (size_t f = 0; f < tally.leftHeavy.size(); f++) {
+        if (tally.leftHeavy[f]) shape.balanceFactors[static_cast<int>(f)] = tally.leftHeavy[f];
+    }
+    for (size_t f = 1; f < tally.rightHeavy.size(); f++) {
+        if (tally.rightHeavy[f]) shape.balanceFactors[-static_cast<int>(f)] = tally.rightHeavy[f];
+    }
+    shape.avlViolations = tally.avlViolations;
+    shape.heightMismatches = tally.heightMismatches;
+    shape.orderViolations = tally.orderViolations;
+
+    uint64_t depthSum = 0;
+    for (size_t d = 1; d < shape.depthHistogram.size(); d++) depthSum += d * shape.depthHistogram[d];
+    if (shape.nodes > 0) shape.averageDepth = static_cast<double>(depthSum) / static_cast<double>(shape.nodes);
+    shape.sizeMatches = shape.nodes == size;
+    return shape;
+}
+
+// Nodes by level for display: slot i of level d is the node reached from the
+// root by the bits of i (high bit first), or nullptr. Stops after maxLevels
+// levels or at the first empty level.
+template<typename T, typename Node>
+std::vector<std::vector<const T*>> levels(const Node* root, size_t maxLevels) {
+    std::vector<std::vector<const T*>> result;
+    std::vector<const Node*> level = {root}, next;
+    while (result.size() < maxLevels) {
+        bool any = false;
+        std::vector<const T*> keys;
+        keys.reserve(level.size());
+        next.assign(level.size() * 2, nullptr);
+        for (size_t i = 0; i < level.size(); i++) {
+            const Node* node = level[i];
+            keys.push_back(node ? &node->data : nullptr);
+            if (!node) continue;
+            any = true;
+            next[2 * i] = node->left.get();
+            next[2 * i + 1] = node->right.get();
+        }
+        if (!any) break;
+        result.push_back(std::move(keys));
+        level.swap(next);
+    }
+    return result;
+}
+
+}
+
+}
+
+#endif
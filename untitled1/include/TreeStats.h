@@ -0,0 +1,101 @@
+#ifndef TREE_STATS_H
+#define TREE_STATS_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace ds {
+
+enum class Rotation { Left, Right, LeftRight, RightLeft };
+
+// Stats policies for the trees' second template parameter. The tree calls
+// these hooks from its search and rebalancing code:
+//   beginPath() / endPath()   around each insert, remove or contains
+//   visit(), compare()        per node entered and per key comparison
+//   heightUpdate()            per recomputed node height
+//   retraceStep()             per ancestor whose height changed or rotated
+//   rotate(kind)              per single or double rotation
+
+// Default policy: every hook is an empty inline call, so a tree built with
+// it compiles to the same code as one without instrumentation.
+struct NoStats {
+    static constexpr bool enabled = false;
+
+    void beginPath() {}
+    void visit() {}
+    void compare() {}
+    void heightUpdate() {}
+    void retraceStep() {}
+    void rotate(Rotation) {}
+    void endPath() {}
+    void reset() {}
+};
+
+// Counting policy, e.g. AVLTree<int, TreeStats>. Read it through stats().
+// The counters are plain integers and contains() and the other const
+// lookups update them, so a tree using this policy must not be read from
+// several threads at once; NoStats trees are unaffected.
+struct TreeStats {
+    static constexpr bool enabled = true;
+    static constexpr size_t MAX_DEPTH = 96;     // Deeper paths share the last bucket
+
+    uint64_t leftRotations = 0;
+    uint64_t rightRotations = 0;
+    uint64_t leftRightRotations = 0;
+    uint64_t rightLeftRotations = 0;
+    uint64_t comparisons = 0;
+    uint64_t nodesVisited = 0;
+    uint64_t heightUpdates = 0;
+    uint64_t paths = 0;                 // Instrumented operations
+    uint64_t retraceSteps = 0;
+    uint64_t maxRetrace = 0;
+    std::array<uint64_t, MAX_DEPTH + 1> depthHistogram{};   // Paths by nodes visited
+
+    uint64_t singleRotations() const { return leftRotations + rightRotations; }
+    uint64_t doubleRotations() const { return leftRightRotations + rightLeftRotations; }
+
+    double meanDepth() const {
+        return paths ? static_cast<double>(nodesVisited) / static_cast<double>(paths) : 0.0;
+    }
+
+    void reset() { *this = TreeStats(); }
+
+    void beginPath() {
+        depth_ = 0;
+        retrace_ = 0;
+    }
+
+    void visit() {
+        nodesVisited++;
+        depth_++;
+    }
+
+    void compare() { comparisons++; }
+    void heightUpdate() { heightUpdates++; }
+    void retraceStep() { retrace_++; }
+
+    void rotate(Rotation kind) {
+        switch (kind) {
+            case Rotation::Left: leftRotations++; break;
+            case Rotation::Right: rightRotations++; break;
+            case Rotation::LeftRight: leftRightRotations++; break;
+            case Rotation::RightLeft: rightLeftRotations++; break;
+        }
+    }
+
+    void endPath() {
+        paths++;
+        depthHistogram[depth_ < MAX_DEPTH ? depth_ : MAX_DEPTH]++;
+        retraceSteps += retrace_;
+        if (retrace_ > maxRetrace) maxRetrace = retrace_;
+    }
+
+private:
+    size_t depth_ = 0;
+    uint64_t retrace_ = 0;
+};
+
+}
+
+#endif
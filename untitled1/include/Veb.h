@@ -0,0 +1,318 @@
+#ifndef VEB_H
+#define VEB_H
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <istream>
+#include <iterator>
+#include <ostream>
+#include <stdexcept>
+#include <vector>
+#include "MemoryUsage.h"
+#include "Serialize.h"
+#include "TreeStats.h"
+
+namespace ds {
+
+template<typename T, typename Stats>
+class AVLTree;
+
+// Immutable ordered set stored in van Emde Boas order: the tree is cut at
+// half its height, the top half is laid out first and then each bottom
+// subtree, all recursively. A lookup then touches O(log_B n) blocks for
+// every block size B at once, which covers cache lines, pages and huge
+// pages without tuning. FrozenTree's Eytzinger layout is faster while the
+// array fits in cache, but its last levels cost a TLB miss each.
+//
+// The layout is implicit (Brodal, Fagerberg and Jacob): positions come
+// from per-depth tables of top and bottom subtree sizes. It needs a
+// complete tree, so the n keys are padded to 2^h - 1 slots with copies of
+// the largest key, and the array is between n and 2n slots. The padding
+// sits after every real key in order, so lookups stay exact and a lookup
+// always runs the full height without bounds checks. Made by
+// AVLTree/BST::freeze<VebTree<T>>(); thaw() converts back.
+template<typename T>
+class VebTree {
+private:
+    static constexpr int MAX_LEVELS = 64;
+
+    // Where the subtrees rooted at one depth are placed. Each depth roots
+    // the bottom subtrees of exactly one split: the ones below the top
+    // subtree (topMask + 1 leaves) rooted at rootDepth.
+    struct Level {
+        uint64_t topMask{0};
+        int bottomHeight{0};    // Each bottom subtree holds 2^bottomHeight - 1 slots
+        int rootDepth{0};
+    };
+
+    // A node's BFS number (1 at the root, 0 past the end) with the slots of
+    // the nodes on its root path
+    struct Path {
+        uint64_t index{0};
+        int depth{0};
+        uint64_t slot[MAX_LEVELS];
+    };
+
+    std::vector<T> slots_;
+    std::vector<Level> levels_;
+    size_t size_{0};
+    int height_{0};
+
+    void buildLevels(int rootDepth, int height) {
+        if (height <= 1) return;
+        int top = height / 2;
+        int bottom = height - top;
+        levels_[rootDepth + top] = Level{(uint64_t(1) << top) - 1, bottom, rootDepth};
+        buildLevels(rootDepth, top);
+        buildLevels(rootDepth + top, bottom);
+    }
+
+    // Slot of BFS node index at depth > 0, from its ancestors' slots
+    uint64_t slotOf(const uint64_t* slot, int depth, uint64_t index) const {
+        const Level& level = levels_[depth];
+        uint64_t bottom = index & level.topMask;
+        return slot[level.rootDepth] + level.topMask + (bottom << level.bottomHeight) - bottom;
+    }
+
+    // Leftmost node below path's node
+    void descendLeft(Path& path) const {
+        while (path.depth + 1 < height_) {
+            path.index *= 2;
+            path.depth++;
+            path.slot[path.depth] = slotOf(path.slot, path.depth, path.index);
+        }
+    }
+
+    // In-order position of the node in the complete tree; past size_ for padding
+    uint64_t rankOf(const Path& path) const {
+        uint64_t offset = path.index - (uint64_t(1) << path.depth);
+        return ((2 * offset + 1) << (height_ - path.depth - 1)) - 1;
+    }
+
+    void first(Path& path) const {
+        if (size_ == 0) {
+            path.index = 0;
+            return;
+        }
+        path.index = 1;
+        path.depth = 0;
+        path.slot[0] = 0;
+        descendLeft(path);
+    }
+
+    // In-order successor; climbing past the root or into the padding ends
+    void advance(Path& path) const {
+        if (path.depth + 1 < height_) {
+            path.index = 2 * path.index + 1;
+            path.depth++;
+            path.slot[path.depth] = slotOf(path.slot, path.depth, path.index);
+            descendLeft(path);
+        } else {
+            int up = std::countr_one(path.index) + 1;
+            path.index >>= up;
+            path.depth -= up;
+        }
+        if (path.index != 0 && rankOf(path) >= size_) path.index = 0;
+    }
+
+    // First node not less than value (strictly greater, if Upper). The
+    // descent always runs the full height; the answer is the last node
+    // where it went left.
+    template<bool Upper>
+    void descend(const T& value, Path& path) const {
+        if (size_ == 0) {
+            path.index = 0;
+            return;
+        }
+        uint64_t index = 1;
+        path.slot[0] = 0;
+        for (int depth = 0; depth < height_; depth++) {
+            if (depth > 0) path.slot[depth] = slotOf(path.slot, depth, index);
+            const T& key = slots_[path.slot[depth]];
+            index = 2 * index + (Upper ? !(value < key) : key < value);
+        }
+        int up = std::countr_one(index) + 1;
+        path.index = index >> up;
+        path.depth = height_ - up;
+    }
+
+    // Places keys, arriving in sorted order, at their vEB slots; the
+    // slots after the last key repeat it
+    template<typename Scan>
+    void fill(size_t count, Scan&& scan) {
+        height_ = static_cast<int>(std::bit_width(count));
+        slots_.assign(count == 0 ? 0 : (uint64_t(1) << height_) - 1, T{});
+        levels_.assign(height_, Level{});
+        buildLevels(0, height_);
+
+        // Walk the whole complete tree, padding included
+        size_ = slots_.size();
+        Path path;
+        first(path);
+        uint64_t last = 0;
+        scan([this, &path, &last](const T& key) {
+            last = path.slot[path.depth];
+            slots_[last] = key;
+            advance(path);
+        });
+        for (; path.index != 0; advance(path)) slots_[path.slot[path.depth]] = slots_[last];
+        size_ = count;
+    }
+
+public:
+    // In-order iterator; carries its node's root path (a few hundred bytes)
+    class iterator {
+    private:
+        friend class VebTree;
+
+        const VebTree* tree_{nullptr};
+        Path path_{};
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const T*;
+        using reference = const T&;
+
+        iterator() = default;
+
+        reference operator*() const { return tree_->slots_[path_.slot[path_.depth]]; }
+        pointer operator->() const { return &tree_->slots_[path_.slot[path_.depth]]; }
+
+        iterator& operator++() {
+            tree_->advance(path_);
+            return *this;
+        }
+
+        iterator operator++(int) {
+            iterator tmp = *this;
+            ++(*this);
+            return tmp;
+        }
+
+        bool operator==(const iterator& other) const {
+            return path_.index == other.path_.index;
+        }
+
+        bool operator!=(const iterator& other) const {
+            return !(*this == other);
+        }
+    };
+
+    VebTree() = default;
+
+    // From keys that are already sorted and unique, O(n)
+    explicit VebTree(const std::vector<T>& sorted) {
+        fill(sorted.size(), [&sorted](auto&& place) {
+            for (const T& key : sorted) place(key);
+        });
+    }
+
+    // From any tree with size() and an in-order scanInorder(callback)
+    template<typename Tree>
+    static VebTree of(const Tree& tree) {
+        VebTree frozen;
+        frozen.fill(tree.size(), [&tree](auto&& place) { tree.scanInorder(place); });
+        return frozen;
+    }
+
+    // Back to a pointer tree (AVLTree by default; any tree with
+    // assignSorted), rebuilt balanced in O(n)
+    template<typename Tree = AVLTree<T, NoStats>>
+    Tree thaw() const {
+        std::vector<T> sorted;
+        sorted.reserve(size_);
+        scanInorder([&sorted](const T& key) { sorted.push_back(key); });
+        Tree tree;
+        tree.assignSorted(std::move(sorted));
+        return tree;
+    }
+
+    iterator begin() const {
+        iterator it;
+        it.tree_ = this;
+        first(it.path_);
+        return it;
+    }
+
+    iterator end() const {
+        iterator it;
+        it.tree_ = this;
+        return it;
+    }
+
+    bool contains(const T& value) const {
+        Path path;
+        descend<false>(value, path);
+        return path.index != 0 && !(value < slots_[path.slot[path.depth]]);
+    }
+
+    // First element not less than value
+    iterator lower_bound(const T& value) const {
+        iterator it;
+        it.tree_ = this;
+        descend<false>(value, it.path_);
+        return it;
+    }
+
+    // First element greater than value
+    iterator upper_bound(const T& value) const {
+        iterator it;
+        it.tree_ = this;
+        descend<true>(value, it.path_);
+        return it;
+    }
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    // Levels of the complete tree: floor(log2 n) + 1, 0 when empty
+    int height() const { return height_; }
+
+    // One flat allocation, padding included; key heap bytes need a
+    // HeapSize<T> specialization
+    MemoryUsage memory_usage() const {
+        MemoryUsage usage;
+        usage.nodes = size_;
+        if (slots_.capacity() > 0) {
+            usage.nodeBytes = slots_.capacity() * sizeof(T);
+            usage.allocatorOverhead = memory::allocatorOverhead(usage.nodeBytes);
+        }
+        if constexpr (HeapSize<T>::ownsHeap) {
+            for (const T& value : slots_) usage.payloadHeapBytes += HeapSize<T>::of(value);
+        }
+        return usage;
+    }
+
+    // Binary snapshot (see Serialize.h), in the same format as the trees
+    void save(std::ostream& out) const {
+        snapshot::writeHeader<T>(out, size_);
+        snapshot::KeyWriter<T> writer(out);
+        scanInorder(writer);
+        writer.finish();
+        if (!out) throw std::runtime_error("Failed to write snapshot");
+    }
+
+    void load(std::istream& in) {
+        uint64_t count = snapshot::readHeader<T>(in);
+        *this = VebTree(snapshot::readKeys<T>(in, count));
+    }
+
+    // Traversal with Callback Func
+    void inorder(const std::function<void(const T&)>& callback) const {
+        scanInorder(callback);
+    }
+
+    template<typename Callback>
+    void scanInorder(Callback&& callback) const {
+        Path path;
+        for (first(path); path.index != 0; advance(path)) callback(slots_[path.slot[path.depth]]);
+    }
+};
+
+}
+
+#endif
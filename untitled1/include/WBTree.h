@@ -0,0 +1,476 @@
+#ifndef WBTREE_H
+#define WBTREE_H
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <istream>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <ostream>
+#include <stdexcept>
+#include <vector>
+#include "MemoryUsage.h"
+#include "Serialize.h"
+#include "TreeStats.h"
+
+namespace ds {
+
+// Weight-balanced (BB[alpha]) ordered set with AVLTree's interface plus
+// order statistics. Each node stores only its subtree size, which serves
+// both as the balance criterion and for rank/select in O(log n): no height
+// field, so a node is no larger than an AVL node and smaller than an AVL
+// node augmented with sizes.
+//
+// Balance follows Adams' scheme with the parameters (delta = 3, gamma = 2)
+// proven correct by Hirai and Yamamoto: with weight = size + 1, neither
+// subtree outweighs the other by more than delta, and one single or double
+// rotation per level restores that after an insert or remove. Sizes are
+// 32-bit, so a tree holds at most 2^32 - 1 keys.
+template<typename T, typename Stats = NoStats>
+class WBTree {
+private:
+    struct Node {
+        T data;
+        uint32_t size;
+        std::unique_ptr<Node> left;
+        std::unique_ptr<Node> right;
+
+        Node(const T& value) : data(value), size(1) {}
+        Node(T&& value) : data(std::move(value)), size(1) {}
+    };
+
+    static constexpr uint64_t DELTA = 3;
+    static constexpr uint64_t GAMMA = 2;
+
+    std::unique_ptr<Node> root;
+    size_t size_;
+    [[no_unique_address]] mutable Stats stats_;
+
+    bool lessThan(const T& a, const T& b) const {
+        stats_.compare();
+        return a < b;
+    }
+
+    bool greaterThan(const T& a, const T& b) const {
+        stats_.compare();
+        return a > b;
+    }
+
+    static uint32_t sizeOf(const Node* node) {
+        return node ? node->size : 0;
+    }
+
+    static uint64_t weight(const Node* node) {
+        return uint64_t(sizeOf(node)) + 1;
+    }
+
+    static void updateSize(Node* node) {
+        node->size = 1 + sizeOf(node->left.get()) + sizeOf(node->right.get());
+    }
+
+    std::unique_ptr<Node> rightRotate(std::unique_ptr<Node> y) {
+        auto x = std::move(y->left);
+        y->left = std::move(x->right);
+        updateSize(y.get());
+        x->right = std::move(y);
+        updateSize(x.get());
+        return x;
+    }
+
+    std::unique_ptr<Node> leftRotate(std::unique_ptr<Node> x) {
+        auto y = std::move(x->right);
+        x->right = std::move(y->left);
+        updateSize(x.get());
+        y->left = std::move(x);
+        updateSize(y.get());
+        return y;
+    }
+
+    std::unique_ptr<Node> balance(std::unique_ptr<Node> node) {
+        updateSize(node.get());
+        uint64_t left = weight(node->left.get());
+        uint64_t right = weight(node->right.get());
+
+        // Right Heavy Situation
+        if (right > DELTA * left) {
+            stats_.retraceStep();
+            const Node* heavy = node->right.get();
+            if (weight(heavy->left.get()) >= GAMMA * weight(heavy->right.get())) {
+                stats_.rotate(Rotation::RightLeft);
+                node->right = rightRotate(std::move(node->right));
+            } else {
+                stats_.rotate(Rotation::Left);
+            }
+            return leftRotate(std::move(node));
+        }
+
+        // Left Heavy Situation
+        if (left > DELTA * right) {
+            stats_.retraceStep();
+            const Node* heavy = node->left.get();
+            if (weight(heavy->right.get()) >= GAMMA * weight(heavy->left.get())) {
+                stats_.rotate(Rotation::LeftRight);
+                node->left = leftRotate(std::move(node->left));
+            } else {
+                stats_.rotate(Rotation::Right);
+            }
+            return rightRotate(std::move(node));
+        }
+
+        return node;
+    }
+
+    std::unique_ptr<Node> insert(std::unique_ptr<Node> node, const T& value) {
+        if (!node) {
+            size_++;
+            return std::make_unique<Node>(value);
+        }
+
+        stats_.visit();
+        if (lessThan(value, node->data)) {
+            node->left = insert(std::move(node->left), value);
+        } else if (greaterThan(value, node->data)) {
+            node->right = insert(std::move(node->right), value);
+        } else {
+            return node; // Duplicate value
+        }
+
+        return balance(std::move(node));
+    }
+
+    std::unique_ptr<Node> remove(std::unique_ptr<Node> node, const T& value, bool& found) {
+        if (!node) return nullptr;
+
+        stats_.visit();
+        if (lessThan(value, node->data)) {
+            node->left = remove(std::move(node->left), value, found);
+        } else if (greaterThan(value, node->data)) {
+            node->right = remove(std::move(node->right), value, found);
+        } else {
+            found = true;
+            size_--;
+            if (!node->left) return std::move(node->right);
+            if (!node->right) return std::move(node->left);
+
+            // Two children: relink the in-order successor into this position
+            std::unique_ptr<Node> successor;
+            node->right = detachMin(std::move(node->right), successor);
+            successor->left = std::move(node->left);
+            successor->right = std::move(node->right);
+            return balance(std::move(successor));
+        }
+
+        return balance(std::move(node));
+    }
+
+    std::unique_ptr<Node> detachMin(std::unique_ptr<Node> node, std::unique_ptr<Node>& min) {
+        stats_.visit();
+        if (!node->left) {
+            auto right = std::move(node->right);
+            min = std::move(node);
+            return right;
+        }
+        node->left = detachMin(std::move(node->left), min);
+        return balance(std::move(node));
+    }
+
+    std::unique_ptr<Node> clone(const Node* node) const {
+        if (!node) return nullptr;
+        auto copy = std::make_unique<Node>(node->data);
+        copy->size = node->size;
+        copy->left = clone(node->left.get());
+        copy->right = clone(node->right.get());
+        return copy;
+    }
+
+    // Perfectly balanced subtree from keys[lo, hi); no comparisons needed
+    std::unique_ptr<Node> buildBalanced(std::vector<T>& keys, size_t lo, size_t hi) {
+        if (lo >= hi) return nullptr;
+        size_t mid = lo + (hi - lo) / 2;
+        auto node = std::make_unique<Node>(std::move(keys[mid]));
+        node->left = buildBalanced(keys, lo, mid);
+        node->right = buildBalanced(keys, mid + 1, hi);
+        updateSize(node.get());
+        return node;
+    }
+
+    static int heightOf(const Node* node) {
+        return node ? 1 + std::max(heightOf(node->left.get()), heightOf(node->right.get())) : 0;
+    }
+
+public:
+    // No subtree outweighs its sibling by more than 3:1, so a child holds at
+    // most 3/4 of its parent's weight: height <= log_{4/3}(2^32) < 78.
+    static constexpr size_t MAX_HEIGHT = 80;
+
+    static constexpr size_t MAX_SIZE = std::numeric_limits<uint32_t>::max();
+
+    // In-order iterator over an immutable view of the tree. Keeps a fixed
+    // MAX_HEIGHT stack of ancestors, so iterating never allocates.
+    class iterator {
+    private:
+        friend class WBTree;
+
+        const Node* stack_[MAX_HEIGHT]{};
+        size_t depth_{0};
+
+        void pushLeft(const Node* node) {
+            while (node) {
+                stack_[depth_++] = node;
+                node = node->left.get();
+            }
+        }
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const T*;
+        using reference = const T&;
+
+        iterator() = default;
+
+        explicit iterator(const Node* root) {
+            pushLeft(root);
+        }
+
+        reference operator*() const { return stack_[depth_ - 1]->data; }
+        pointer operator->() const { return &stack_[depth_ - 1]->data; }
+
+        iterator& operator++() {
+            const Node* node = stack_[--depth_];
+            pushLeft(node->right.get());
+            return *this;
+        }
+
+        iterator operator++(int) {
+            iterator tmp = *this;
+            ++(*this);
+            return tmp;
+        }
+
+        bool operator==(const iterator& other) const {
+            if (depth_ == 0 || other.depth_ == 0) return depth_ == other.depth_;
+            return stack_[depth_ - 1] == other.stack_[other.depth_ - 1];
+        }
+
+        bool operator!=(const iterator& other) const {
+            return !(*this == other);
+        }
+    };
+
+    WBTree() : size_(0) {}
+
+    WBTree(const WBTree& other) : root(clone(other.root.get())), size_(other.size_) {}
+
+    WBTree(WBTree&& other) noexcept : root(std::move(other.root)), size_(other.size_) {
+        other.size_ = 0;
+    }
+
+    WBTree& operator=(const WBTree& other) {
+        if (this != &other) {
+            WBTree temp(other);
+            std::swap(root, temp.root);
+            std::swap(size_, temp.size_);
+        }
+        return *this;
+    }
+
+    WBTree& operator=(WBTree&& other) noexcept {
+        if (this != &other) {
+            root = std::move(other.root);
+            size_ = other.size_;
+            other.size_ = 0;
+        }
+        return *this;
+    }
+
+    iterator begin() const { return iterator(root.get()); }
+    iterator end() const { return iterator(); }
+
+    void insert(const T& value) {
+        if (size_ == MAX_SIZE) throw std::length_error("WBTree is full");
+        stats_.beginPath();
+        root = insert(std::move(root), value);
+        stats_.endPath();
+    }
+
+    bool remove(const T& value) {
+        bool found = false;
+        stats_.beginPath();
+        root = remove(std::move(root), value, found);
+        stats_.endPath();
+        return found;
+    }
+
+    void clear() {
+        root.reset();
+        size_ = 0;
+    }
+
+    // First element not less than value
+    iterator lower_bound(const T& value) const {
+        iterator it;
+        for (const Node* current = root.get(); current;) {
+            if (current->data < value) {
+                current = current->right.get();
+            } else {
+                it.stack_[it.depth_++] = current;
+                current = current->left.get();
+            }
+        }
+        return it;
+    }
+
+    // First element greater than value
+    iterator upper_bound(const T& value) const {
+        iterator it;
+        for (const Node* current = root.get(); current;) {
+            if (value < current->data) {
+                it.stack_[it.depth_++] = current;
+                current = current->left.get();
+            } else {
+                current = current->right.get();
+            }
+        }
+        return it;
+    }
+
+    bool contains(const T& value) const {
+        stats_.beginPath();
+        const Node* current = root.get();
+        while (current) {
+            stats_.visit();
+            if (lessThan(value, current->data)) {
+                current = current->left.get();
+            } else if (greaterThan(value, current->data)) {
+                current = current->right.get();
+            } else {
+                break;
+            }
+        }
+        stats_.endPath();
+        return current != nullptr;
+    }
+
+    // Number of elements less than value, O(log n)
+    size_t rank(const T& value) const {
+        size_t result = 0;
+        for (const Node* current = root.get(); current;) {
+            if (current->data < value) {
+                result += sizeOf(current->left.get()) + 1;
+                current = current->right.get();
+            } else {
+                current = current->left.get();
+            }
+        }
+        return result;
+    }
+
+    // The element with k smaller elements (0-based), O(log n)
+    const T& select(size_t k) const {
+        if (k >= size_) throw std::out_of_range("select index out of range");
+        const Node* current = root.get();
+        for (;;) {
+            size_t left = sizeOf(current->left.get());
+            if (k < left) {
+                current = current->left.get();
+            } else if (k > left) {
+                k -= left + 1;
+                current = current->right.get();
+            } else {
+                return current->data;
+            }
+        }
+    }
+
+    // Number of elements in [low, high)
+    size_t countRange(const T& low, const T& high) const {
+        if (!(low < high)) return 0;
+        return rank(high) - rank(low);
+    }
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    // Real height from an O(n) walk (only sizes are stored); 0 when empty
+    int height() const { return heightOf(root.get()); }
+
+    // Every node's stored size is right and no subtree outweighs its
+    // sibling by more than DELTA; O(n), for tests
+    bool verify() const {
+        std::function<bool(const Node*, const T*, const T*)> check =
+            [&check](const Node* node, const T* low, const T* high) {
+                if (!node) return true;
+                if ((low && !(*low < node->data)) || (high && !(node->data < *high))) return false;
+                uint64_t left = weight(node->left.get()), right = weight(node->right.get());
+                if (node->size != left + right - 1 || left > DELTA * right || right > DELTA * left) return false;
+                return check(node->left.get(), low, &node->data) && check(node->right.get(), &node->data, high);
+            };
+        return sizeOf(root.get()) == size_ && check(root.get(), nullptr, nullptr);
+    }
+
+    // Structural counters for insert, remove and contains (TreeStats only)
+    const Stats& stats() const { return stats_; }
+    void resetStats() { stats_.reset(); }
+
+    // One heap allocation per node; key heap bytes need a HeapSize<T> specialization
+    MemoryUsage memory_usage() const {
+        MemoryUsage usage = memory::nodeAllocations(size_, sizeof(Node));
+        if constexpr (HeapSize<T>::ownsHeap) {
+            scanInorder([&usage](const T& value) { usage.payloadHeapBytes += HeapSize<T>::of(value); });
+        }
+        return usage;
+    }
+
+    // Replaces the contents with keys that are already sorted and unique, O(n)
+    void assignSorted(std::vector<T> keys) {
+        if (keys.size() > MAX_SIZE) throw std::length_error("WBTree is full");
+        root = buildBalanced(keys, 0, keys.size());
+        size_ = keys.size();
+    }
+
+    // Binary snapshot (see Serialize.h); T needs a ds::Serializer
+    void save(std::ostream& out) const {
+        snapshot::writeHeader<T>(out, size_);
+        snapshot::KeyWriter<T> writer(out);
+        scanInorder(writer);
+        writer.finish();
+        if (!out) throw std::runtime_error("Failed to write snapshot");
+    }
+
+    // Rebuilds a balanced tree from a snapshot in O(n)
+    void load(std::istream& in) {
+        uint64_t count = snapshot::readHeader<T>(in);
+        assignSorted(snapshot::readKeys<T>(in, count));
+    }
+
+    // Traversal with Callback Func
+    void inorder(const std::function<void(const T&)>& callback) const {
+        scanInorder(callback);
+    }
+
+    // Read-only traversal: no recursion, no heap, fixed MAX_HEIGHT stack.
+    // Never writes to the tree, so any number of threads may scan at once.
+    template<typename Callback>
+    void scanInorder(Callback&& callback) const {
+        const Node* stack[MAX_HEIGHT];
+        size_t depth = 0;
+        const Node* current = root.get();
+        while (current || depth > 0) {
+            while (current) {
+                stack[depth++] = current;
+                current = current->left.get();
+            }
+            current = stack[--depth];
+            callback(current->data);
+            current = current->right.get();
+        }
+    }
+};
+
+}
+
+#endif
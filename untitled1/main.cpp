@@ -3,7 +3,6 @@
 #include <string>
 #include <iomanip>
 #include <vector>
-#include <cmath>
 #include <windows.h>
 #include <conio.h>
 
@@ -59,61 +58,85 @@ void visualizeTree(const ds::AVLTree<int>& tree) {
     std::cout << "\nTree Visualization:\n\n";
     setColor(7);   // White
 
-    std::vector<int> nodes;
-    tree.inorder([&nodes](const int& val) {
-        nodes.push_back(val);
-    });
-
-    if (nodes.empty()) {
+    if (tree.empty()) {
         setColor(14);  // Yellow
         std::cout << "Empty tree\n";
         setColor(7);   // White
         return;
     }
 
-    // Calculate tree levels
-    int height = static_cast<int>(std::log2(nodes.size()) + 1);
-    int maxWidth = (1 << height) * 6;  // Increased spacing
-
-    // Print tree structure
-    int index = 0;
-    for (int level = 0; level < height && index < nodes.size(); level++) {
-        int levelNodes = 1 << level;
-        int branchWidth = maxWidth / (1 << level);
-
-        // Print nodes
-        printSpaces(branchWidth / 2);
-        for (int i = 0; i < levelNodes && index < nodes.size(); i++) {
-            setColor(11);  // Light Cyan
-            if (i > 0) printSpaces(branchWidth - 1);
-            std::cout << std::setw(3) << nodes[index++];
+    // Real structure, level by level; deep trees are cut off to fit the console
+    const int MAX_SHOWN_LEVELS = 5;
+    ds::TreeShape shape = tree.diagnostics();
+    auto levels = tree.levels(MAX_SHOWN_LEVELS);
+    int shownLevels = static_cast<int>(levels.size());
+    int maxWidth = (1 << (shownLevels - 1)) * 5;    // 80 columns at five levels
+
+    for (int level = 0; level < shownLevels; level++) {
+        int slotWidth = maxWidth / (1 << level);
+        const auto& slots = levels[level];
+
+        // Print nodes, each centred in its slot
+        for (const int* key : slots) {
+            printSpaces(slotWidth / 2 - 2);
+            if (key) {
+                setColor(11);  // Light Cyan
+                std::cout << std::setw(3) << *key;
+            } else {
+                std::cout << "   ";
+            }
             setColor(7);   // White
+            printSpaces(slotWidth - slotWidth / 2 - 1);
         }
         std::cout << "\n";
 
-        // Print connections if not last level
-        if (level < height - 1 && index < nodes.size()) {
-            printSpaces(branchWidth / 4);
-            for (int i = 0; i < levelNodes && (index + i) < nodes.size(); i++) {
-                if (i > 0) printSpaces(branchWidth - 1);
-                setColor(14);  // Yellow
-                std::cout << "  /";
-                printSpaces(branchWidth / 2 - 3);
-                std::cout << "\\";
-                setColor(7);   // White
+        // Print connections to the next level
+        if (level < shownLevels - 1) {
+            setColor(14);  // Yellow
+            for (size_t i = 0; i < slots.size(); i++) {
+                bool hasLeft = levels[level + 1][2 * i] != nullptr;
+                bool hasRight = levels[level + 1][2 * i + 1] != nullptr;
+                int leftAt = slotWidth * 3 / 8;
+                int rightAt = slotWidth * 5 / 8;
+                printSpaces(leftAt);
+                std::cout << (hasLeft ? "/" : " ");
+                printSpaces(rightAt - leftAt - 1);
+                std::cout << (hasRight ? "\\" : " ");
+                printSpaces(slotWidth - rightAt - 1);
             }
+            setColor(7);   // White
             std::cout << "\n";
         }
     }
+    if (shape.height > shownLevels) {
+        std::cout << "(" << shape.height - shownLevels << " deeper levels not shown)\n";
+    }
 
-    // Show tree properties
+    // Show tree properties, measured from the nodes themselves
     setColor(13);  // Light Magenta
     std::cout << "\nTree Properties:\n";
-    std::cout << "* Size: " << nodes.size() << " nodes\n";
-    std::cout << "* Height: " << height << " levels\n";
-    std::cout << "* Balanced: Yes (AVL property maintained)\n\n";
+    std::cout << "* Size: " << shape.nodes << " nodes\n";
+    std::cout << "* Height: " << shape.height << " levels\n";
+    std::cout << "* Average depth: " << std::fixed << std::setprecision(2) << shape.averageDepth << "\n";
+    std::cout << "* Balance factors:";
+    for (const auto& [factor, count] : shape.balanceFactors) {
+        std::cout << " " << std::showpos << factor << std::noshowpos << " x" << count;
+    }
+    std::cout << "\n";
+    if (shape.valid()) {
+        std::cout << "* Balanced: Yes (AVL property maintained)\n\n";
+    } else {
+        setColor(12);  // Light Red
+        std::cout << "* Balanced: No (" << shape.avlViolations << " unbalanced nodes, "
+                  << shape.heightMismatches << " stale heights, "
+                  << shape.orderViolations << " keys out of order)\n\n";
+    }
 
     // Show traversal
+    std::vector<int> nodes;
+    tree.inorder([&nodes](const int& val) {
+        nodes.push_back(val);
+    });
     setColor(9);   // Light Blue
     std::cout << "In-order traversal: ";
     for (size_t i = 0; i < nodes.size(); ++i) {
@@ -6,8 +6,78 @@
 #include <algorithm>
 #include <random>
 #include <chrono>
+#include <thread>
 #include <iostream>
+#include <sstream>
+#include <cstdio>
+#include <filesystem>
 #include "../include/bst.h"
+#include "../include/AVL.h"
+#include "../include/BTree.h"
+#include "../include/BalancedTree.h"
+#include "../include/Splay.h"
+#include "../include/Treap.h"
+#include "../include/WBTree.h"
+#include "../include/KaryTree.h"
+#include "../include/Veb.h"
+#include "../include/SmallTree.h"
+#include "../include/AVLMap.h"
+#include "../include/BSTMap.h"
+#include "../include/Multiset.h"
+#include "../include/MappedTree.h"
+#include "../include/Durable.h"
+#include "../include/TickReader.h"
+#include "../cases/stock_market.h"
+#include "../include/StringTree.h"
+#include "../include/TreeStats.h"
+#include <cmath>
+#include <set>
+#include <map>
+#include <numeric>
+
+// Map value too wide to sit inside the node
+struct WideValue {
+    int64_t fields[6]{};
+
+    bool operator==(const WideValue&) const = default;
+};
+
+// Key whose serialization can be made to fail, to test logging ahead of a change
+struct FlakyKey {
+    static inline bool failWrites = false;
+    int value = 0;
+
+    auto operator<=>(const FlakyKey&) const = default;
+};
+
+namespace ds {
+
+template<>
+struct Serializer<WideValue> {
+    static constexpr uint32_t fixedSize = sizeof(WideValue);
+
+    static void write(std::ostream& out, const WideValue& value) {
+        out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    static WideValue read(std::istream& in) {
+        WideValue value;
+        in.read(reinterpret_cast<char*>(&value), sizeof(value));
+        return value;
+    }
+};
+
+template<>
+struct Serializer<FlakyKey> {
+    static void write(std::ostream& out, const FlakyKey& key) {
+        if (FlakyKey::failWrites) throw std::runtime_error("Write failed");
+        Serializer<int>::write(out, key.value);
+    }
+
+    static FlakyKey read(std::istream& in) { return FlakyKey{Serializer<int>::read(in)}; }
+};
+
+}
 
 namespace test {
 
@@ -32,6 +102,78 @@ public:
         testEdgeCases();
         std::cout << "+ Edge cases tests passed\n";
 
+        testTraversalModes();
+        std::cout << "+ Traversal mode tests passed\n";
+
+        testPagination();
+        std::cout << "+ Pagination tests passed\n";
+
+        testSnapshot();
+        std::cout << "+ Snapshot tests passed\n";
+
+        testMappedTree();
+        std::cout << "+ Mapped tree tests passed\n";
+
+        testAvlRemoval();
+        std::cout << "+ AVL removal tests passed\n";
+
+        testAvlCopyMove();
+        std::cout << "+ AVL copy/move tests passed\n";
+
+        testDurableTree();
+        std::cout << "+ Durable tree tests passed\n";
+
+        testTickReader();
+        std::cout << "+ Tick reader tests passed\n";
+
+        testStockMarket();
+        std::cout << "+ Stock market tests passed\n";
+
+        testStringTree();
+        std::cout << "+ String tree tests passed\n";
+
+        testMemoryUsage();
+        std::cout << "+ Memory usage tests passed\n";
+
+        testTreeStats();
+        std::cout << "+ Tree stats tests passed\n";
+
+        testDiagnostics();
+        std::cout << "+ Diagnostics tests passed\n";
+
+        testBTree();
+        std::cout << "+ B-tree tests passed\n";
+
+        testBalancePolicies();
+        std::cout << "+ Balance policy tests passed\n";
+
+        testSplayTree();
+        std::cout << "+ Splay tree tests passed\n";
+
+        testTreap();
+        std::cout << "+ Treap tests passed\n";
+
+        testWBTree();
+        std::cout << "+ Weight-balanced tree tests passed\n";
+
+        testKaryTree();
+        std::cout << "+ K-ary search tree tests passed\n";
+
+        testFrozenTree();
+        std::cout << "+ Frozen tree tests passed\n";
+
+        testVebTree();
+        std::cout << "+ vEB layout tests passed\n";
+
+        testSmallTree();
+        std::cout << "+ Small tree tests passed\n";
+
+        testMaps();
+        std::cout << "+ Map tests passed\n";
+
+        testMultiset();
+        std::cout << "+ Multiset tests passed\n";
+
         std::cout << "All advanced tests passed successfully!\n";
     }
 
@@ -162,8 +304,1393 @@ private:
         assert(tree.empty());
         assert(tree.size() == 0);
     }
+
+    static void testTraversalModes() {
+        ds::BST<int> tree;
+        ds::AVLTree<int> avl;
+        std::mt19937 gen(42);
+        std::uniform_int_distribution<> dis(1, 5000);
+        for (int i = 0; i < 2000; i++) {
+            int val = dis(gen);
+            tree.insert(val);
+            avl.insert(val);
+        }
+
+        std::vector<int> expected, scanned, threaded, iterated;
+        tree.inorder([&expected](const int& val) { expected.push_back(val); });
+        tree.scanInorder([&scanned](const int& val) { scanned.push_back(val); });
+        tree.morrisInorder([&threaded](const int& val) { threaded.push_back(val); });
+        assert(std::is_sorted(expected.begin(), expected.end()));
+        assert(scanned == expected);
+        assert(threaded == expected);
+
+        // Morris threading must leave the shape untouched
+        std::vector<int> preBefore, preAfter;
+        tree.preorder([&preBefore](const int& val) { preBefore.push_back(val); });
+        tree.morrisInorder([](const int&) {});
+        tree.preorder([&preAfter](const int& val) { preAfter.push_back(val); });
+        assert(preBefore == preAfter);
+
+        scanned.clear();
+        threaded.clear();
+        avl.scanInorder([&scanned](const int& val) { scanned.push_back(val); });
+        avl.morrisInorder([&threaded](const int& val) { threaded.push_back(val); });
+        for (int val : avl) iterated.push_back(val);
+        assert(scanned == expected);
+        assert(threaded == expected);
+        assert(iterated == expected);
+
+        // A throwing callback must not leave threads behind
+        int visited = 0;
+        try {
+            avl.morrisInorder([&visited](const int&) {
+                if (++visited == 100) throw std::runtime_error("stop");
+            });
+            assert(false);
+        } catch (const std::runtime_error&) {}
+        assert(visited == 100);
+        iterated.clear();
+        for (int val : avl) iterated.push_back(val);
+        assert(iterated == expected);
+    }
+
+    static void testPagination() {
+        ds::BST<int> tree;
+        ds::AVLTree<int> avl;
+        for (int i = 0; i < 100; i += 2) {
+            tree.insert(i);
+            avl.insert(i);
+        }
+
+        // Walking every page reproduces the full listing
+        std::vector<int> paged;
+        ds::PageToken<int> token;
+        while (true) {
+            auto page = avl.page(token, 7);
+            assert(page.items.size() <= 7);
+            paged.insert(paged.end(), page.items.begin(), page.items.end());
+            token = page.next;
+            if (!page.hasMore) break;
+        }
+        assert(paged.size() == 50);
+        assert(std::is_sorted(paged.begin(), paged.end()));
+
+        // Tokens survive unrelated inserts
+        auto first = tree.page(ds::PageToken<int>(), 5);
+        assert((first.items == std::vector<int>{0, 2, 4, 6, 8}));
+        tree.insert(3);
+        tree.insert(9);
+        auto second = tree.page(first.next, 3);
+        assert((second.items == std::vector<int>{9, 10, 12}));
+        assert(second.hasMore);
+
+        // Seeking by key and reaching the end
+        auto tail = avl.pageAfter(95, 10);
+        assert((tail.items == std::vector<int>{96, 98}));
+        assert(!tail.hasMore);
+        auto empty = avl.page(tail.next, 10);
+        assert(empty.items.empty() && !empty.hasMore);
+        assert(*avl.lower_bound(41) == 42);
+        assert(*avl.upper_bound(42) == 44);
+        assert(avl.lower_bound(99) == avl.end());
+        assert(*tree.lower_bound(9) == 9);
+
+        // An oversized page is the rest of the tree, not an oversized allocation
+        auto all = avl.page(ds::PageToken<int>(), SIZE_MAX);
+        assert(all.items.size() == 50 && !all.hasMore);
+        assert(tree.pageAfter(10, SIZE_MAX).items.size() == tree.size() - 8);
+    }
+
+    static void testSnapshot() {
+        ds::AVLTree<int> avl;
+        for (int i = 0; i < 1000; i++) {
+            avl.insert((i * 7919) % 1000);
+        }
+
+        // Round trip, and the format is shared by both engines
+        std::stringstream buffer;
+        avl.save(buffer);
+        ds::BST<int> tree;
+        tree.insert(-1);
+        tree.load(buffer);
+        assert(tree.size() == 1000);
+        assert(!tree.contains(-1));
+        std::vector<int> loaded;
+        tree.inorder([&loaded](const int& val) { loaded.push_back(val); });
+        for (int i = 0; i < 1000; i++) {
+            assert(loaded[i] == i);
+        }
+        tree.insert(1000);
+        assert(tree.remove(500));
+
+        // Variable-size keys
+        ds::AVLTree<std::string> names;
+        names.insert("delta");
+        names.insert("alpha");
+        names.insert("");
+        std::stringstream nameBuffer;
+        names.save(nameBuffer);
+        ds::AVLTree<std::string> reloaded;
+        reloaded.load(nameBuffer);
+        assert(reloaded.size() == 3);
+        assert(reloaded.contains("alpha") && reloaded.contains("delta") && reloaded.contains(""));
+
+        // Corrupt or mismatched input is rejected
+        std::stringstream garbage("not a snapshot at all");
+        bool threw = false;
+        try { reloaded.load(garbage); } catch (const std::runtime_error&) { threw = true; }
+        assert(threw);
+
+        std::stringstream wrongType;
+        avl.save(wrongType);
+        threw = false;
+        try { reloaded.load(wrongType); } catch (const std::runtime_error&) { threw = true; }
+        assert(threw);
+        assert(reloaded.size() == 3);
+
+        // Same key size, different key type
+        ds::AVLTree<int32_t> ints;
+        ints.insert(-7);
+        std::stringstream intBuffer;
+        ints.save(intBuffer);
+        std::string intSnapshot = intBuffer.str();
+        auto rejects = [&intSnapshot](auto tree) {
+            std::stringstream in(intSnapshot);
+            try { tree.load(in); } catch (const std::runtime_error&) { return true; }
+            return false;
+        };
+        assert(rejects(ds::AVLTree<float>()) && rejects(ds::AVLTree<uint32_t>()) && !rejects(ds::AVLTree<int32_t>()));
+
+        // A count far beyond the data fails as truncated, not as an allocation
+        for (bool strings : {false, true}) {
+            std::stringstream lying;
+            if (strings) ds::snapshot::writeHeader<std::string>(lying, uint64_t{1} << 60);
+            else ds::snapshot::writeHeader<int>(lying, uint64_t{1} << 60);
+            uint32_t length = UINT32_MAX;
+            lying.write(reinterpret_cast<const char*>(&length), sizeof(length));
+            std::string message;
+            try {
+                if (strings) ds::AVLTree<std::string>().load(lying);
+                else ds::AVLTree<int>().load(lying);
+            } catch (const std::runtime_error& e) { message = e.what(); }
+            assert(message == "Truncated snapshot");
+        }
+
+        // Keys are trusted to be sorted, so unsorted or repeated keys are refused;
+        // only the multisets accept repeats
+        auto handWritten = [](std::vector<int> keys, bool withValues) {
+            std::stringstream out;
+            ds::snapshot::writeHeader<int>(out, keys.size());
+            for (int key : keys) {
+                ds::Serializer<int>::write(out, key);
+                if (withValues) ds::Serializer<int>::write(out, key * 10);
+            }
+            return out.str();
+        };
+        auto loadError = [](auto container, const std::string& bytes) {
+            std::stringstream in(bytes);
+            try { container.load(in); } catch (const std::runtime_error& e) { return std::string(e.what()); }
+            return std::string();
+        };
+        const std::string ORDER = "Snapshot keys out of order";
+        for (const auto& keys : {std::vector<int>{1, 3, 2}, std::vector<int>{1, 2, 2}}) {
+            assert(loadError(ds::AVLTree<int>(), handWritten(keys, false)) == ORDER);
+            assert(loadError(ds::Treap<int>(), handWritten(keys, false)) == ORDER);
+            assert(loadError(ds::AVLMap<int, int>(), handWritten(keys, true)) == ORDER);
+            assert(loadError(ds::BSTMap<int, int>(), handWritten(keys, true)) == ORDER);
+        }
+        assert(loadError(ds::AVLMultiset<int>(), handWritten({1, 3, 2}, false)) == ORDER);
+        assert(loadError(ds::AVLMultimap<int, int>(), handWritten({1, 3, 2}, true)) == ORDER);
+        assert(loadError(ds::AVLMultiset<int>(), handWritten({1, 2, 2}, false)).empty());
+        assert(loadError(ds::AVLMultimap<int, int>(), handWritten({1, 2, 2}, true)).empty());
+
+        // Only the current format version loads
+        std::string oldVersion = handWritten({1, 2}, false);
+        oldVersion[4] = 1;
+        assert(loadError(ds::AVLTree<int>(), oldVersion) == "Unsupported snapshot version");
+    }
+
+    static void testMappedTree() {
+        ds::AVLTree<double> prices;
+        for (int i = 0; i < 500; i++) {
+            prices.insert(i * 0.5);
+        }
+        std::string path = (std::filesystem::temp_directory_path() / "ds_mapped_test.bin").string();
+        ds::writeMappedTree(prices, path);
+
+        {
+            ds::mapped_tree<double> mapped(path);
+            assert(mapped.size() == 500);
+            assert(mapped.contains(10.5));
+            assert(!mapped.contains(10.25));
+            assert(*mapped.lower_bound(10.25) == 10.5);
+            assert(mapped.lower_bound(1000.0) == mapped.end());
+
+            std::vector<double> expected, iterated(mapped.begin(), mapped.end());
+            prices.inorder([&expected](const double& val) { expected.push_back(val); });
+            assert(iterated == expected);
+
+            // Keys of a different type are refused
+            bool threw = false;
+            try { ds::mapped_tree<int> wrong(path); } catch (const std::runtime_error&) { threw = true; }
+            assert(threw);
+
+            // Rewriting the file replaces it; the open mapping keeps the old keys
+            ds::AVLTree<double> fewer;
+            fewer.insert(1.0);
+            ds::writeMappedTree(fewer, path);
+            assert(mapped.size() == 500 && *(mapped.end() - 1) == 249.5);
+            assert(ds::mapped_tree<double>(path).size() == 1);
+            assert(!std::filesystem::exists(path + ".tmp"));
+        }
+        std::remove(path.c_str());
+
+        // A failed rename (the target is a directory) leaves no temp file
+        std::filesystem::create_directories(path + "/occupied");
+        bool threw = false;
+        try {
+            ds::writeMappedTree(prices, path);
+        } catch (const std::runtime_error&) {
+            threw = true;
+        }
+        assert(threw && !std::filesystem::exists(path + ".tmp"));
+        std::filesystem::remove_all(path);
+    }
+
+    static void testAvlRemoval() {
+        ds::AVLTree<int> avl;
+        std::set<int> reference;
+        std::mt19937 gen(7);
+        std::uniform_int_distribution<> dis(1, 500);
+        for (int i = 0; i < 5000; i++) {
+            int val = dis(gen);
+            if (i % 3 == 0) {
+                assert(avl.remove(val) == (reference.erase(val) == 1));
+            } else {
+                avl.insert(val);
+                reference.insert(val);
+            }
+            assert(avl.size() == reference.size());
+        }
+        std::vector<int> elements(avl.begin(), avl.end());
+        assert(std::equal(elements.begin(), elements.end(), reference.begin(), reference.end()));
+        avl.clear();
+        assert(avl.empty() && !avl.contains(*reference.begin()));
+    }
+
+    static void testAvlCopyMove() {
+        ds::AVLTree<int> avl;
+        for (int i = 0; i < 200; i++) avl.insert((i * 37) % 200);
+
+        // Copies are deep and independent
+        ds::AVLTree<int> copy(avl);
+        copy.remove(0);
+        assert(avl.contains(0));
+        assert(copy.size() == avl.size() - 1);
+        avl = copy;
+        assert(!avl.contains(0) && avl.size() == 199);
+        assert(std::equal(avl.begin(), avl.end(), copy.begin(), copy.end()));
+
+        // Moves hand over the nodes and leave the source empty
+        ds::AVLTree<int> moved(std::move(copy));
+        assert(moved.size() == 199 && moved.contains(199) && copy.empty());
+        copy = std::move(moved);
+        assert(copy.size() == 199 && moved.empty() && moved.begin() == moved.end());
+        moved.insert(5);
+        assert(moved.size() == 1 && copy.contains(5));
+    }
+
+    static void testDurableTree() {
+        auto dir = std::filesystem::temp_directory_path() / "ds_durable_test";
+        std::filesystem::remove_all(dir);
+
+        {
+            ds::DurableAVLTree<std::string> tree(dir.string(), ds::GroupCommit{1 << 20, std::chrono::seconds(60)});
+            tree.insert("alpha");
+            tree.insert("beta");
+            tree.insert("gamma");
+            assert(tree.remove("beta"));
+            assert(!tree.remove("delta"));
+            assert(tree.commitCount() == 0);  // Still inside the group window
+        }   // Destructor commits the open group
+
+        {
+            ds::DurableAVLTree<std::string> tree(dir.string());
+            assert(tree.size() == 2);
+            assert(tree.contains("alpha") && tree.contains("gamma") && !tree.contains("beta"));
+            tree.checkpoint();
+            tree.insert("delta");
+            tree.sync();
+        }
+
+        // A torn record at the end of the log is dropped on recovery
+        {
+            std::ofstream wal(dir / "wal.log", std::ios::binary | std::ios::app);
+            wal.write("\x01\x40\x00", 3);
+        }
+        {
+            ds::DurableAVLTree<std::string> tree(dir.string());
+            assert(tree.size() == 3);
+            assert(tree.contains("delta"));
+            tree.insert("epsilon");
+        }
+        {
+            ds::DurableAVLTree<std::string> tree(dir.string());
+            assert(tree.size() == 4);
+            assert(tree.contains("epsilon"));
+        }
+
+        // poll() commits a lone record once its window has run out
+        {
+            ds::DurableAVLTree<std::string> tree(dir.string(), ds::GroupCommit{1 << 20, std::chrono::milliseconds(1)});
+            tree.insert("zeta");
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            tree.poll();
+            assert(tree.commitCount() == 1);
+            tree.poll();
+            assert(tree.commitCount() == 1);
+        }
+        std::filesystem::remove_all(dir);
+
+        // A change whose record cannot be logged is not applied either
+        {
+            ds::DurableAVLTree<FlakyKey> tree(dir.string());
+            tree.insert(FlakyKey{1});
+            FlakyKey::failWrites = true;
+            bool threw = false;
+            try {
+                tree.insert(FlakyKey{2});
+            } catch (const std::runtime_error&) {
+                threw = true;
+            }
+            FlakyKey::failWrites = false;
+            assert(threw && tree.size() == 1 && !tree.contains(FlakyKey{2}));
+            tree.insert(FlakyKey{3});
+        }
+        {
+            ds::DurableAVLTree<FlakyKey> tree(dir.string());
+            assert(tree.size() == 2 && tree.contains(FlakyKey{1}) && !tree.contains(FlakyKey{2}));
+        }
+        std::filesystem::remove_all(dir);
+    }
+
+    static void testTickReader() {
+        auto path = (std::filesystem::temp_directory_path() / "ds_ticks_test.csv").string();
+        {
+            std::ofstream out(path, std::ios::binary);
+            out << "symbol,price\n";
+            for (int i = 0; i < 100; i++) {
+                out << "SYM" << i << "," << i << ".25\r\n";
+            }
+            out << "broken line\n\n";
+            out << "NAN1,nan\nINF1,inf\nINF2,-INF\n";  // from_chars parses these
+            out << std::string(40, 'L') << ",1e3";    // Longer than a chunk, no newline
+        }
+
+        // A tiny chunk size forces lines to straddle refills
+        ds::TickReader reader(path, 16);
+        std::vector<std::string> symbols;
+        std::vector<double> prices;
+        size_t count = reader.forEachBatch([&](const std::vector<ds::Tick>& batch) {
+            for (const auto& tick : batch) {
+                symbols.emplace_back(tick.symbol);
+                prices.push_back(tick.price);
+            }
+        }, 7);
+
+        assert(count == 101);
+        assert(symbols.size() == 101);
+        assert(symbols[0] == "SYM0" && prices[0] == 0.25);
+        assert(symbols[99] == "SYM99" && prices[99] == 99.25);
+        assert(symbols[100] == std::string(40, 'L') && prices[100] == 1000.0);
+        assert(reader.skippedLines() == 5);
+        std::remove(path.c_str());
+    }
+
+    static void testStockMarket() {
+        // Repeated ticks move a symbol; they don't add listings
+        StockMarket market;
+        market.addStock("AAPL", 150.5);
+        market.addStock("MSFT", 290.25);
+        market.addStock("AAPL", 151.0);
+        market.addStock("AAPL", 152.25);
+        assert(market.size() == 2 && *market.priceOf("AAPL") == 152.25);
+        assert(market.countInRange(150.0, 152.0) == 0 && market.countInRange(150.0, 300.0) == 2);
+
+        // Non-finite prices never reach the tree
+        bool threw = false;
+        try {
+            market.addStock("AAPL", std::nan(""));
+        } catch (const std::invalid_argument&) {
+            threw = true;
+        }
+        assert(threw && market.size() == 2 && *market.priceOf("AAPL") == 152.25);
+
+        // Within a batch the last tick of a symbol wins, whatever its price
+        std::vector<ds::Tick> batch = {{"AAPL", 149.0}, {"TSLA", 750.8}, {"AAPL", 153.0}, {"AAPL", 148.0}, {"TSLA", 751.0}};
+        market.applyTicks(batch);
+        assert(market.size() == 3 && *market.priceOf("AAPL") == 148.0 && *market.priceOf("TSLA") == 751.0);
+        std::vector<std::string> listed;
+        std::vector<double> listedPrices;
+        market.forEachListing([&](const StockPrice& stock) {
+            listed.push_back(stock.symbol);
+            listedPrices.push_back(stock.price);
+        });
+        assert((listed == std::vector<std::string>{"AAPL", "MSFT", "TSLA"}));
+        assert((listedPrices == std::vector<double>{148.0, 290.25, 751.0}));
+        assert(market.percentile(50).symbol == "MSFT" && market.percentile(100).price == 751.0);
+        assert(!market.priceOf("GOGL"));
+
+        // Symbols moving between a few crowded price levels stay listed once,
+        // at their latest price
+        StockMarket crowded;
+        std::map<std::string, double> expected;
+        std::mt19937 gen(31);
+        for (int step = 0; step < 20000; step++) {
+            std::string symbol = "S" + std::to_string(gen() % 500);
+            double price = 100.0 + static_cast<double>(gen() % 3);
+            crowded.addStock(symbol, price);
+            expected[symbol] = price;
+        }
+        assert(crowded.size() == expected.size() && crowded.countInRange(0.0, 1000.0) == expected.size());
+        std::map<std::string, double> seen;
+        crowded.forEachListing([&seen](const StockPrice& stock) {
+            assert(seen.emplace(stock.symbol, stock.price).second);
+        });
+        assert(seen == expected);
+    }
+
+    static void testStringTree() {
+        ds::StringTree tree;
+        std::set<std::string> reference;
+        std::mt19937 gen(99);
+        std::uniform_int_distribution<> dis(0, 300);
+        for (int i = 0; i < 3000; i++) {
+            std::string name = "Contact, Name " + std::to_string(dis(gen)) + std::string(dis(gen) % 150, 'x');
+            if (i % 4 == 0) {
+                assert(tree.remove(name) == (reference.erase(name) == 1));
+            } else {
+                tree.insert(name);
+                reference.insert(name);
+            }
+            assert(tree.size() == reference.size());
+        }
+
+        std::vector<std::string> elements;
+        tree.inorder([&elements](std::string_view key) { elements.emplace_back(key); });
+        assert(std::equal(elements.begin(), elements.end(), reference.begin(), reference.end()));
+        for (const auto& name : reference) {
+            assert(tree.contains(name));
+        }
+        assert(!tree.contains("Contact"));
+
+        // Trees sharing an arena, including re-inserting a view into it
+        auto arena = std::make_shared<ds::StringArena>();
+        ds::StringTree first(arena), second(arena);
+        first.insert("shared");
+        first.inorder([&second](std::string_view key) { second.insert(key); });
+        assert(second.contains("shared"));
+
+        // Each distinct string is stored once, whichever tree inserts it
+        size_t bytes = arena->bytes();
+        second.insert("shared");
+        second.remove("shared");
+        second.insert("shared");
+        for (int i = 0; i < 1000; i++) first.insert("Contact " + std::to_string(i));
+        size_t grown = arena->bytes();
+        first.inorder([&second](std::string_view key) { second.insert(key); });
+        assert(bytes < grown && arena->bytes() == grown && arena->strings() == 1001);
+        second.insert(arena->view(arena->intern("Contact 12")).substr(0, 8));   // A view into the arena
+        assert(second.contains("Contact ") && arena->strings() == 1002);
+    }
+
+    static void testMemoryUsage() {
+        ds::AVLTree<int> empty;
+        assert(empty.memory_usage().nodes == 0 && empty.memory_usage().totalBytes() == 0);
+
+        ds::AVLTree<int> ints;
+        ds::BST<int> shared;
+        for (int i = 0; i < 100; i++) {
+            ints.insert(i);
+            shared.insert(i);
+        }
+        auto avl = ints.memory_usage();
+        assert(avl.nodes == 100);
+        assert(avl.nodeBytes >= 100 * (sizeof(int) + 2 * sizeof(void*)));
+        assert(avl.allocatorOverhead > 0 && avl.payloadHeapBytes == 0);
+        auto bst = shared.memory_usage();
+        assert(bst.nodes == 100);
+        assert(bst.nodeBytes > avl.nodeBytes);     // Control blocks and shared_ptr links
+
+        // Short strings stay inline; long ones are counted as payload
+        ds::AVLTree<std::string> names;
+        names.insert("a");
+        assert(names.memory_usage().payloadHeapBytes == 0);
+        names.insert(std::string(100, 'b'));
+        assert(names.memory_usage().payloadHeapBytes >= 101);
+        assert(ds::HeapSize<std::vector<int>>::of(std::vector<int>(10)) >= 10 * sizeof(int));
+
+        ds::StringTree compact;
+        compact.insert(std::string(100, 'c'));
+        auto usage = compact.memory_usage();
+        assert(usage.nodes == 1 && usage.payloadHeapBytes >= 101);
+    }
+
+    static void testTreeStats() {
+        // Ascending inserts only ever need single left rotations
+        ds::AVLTree<int, ds::TreeStats> ascending;
+        for (int i = 0; i < 1000; i++) ascending.insert(i);
+        const auto& stats = ascending.stats();
+        assert(stats.leftRotations > 0 && stats.rightRotations == 0);
+        assert(stats.doubleRotations() == 0);
+        assert(stats.paths == 1000);
+        assert(stats.comparisons >= stats.nodesVisited);
+
+        uint64_t histogramTotal = 0, depthTotal = 0;
+        for (size_t depth = 0; depth < stats.depthHistogram.size(); depth++) {
+            histogramTotal += stats.depthHistogram[depth];
+            depthTotal += depth * stats.depthHistogram[depth];
+        }
+        assert(histogramTotal == stats.paths && depthTotal == stats.nodesVisited);
+        assert(stats.meanDepth() <= 11.0);
+
+        // 3, 1, 2 forces one left-right double rotation
+        ds::BST<int, ds::TreeStats> zigzag;
+        for (int value : {3, 1, 2}) zigzag.insert(value);
+        assert(zigzag.stats().leftRightRotations == 1 && zigzag.stats().singleRotations() == 0);
+        assert(zigzag.contains(2) && zigzag.stats().paths == 4);
+        assert(zigzag.stats().depthHistogram[1] == 2);   // The root is hit directly
+        zigzag.resetStats();
+        assert(zigzag.stats().paths == 0 && zigzag.stats().comparisons == 0);
+
+        // Removal retraces and reports the work as well
+        for (int i = 0; i < 1000; i += 2) ascending.remove(i);
+        assert(ascending.stats().paths == 1500 && ascending.stats().maxRetrace > 0);
+
+        // The default policy adds no state
+        assert(sizeof(ds::AVLTree<int>) < sizeof(ds::AVLTree<int, ds::TreeStats>));
+    }
+
+    static void testDiagnostics() {
+        ds::AVLTree<int> empty;
+        auto none = empty.diagnostics();
+        assert(none.nodes == 0 && none.height == 0 && none.valid());
+        assert(empty.levels(4).empty());
+
+        // 7 ascending keys settle into a perfect tree of height 3
+        ds::BST<int> small;
+        for (int i = 1; i <= 7; i++) small.insert(i);
+        auto perfect = small.diagnostics();
+        assert(perfect.height == 3 && small.height() == 3);
+        assert(perfect.depthHistogram[1] == 1 && perfect.depthHistogram[2] == 2 && perfect.depthHistogram[3] == 4);
+        assert(perfect.balanceFactors.size() == 1 && perfect.balanceFactors.at(0) == 7);
+        assert(std::abs(perfect.averageDepth - 17.0 / 7.0) < 1e-9);
+        auto levels = small.levels(8);
+        assert(levels.size() == 3 && *levels[0][0] == 4 && *levels[2][3] == 7);
+
+        // Large trees take the multi-threaded path and must agree with one thread
+        ds::AVLTree<int> large;
+        std::mt19937 gen(7);
+        std::uniform_int_distribution<> dis(0, 1 << 30);
+        while (large.size() < 100000) large.insert(dis(gen));
+        for (int i = 0; i < 20000; i++) large.remove(dis(gen));
+        auto parallel = large.diagnostics(8);
+        auto serial = large.diagnostics(1);
+        assert(parallel.valid() && serial.valid());
+        assert(parallel.nodes == large.size() && parallel.height == large.height());
+        assert(parallel.depthHistogram == serial.depthHistogram);
+        assert(parallel.balanceFactors == serial.balanceFactors);
+        assert(parallel.height <= 1.44 * std::log2(large.size() + 2));
+        for (const auto& [factor, count] : parallel.balanceFactors) {
+            assert(factor >= -1 && factor <= 1 && count > 0);
+        }
+
+        // A list-shaped chain far deeper than any balanced tree is walked
+        // without recursion; unlinked iteratively for the same reason
+        struct ChainNode {
+            int data;
+            int height;
+            std::unique_ptr<ChainNode> left, right;
+        };
+        const int CHAIN = 500000;
+        std::unique_ptr<ChainNode> chain;
+        for (int i = 0; i < CHAIN; i++) {
+            auto node = std::make_unique<ChainNode>(ChainNode{i, i + 1, nullptr, nullptr});
+            node->left = std::move(chain);
+            chain = std::move(node);
+        }
+        auto degenerate = ds::shape::analyze(chain.get(), CHAIN, 1);
+        assert(degenerate.nodes == CHAIN && degenerate.height == CHAIN);
+        assert(degenerate.heightMismatches == 0 && degenerate.orderViolations == 0);
+        assert(degenerate.avlViolations == CHAIN - 2);
+        assert(degenerate.balanceFactors.at(0) == 1 && degenerate.balanceFactors.at(CHAIN - 1) == 1);
+        assert(degenerate.depthHistogram.size() == CHAIN + 1 && degenerate.depthHistogram[CHAIN] == 1);
+        while (chain) chain = std::move(chain->left);
+    }
+
+    // Shared by the ordered sets: random inserts, removes and lookups against
+    // std::set, with verify() along the way where the tree has one, then
+    // lower_bound/upper_bound probes. A copy must survive emptying the
+    // original in shuffled order; it is returned for engine-specific checks.
+    template<typename Tree>
+    static Tree checkOrderedSet(Tree tree, int operations, int range) {
+        auto verify = [](const Tree& t) {
+            if constexpr (requires { t.verify(); }) assert(t.verify());
+        };
+        std::set<int> reference;
+        std::mt19937 gen(static_cast<unsigned>(range));
+        std::uniform_int_distribution<> dis(0, range);
+        for (int i = 0; i < operations; i++) {
+            int key = dis(gen);
+            if (i % 3 == 0) {
+                assert(tree.remove(key) == (reference.erase(key) == 1));
+            } else if (i % 6 == 5) {
+                assert(tree.contains(key) == (reference.count(key) == 1));     // Splaying lookups mutate
+            } else {
+                tree.insert(key);
+                reference.insert(key);
+            }
+            assert(tree.size() == reference.size());
+            if (i % 97 == 0) verify(tree);
+        }
+        verify(tree);
+        assert(std::equal(tree.begin(), tree.end(), reference.begin(), reference.end()));
+        for (int key = 0; key <= range; key += 7) {
+            assert(tree.contains(key) == (reference.count(key) == 1));
+            auto it = tree.lower_bound(key);
+            auto expected = reference.lower_bound(key);
+            assert((it == tree.end()) == (expected == reference.end()));
+            if (expected != reference.end()) assert(*it == *expected);
+            auto after = tree.upper_bound(key);
+            auto expectedAfter = reference.upper_bound(key);
+            assert((after == tree.end()) == (expectedAfter == reference.end()));
+            if (expectedAfter != reference.end()) assert(*after == *expectedAfter);
+        }
+
+        Tree copy(tree);
+        std::vector<int> keys(reference.begin(), reference.end());
+        std::shuffle(keys.begin(), keys.end(), gen);
+        for (size_t i = 0; i < keys.size(); i++) {
+            assert(tree.remove(keys[i]));
+            if (i % 53 == 0) verify(tree);
+        }
+        assert(tree.empty() && tree.begin() == tree.end());
+        if constexpr (requires { tree.height(); }) assert(tree.height() == 0);
+        verify(copy);
+        assert(std::equal(copy.begin(), copy.end(), reference.begin(), reference.end()));
+        return copy;
+    }
+
+    static void testBTree() {
+        // Small nodes force frequent splits, borrows and merges
+        checkOrderedSet(ds::BTree<int, 32>(), 30000, 3000);        // Minimum fanout of 4
+        checkOrderedSet(ds::BTree<int, 256>(), 60000, 20000);
+        checkOrderedSet(ds::BTree<int, 4096>(), 60000, 100000);
+
+        ds::BTree<int> sequential;
+        for (int i = 0; i < 100000; i++) sequential.insert(i);
+        assert(sequential.height() <= 5);
+        int expected = 0;
+        sequential.inorder([&expected](const int& value) { assert(value == expected++); });
+        assert(expected == 100000);
+
+        ds::BTree<std::string> names;
+        for (int i = 0; i < 1000; i++) names.insert("Contact " + std::to_string(i));
+        assert(names.size() == 1000 && names.contains("Contact 500") && !names.contains("Contact"));
+        ds::BTree<std::string> moved(std::move(names));
+        assert(moved.size() == 1000 && names.empty());
+    }
+
+    static void testBalancePolicies() {
+        // verify() checks order, parent links and the policy's own invariant
+        checkOrderedSet(ds::AVLSet<int>(), 30000, 3000);
+        checkOrderedSet(ds::RedBlackTree<int>(), 30000, 3000);
+        checkOrderedSet(ds::WAVLTree<int>(), 30000, 3000);
+        checkOrderedSet(ds::UnbalancedTree<int>(), 30000, 3000);
+        checkOrderedSet(ds::RedBlackTree<int>(), 5000, 40);     // Dense: many two-child removals
+        checkOrderedSet(ds::WAVLTree<int>(), 5000, 40);
+
+        // Sorted inserts: balanced policies stay logarithmic, the plain BST degenerates
+        ds::AVLSet<int, ds::TreeStats> avl;
+        ds::RedBlackTree<int, ds::TreeStats> redBlack;
+        ds::WAVLTree<int, ds::TreeStats> wavl;
+        ds::UnbalancedTree<int, ds::TreeStats> plain;
+        for (int i = 0; i < 1024; i++) {
+            avl.insert(i);
+            redBlack.insert(i);
+            wavl.insert(i);
+            plain.insert(i);
+        }
+        assert(avl.verify() && redBlack.verify() && wavl.verify());
+        avl.resetStats();
+        redBlack.resetStats();
+        wavl.resetStats();
+        plain.resetStats();
+        for (int i = 0; i < 1024; i++) {
+            assert(avl.contains(i) && redBlack.contains(i) && wavl.contains(i) && plain.contains(i));
+        }
+        assert(avl.stats().meanDepth() < 11 && redBlack.stats().meanDepth() < 20 && wavl.stats().meanDepth() < 11);
+        assert(plain.stats().meanDepth() > 500);
+        assert(plain.stats().singleRotations() == 0);
+
+        // Two-child removals relink nodes rather than copying keys
+        ds::WAVLTree<std::string> names;
+        for (int i = 0; i < 200; i++) names.insert("Contact " + std::to_string(i));
+        for (int i = 0; i < 200; i += 2) assert(names.remove("Contact " + std::to_string(i)));
+        assert(names.size() == 100 && names.verify() && names.contains("Contact 99") && !names.contains("Contact 98"));
+
+        // A sorted plain BST is a chain; copying and verifying it must not
+        // recurse once per level
+        ds::UnbalancedTree<int> chain;
+        for (int i = 0; i < 20000; i++) chain.insert(i);
+        ds::UnbalancedTree<int> chainCopy(chain);
+        assert(chainCopy.size() == 20000 && chainCopy.verify());
+        assert(std::equal(chain.begin(), chain.end(), chainCopy.begin()));
+        chainCopy.remove(0);
+        assert(chainCopy.verify() && chain.contains(0) && !chainCopy.contains(0));
+    }
+
+    static void testSplayTree() {
+        checkOrderedSet(ds::SplayTree<int>(), 60000, 3000);
+        checkOrderedSet(ds::SplayTree<int>(1), 20000, 40);
+        ds::SplayTree<int> sampledCopy = checkOrderedSet(ds::SplayTree<int>(4), 60000, 3000);
+        assert(sampledCopy.splayEvery() == 4);      // Copies keep the splay interval
+
+        // A lookup splays the key to the root: the next search for it is one node deep
+        ds::SplayTree<int, ds::TreeStats> tree;
+        for (int i = 0; i < 1000; i++) tree.insert(i);
+        assert(tree.height() == 1000);          // Ascending inserts leave a left path
+        assert(tree.contains(0) && tree.height() < 1000);
+        tree.resetStats();
+        assert(tree.contains(0));
+        assert(tree.stats().nodesVisited == 1);
+
+        // With splayEvery = 4 the first three lookups leave the shape alone
+        ds::SplayTree<int, ds::TreeStats> sampled(4);
+        for (int i = 0; i < 1000; i++) sampled.insert(i);
+        sampled.resetStats();
+        for (int i = 0; i < 3; i++) assert(sampled.contains(0));
+        assert(sampled.stats().singleRotations() == 0 && sampled.height() == 1000);
+        assert(sampled.contains(0) && sampled.stats().singleRotations() > 0);
+
+        // Deep trees iterate, copy, snapshot and destroy without recursion trouble
+        ds::SplayTree<int> deep;
+        for (int i = 0; i < 200000; i++) deep.insert(i);
+        int expected = 0;
+        deep.inorder([&expected](const int& value) { assert(value == expected++); });
+        assert(expected == 200000);
+        std::stringstream snapshot;
+        deep.save(snapshot);
+        ds::SplayTree<int> loaded;
+        loaded.load(snapshot);
+        assert(loaded.size() == 200000 && loaded.height() == 18);
+
+        bool threw = false;
+        try {
+            ds::SplayTree<int> invalid(0);
+        } catch (const std::invalid_argument&) {
+            threw = true;
+        }
+        assert(threw);
+    }
+
+    static std::vector<int> preorder(const ds::Treap<int>& treap) {
+        std::vector<int> keys;
+        treap.scanPreorder([&keys](const int& key) { keys.push_back(key); });
+        return keys;
+    }
+
+    static bool sameKeys(const ds::Treap<int>& treap, const std::set<int>& reference) {
+        return treap.size() == reference.size() && std::equal(treap.begin(), treap.end(), reference.begin(), reference.end());
+    }
+
+    static void testTreap() {
+        std::mt19937 gen(43);
+        ds::Treap<int> treap = checkOrderedSet(ds::Treap<int>(), 60000, 5000);
+        std::set<int> reference(treap.begin(), treap.end());
+
+        // Hash priorities: the shape depends only on the keys, so a rebuilt
+        // or reloaded treap is node-for-node identical
+        ds::Treap<int> rebuilt;
+        rebuilt.assignSorted(std::vector<int>(reference.begin(), reference.end()));
+        assert(preorder(rebuilt) == preorder(treap));
+        std::stringstream snapshot;
+        treap.save(snapshot);
+        ds::Treap<int> loaded;
+        loaded.load(snapshot);
+        assert(preorder(loaded) == preorder(treap));
+
+        // Range erase, split and join
+        ds::Treap<int> ranged(treap);
+        std::set<int> rangedReference(reference);
+        size_t expectedRemoved = 0;
+        for (auto it = rangedReference.lower_bound(1000); it != rangedReference.end() && *it < 2000;) {
+            it = rangedReference.erase(it);
+            expectedRemoved++;
+        }
+        assert(ranged.eraseRange(1000, 2000) == expectedRemoved && sameKeys(ranged, rangedReference));
+        assert(ranged.eraseRange(2000, 2000) == 0);
+        ds::Treap<int> upper = ranged.splitOff(3000);
+        std::set<int> upperReference(rangedReference.lower_bound(3000), rangedReference.end());
+        rangedReference.erase(rangedReference.lower_bound(3000), rangedReference.end());
+        assert(sameKeys(ranged, rangedReference) && sameKeys(upper, upperReference));
+        bool threw = false;
+        try {
+            upper.join(ranged);
+        } catch (const std::invalid_argument&) {
+            threw = true;
+        }
+        assert(threw);
+        ranged.join(std::move(upper));
+        rangedReference.insert(upperReference.begin(), upperReference.end());
+        assert(sameKeys(ranged, rangedReference));
+
+        // Set operations, serial and forked (sizes past the parallel threshold)
+        for (unsigned threads : {1u, 4u}) {
+            ds::Treap<int> a, b;
+            std::set<int> aReference, bReference;
+            std::uniform_int_distribution<> wide(0, 200000);
+            for (int i = 0; i < 50000; i++) {
+                int x = wide(gen), y = wide(gen);
+                a.insert(x);
+                aReference.insert(x);
+                b.insert(y);
+                bReference.insert(y);
+            }
+            std::set<int> unionReference(aReference), intersectReference, subtractReference;
+            unionReference.insert(bReference.begin(), bReference.end());
+            for (int key : aReference) (bReference.count(key) ? intersectReference : subtractReference).insert(key);
+
+            ds::Treap<int> united(a);
+            united.unite(b, threads);
+            assert(sameKeys(united, unionReference));
+            ds::Treap<int> expectedShape;
+            expectedShape.assignSorted(std::vector<int>(unionReference.begin(), unionReference.end()));
+            assert(preorder(united) == preorder(expectedShape));
+
+            ds::Treap<int> intersected(a);
+            intersected.intersect(b, threads);
+            assert(sameKeys(intersected, intersectReference));
+
+            ds::Treap<int> subtracted(a);
+            subtracted.subtract(b, threads);
+            assert(sameKeys(subtracted, subtractReference));
+
+            ds::Treap<int> bulk(a);
+            std::vector<int> batch(bReference.begin(), bReference.end());
+            batch.insert(batch.end(), batch.begin(), batch.begin() + 100);      // Duplicates in the batch
+            bulk.insertBulk(batch, threads);
+            assert(sameKeys(bulk, unionReference));
+        }
+    }
+
+    static void testWBTree() {
+        ds::WBTree<int> tree = checkOrderedSet(ds::WBTree<int>(), 60000, 5000);
+
+        // rank/select agree with positions in the sorted sequence
+        std::vector<int> sorted(tree.begin(), tree.end());
+        for (size_t i = 0; i < sorted.size(); i++) assert(tree.select(i) == sorted[i]);
+        for (int key = -1; key <= 5001; key++) {
+            size_t expected = std::lower_bound(sorted.begin(), sorted.end(), key) - sorted.begin();
+            assert(tree.rank(key) == expected);
+        }
+        assert(tree.countRange(1000, 2000) == tree.rank(2000) - tree.rank(1000));
+        assert(tree.countRange(2000, 1000) == 0);
+        bool threw = false;
+        try {
+            tree.select(tree.size());
+        } catch (const std::out_of_range&) {
+            threw = true;
+        }
+        assert(threw);
+
+        // Sorted inserts and removes stay within the weight bound
+        // (height <= log_{4/3} n, about 39 here)
+        ds::WBTree<int> ascending;
+        for (int i = 0; i < 100000; i++) ascending.insert(i);
+        for (int i = 0; i < 100000; i += 3) ascending.remove(i);
+        assert(ascending.verify() && ascending.height() <= 39);
+
+        std::stringstream snapshot;
+        tree.save(snapshot);
+        ds::WBTree<int> loaded;
+        loaded.load(snapshot);
+        assert(loaded.verify() && std::equal(loaded.begin(), loaded.end(), sorted.begin(), sorted.end()));
+    }
+
+    template<typename T, size_t NodeBytes>
+    static void checkKaryTree(size_t n, uint64_t seed) {
+        std::mt19937_64 gen(seed);
+        std::vector<T> keys;
+        std::set<T> reference;
+        for (size_t i = 0; i < n; i++) {
+            T key = static_cast<T>(gen() % (3 * n + 1));
+            keys.push_back(key);
+            reference.insert(key);
+        }
+        ds::KaryTree<T, NodeBytes> tree(keys);
+        assert(tree.size() == reference.size());
+        assert(std::equal(tree.begin(), tree.end(), reference.begin(), reference.end()));
+        for (size_t probe = 0; probe <= 3 * n + 2; probe++) {
+            T key = static_cast<T>(probe);
+            assert(tree.contains(key) == (reference.count(key) == 1));
+            auto it = tree.lower_bound(key);
+            auto expected = reference.lower_bound(key);
+            assert((it == tree.end()) == (expected == reference.end()));
+            if (expected != reference.end()) assert(*it == *expected);
+            auto upper = tree.upper_bound(key);
+            auto expectedUpper = reference.upper_bound(key);
+            assert((upper == tree.end()) == (expectedUpper == reference.end()));
+            if (expectedUpper != reference.end()) assert(*upper == *expectedUpper);
+        }
+    }
+
+    static void testKaryTree() {
+        // Sizes around block and fan-out boundaries, on the SIMD key types
+        // and on one that takes the scalar path
+        for (size_t n : {0, 1, 15, 16, 17, 272, 273, 290, 20000}) {
+            checkKaryTree<int32_t, 64>(n, n);
+            checkKaryTree<int32_t, 128>(n, n);
+            checkKaryTree<int64_t, 64>(n, n);
+            checkKaryTree<float, 64>(n, n);
+            checkKaryTree<double, 64>(n, n);
+            checkKaryTree<uint16_t, 64>(n, n);
+        }
+
+        // Negative keys and the padding value itself
+        ds::KaryTree<int> edges({std::numeric_limits<int>::max(), -5, std::numeric_limits<int>::min(), 0, -5});
+        assert(edges.size() == 4 && *edges.begin() == std::numeric_limits<int>::min());
+        assert(edges.contains(std::numeric_limits<int>::max()) && edges.contains(-5) && !edges.contains(1));
+        assert(*edges.lower_bound(1) == std::numeric_limits<int>::max());
+
+        ds::KaryTree<double> prices({3300.0, 150.5, 2800.75, 290.25, 750.8});
+        assert(*prices.lower_bound(300.0) == 750.8 && prices.upper_bound(3300.0) == prices.end());
+        std::stringstream snapshot;
+        prices.save(snapshot);
+        ds::KaryTree<double> loaded;
+        loaded.load(snapshot);
+        assert(std::equal(loaded.begin(), loaded.end(), prices.begin(), prices.end()));
+
+        // NaN probes are found nowhere, however many index levels there are
+        std::vector<double> many(5000);
+        std::iota(many.begin(), many.end(), 1.0);
+        for (const ds::KaryTree<double>& tree : {prices, ds::KaryTree<double>(many)}) {
+            for (double probe : {std::nan(""), -std::nan("")}) {
+                assert(!tree.contains(probe));
+                assert(tree.lower_bound(probe) == tree.end() && tree.upper_bound(probe) == tree.end());
+            }
+        }
+
+        bool threw = false;
+        try {
+            prices.assign({1.0, std::nan("")});
+        } catch (const std::invalid_argument&) {
+            threw = true;
+        }
+        assert(threw);
+    }
+
+    static void testFrozenTree() {
+        // Sizes around complete levels of the implicit tree
+        for (size_t n : {0, 1, 2, 3, 7, 8, 9, 16, 100, 4097}) {
+            std::mt19937 gen(static_cast<unsigned>(n));
+            ds::AVLTree<int> tree;
+            std::set<int> reference;
+            for (size_t i = 0; i < n; i++) {
+                int key = static_cast<int>(gen() % (3 * n + 1));
+                tree.insert(key);
+                reference.insert(key);
+            }
+            ds::FrozenTree<int> frozen = tree.freeze();
+            assert(frozen.size() == reference.size());
+            assert(std::equal(frozen.begin(), frozen.end(), reference.begin(), reference.end()));
+            for (int key = -1; key <= static_cast<int>(3 * n + 2); key++) {
+                assert(frozen.contains(key) == (reference.count(key) == 1));
+                auto it = frozen.lower_bound(key);
+                auto expected = reference.lower_bound(key);
+                assert((it == frozen.end()) == (expected == reference.end()));
+                if (expected != reference.end()) assert(*it == *expected);
+                auto upper = frozen.upper_bound(key);
+                auto expectedUpper = reference.upper_bound(key);
+                assert((upper == frozen.end()) == (expectedUpper == reference.end()));
+                if (expectedUpper != reference.end()) assert(*upper == *expectedUpper);
+            }
+
+            ds::AVLTree<int> thawed = frozen.thaw();
+            assert(thawed.size() == reference.size() && thawed.diagnostics().valid());
+            assert(std::equal(thawed.begin(), thawed.end(), reference.begin(), reference.end()));
+        }
+
+        // BST round trip, string keys and snapshots shared with the trees
+        ds::BST<std::string> names;
+        for (const char* name : {"Smith", "Garcia", "Brown", "Wilson", "Miller"}) names.insert(name);
+        ds::FrozenTree<std::string> frozenNames = names.freeze();
+        assert(frozenNames.contains("Brown") && !frozenNames.contains("Jones"));
+        assert(*frozenNames.lower_bound("H") == "Miller" && frozenNames.height() == 3);
+        ds::BST<std::string> thawedNames = frozenNames.thaw<ds::BST<std::string>>();
+        assert(thawedNames.size() == 5 && thawedNames.contains("Wilson"));
+
+        std::stringstream snapshot;
+        frozenNames.save(snapshot);
+        ds::AVLTree<std::string> loaded;
+        loaded.load(snapshot);
+        assert(std::equal(loaded.begin(), loaded.end(), frozenNames.begin(), frozenNames.end()));
+    }
+
+    static void testVebTree() {
+        // Sizes around complete trees, where the padding is largest
+        for (size_t n : {0, 1, 2, 3, 4, 7, 8, 9, 31, 32, 33, 100, 4097, 70000}) {
+            std::mt19937 gen(static_cast<unsigned>(n));
+            ds::AVLTree<int> tree;
+            std::set<int> reference;
+            for (size_t i = 0; i < n; i++) {
+                int key = static_cast<int>(gen() % (3 * n + 1));
+                tree.insert(key);
+                reference.insert(key);
+            }
+            auto veb = tree.freeze<ds::VebTree<int>>();
+            assert(veb.size() == reference.size());
+            assert(std::equal(veb.begin(), veb.end(), reference.begin(), reference.end()));
+            for (int key = -1; key <= static_cast<int>(3 * n + 2); key++) {
+                assert(veb.contains(key) == (reference.count(key) == 1));
+                auto it = veb.lower_bound(key);
+                auto expected = reference.lower_bound(key);
+                assert((it == veb.end()) == (expected == reference.end()));
+                if (expected != reference.end()) assert(*it == *expected);
+                auto upper = veb.upper_bound(key);
+                auto expectedUpper = reference.upper_bound(key);
+                assert((upper == veb.end()) == (expectedUpper == reference.end()));
+                if (expectedUpper != reference.end()) assert(*upper == *expectedUpper);
+            }
+            assert(veb.memory_usage().nodeBytes < (2 * reference.size() + 1) * sizeof(int) || reference.empty());
+
+            ds::AVLTree<int> thawed = veb.thaw();
+            assert(thawed.diagnostics().valid());
+            assert(std::equal(thawed.begin(), thawed.end(), reference.begin(), reference.end()));
+        }
+
+        ds::BST<std::string> names;
+        for (const char* name : {"Smith", "Garcia", "Brown", "Wilson", "Miller", "Jones"}) names.insert(name);
+        auto frozenNames = names.freeze<ds::VebTree<std::string>>();
+        assert(frozenNames.contains("Jones") && !frozenNames.contains("Lee"));
+        assert(frozenNames.upper_bound("Wilson") == frozenNames.end());
+        std::stringstream snapshot;
+        frozenNames.save(snapshot);
+        ds::FrozenTree<std::string> eytzinger;
+        eytzinger.load(snapshot);
+        assert(std::equal(eytzinger.begin(), eytzinger.end(), frozenNames.begin(), frozenNames.end()));
+    }
+
+    static void testSmallTree() {
+        // Random walk across the promote (N + 1) and demote (N / 2) sizes
+        std::mt19937 gen(48);
+        ds::SmallTree<int, 8> tree;
+        std::set<int> reference;
+        bool promoted = false;
+        bool demoted = false;
+        for (int step = 0; step < 20000; step++) {
+            int key = static_cast<int>(gen() % 24);
+            if (gen() % 2 == 0) {
+                tree.insert(key);
+                reference.insert(key);
+            } else {
+                assert(tree.remove(key) == (reference.erase(key) == 1));
+            }
+            bool wasInline = tree.isInline();
+            assert(tree.size() == reference.size());
+            if (reference.size() > 8) assert(!tree.isInline());
+            if (reference.size() <= 4) assert(tree.isInline());
+            promoted |= !wasInline;
+            demoted |= promoted && wasInline;
+            assert(std::equal(tree.begin(), tree.end(), reference.begin(), reference.end()));
+            int probe = static_cast<int>(gen() % 26) - 1;
+            assert(tree.contains(probe) == (reference.count(probe) == 1));
+            auto it = tree.lower_bound(probe);
+            auto expected = reference.lower_bound(probe);
+            assert((it == tree.end()) == (expected == reference.end()));
+            if (expected != reference.end()) assert(*it == *expected);
+            auto upper = tree.upper_bound(probe);
+            auto expectedUpper = reference.upper_bound(probe);
+            assert((upper == tree.end()) == (expectedUpper == reference.end()));
+            if (expectedUpper != reference.end()) assert(*upper == *expectedUpper);
+        }
+        assert(promoted && demoted);
+
+        ds::SmallTree<int> empty;
+        assert(empty.empty() && empty.height() == 0 && empty.begin() == empty.end());
+        assert(empty.memory_usage().totalBytes() == 0);
+
+        // assignSorted and load pick the representation by size
+        std::vector<int> many(100);
+        std::iota(many.begin(), many.end(), 0);
+        ds::SmallTree<int> big;
+        big.assignSorted(many);
+        assert(!big.isInline() && big.size() == 100 && big.height() > 1);
+        std::stringstream snapshot;
+        big.save(snapshot);
+        ds::SmallTree<int> reloaded;
+        reloaded.load(snapshot);
+        assert(!reloaded.isInline() && std::equal(reloaded.begin(), reloaded.end(), many.begin(), many.end()));
+        big.clear();
+        assert(big.isInline() && big.empty());
+
+        // Non-trivial keys survive promotion and demotion
+        ds::SmallTree<std::string, 4> names;
+        for (const char* name : {"Smith", "Garcia", "Brown", "Wilson", "Miller", "Jones"}) names.insert(name);
+        assert(!names.isInline() && names.contains("Brown") && !names.contains("Lee"));
+        for (const char* name : {"Smith", "Garcia", "Wilson", "Miller"}) names.remove(name);
+        assert(names.isInline() && names.size() == 2);
+        assert(*names.begin() == "Brown" && *names.upper_bound("Brown") == "Jones");
+    }
+
+    // Random inserts, assignments and removes against std::map
+    template<typename Map, typename Value, typename MakeValue>
+    static void checkMap(MakeValue makeValue) {
+        std::mt19937 gen(49);
+        Map map;
+        std::map<int, Value> reference;
+        for (int step = 0; step < 5000; step++) {
+            int key = static_cast<int>(gen() % 400);
+            switch (gen() % 4) {
+                case 0:
+                    assert(map.try_emplace(key, makeValue(step)).second == reference.try_emplace(key, makeValue(step)).second);
+                    break;
+                case 1:
+                    assert(map.insert_or_assign(key, makeValue(step)).second == reference.insert_or_assign(key, makeValue(step)).second);
+                    break;
+                case 2:
+                    assert(map.remove(key) == (reference.erase(key) == 1));
+                    break;
+                default:
+                    map[key] = makeValue(-step);
+                    reference[key] = makeValue(-step);
+            }
+        }
+        assert(map.size() == reference.size());
+        assert(map.height() <= 1.45 * std::log2(static_cast<double>(map.size()) + 2));
+        auto expected = reference.begin();
+        for (auto [key, value] : map) {
+            assert(key == expected->first && value == expected->second);
+            ++expected;
+        }
+        for (int key = -1; key <= 401; key++) {
+            auto found = reference.find(key);
+            assert(map.contains(key) == (found != reference.end()));
+            if (found != reference.end()) assert(*map.find(key) == found->second && map.at(key) == found->second);
+            else assert(map.find(key) == nullptr);
+            auto lower = map.lower_bound(key);
+            auto expectedLower = reference.lower_bound(key);
+            assert((lower == map.end()) == (expectedLower == reference.end()));
+            if (expectedLower != reference.end()) assert(lower.key() == expectedLower->first);
+            auto upper = map.upper_bound(key);
+            auto expectedUpper = reference.upper_bound(key);
+            assert((upper == map.end()) == (expectedUpper == reference.end()));
+            if (expectedUpper != reference.end()) assert(upper.key() == expectedUpper->first);
+        }
+
+        // Values stay put while other keys are inserted and removed
+        int pinned = reference.begin()->first;
+        const Value* address = map.find(pinned);
+        for (int key = 1000; key < 1200; key++) map.try_emplace(key, makeValue(key));
+        for (int key = 1000; key < 1200; key += 2) map.remove(key);
+        assert(map.find(pinned) == address);
+
+        // Copies, paging and snapshots see the same entries
+        Map copy = map;
+        assert(map.remove(pinned) && copy.contains(pinned));
+        std::vector<std::pair<int, Value>> paged;
+        ds::PageToken<int> token;
+        while (true) {
+            auto page = copy.page(token, 17);
+            paged.insert(paged.end(), page.items.begin(), page.items.end());
+            token = page.next;
+            if (!page.hasMore) break;
+        }
+        assert(paged.size() == copy.size());
+        std::stringstream snapshot;
+        copy.save(snapshot);
+        Map reloaded;
+        reloaded.load(snapshot);
+        size_t i = 0;
+        reloaded.scanInorder([&](const int& key, const Value& value) {
+            assert(key == paged[i].first && value == paged[i].second);
+            i++;
+        });
+        assert(i == paged.size());
+        bool threw = false;
+        try { (void)map.at(-5); } catch (const std::out_of_range&) { threw = true; }
+        assert(threw);
+        assert(copy.memory_usage().nodes == copy.size());
+    }
+
+    static void testMaps() {
+        auto small = [](int i) { return i; };
+        auto wide = [](int i) { return WideValue{{i, i + 1, i + 2}}; };
+        static_assert(ds::AVLMap<int, int>::INLINE_VALUES && !ds::AVLMap<int, WideValue>::INLINE_VALUES);
+        checkMap<ds::AVLMap<int, int>, int>(small);
+        checkMap<ds::AVLMap<int, WideValue>, WideValue>(wide);
+        checkMap<ds::BSTMap<int, int>, int>(small);
+        checkMap<ds::BSTMap<int, WideValue>, WideValue>(wide);
+
+        // try_emplace builds nothing for a present key; BSTMap values are mutable in place
+        ds::AVLMap<std::string, std::vector<int>> lists;
+        assert(lists.try_emplace("a", 3, 7).second);
+        assert(!lists.try_emplace("a", 100, 0).second && lists.at("a").size() == 3);
+        lists["b"].push_back(1);
+        assert(lists.size() == 2 && lists.at("b") == std::vector<int>{1});
+        ds::BSTMap<std::string, int> counts;
+        counts["x"] = 1;
+        for (auto [key, value] : counts) value += 10;
+        assert(counts.at("x") == 11);
+
+        // Durable map: assignments and removes are replayed after reopening
+        auto dir = std::filesystem::temp_directory_path() / "ds_durable_map_test";
+        std::filesystem::remove_all(dir);
+        {
+            ds::DurableAVLMap<std::string, std::string> phones(dir.string());
+            assert(phones.insert_or_assign("Diana", "176"));
+            assert(!phones.insert_or_assign("Diana", "177"));
+            assert(phones.try_emplace("Chen", "+16") && !phones.try_emplace("Chen", "none"));
+            phones.checkpoint();
+            assert(phones.remove("Chen") && !phones.remove("Chen"));
+            phones.insert_or_assign("Gavi", "+5");
+        }
+        {
+            ds::DurableAVLMap<std::string, std::string> phones(dir.string());
+            assert(phones.size() == 2 && !phones.contains("Chen"));
+            assert(*phones.find("Diana") == "177" && *phones.find("Gavi") == "+5");
+        }
+        std::filesystem::remove_all(dir);
+    }
+
+    static void testMultiset() {
+        // Random walk over few distinct keys, so buckets grow and empty out
+        std::mt19937 gen(50);
+        ds::AVLMultiset<int> set;
+        ds::AVLMultimap<int, int> map;
+        std::multiset<int> setReference;
+        std::multimap<int, int> mapReference;
+        for (int step = 0; step < 20000; step++) {
+            int key = static_cast<int>(gen() % 40);
+            int value = static_cast<int>(gen() % 4);
+            if (gen() % 3 != 0) {
+                set.insert(key);
+                setReference.insert(key);
+                map.insert(key, value);
+                mapReference.emplace(key, value);
+            } else {
+                auto found = setReference.find(key);
+                assert(set.remove(key) == (found != setReference.end()));
+                if (found != setReference.end()) setReference.erase(found);
+                auto [first, last] = mapReference.equal_range(key);
+                auto match = std::find_if(first, last, [value](const auto& entry) { return entry.second == value; });
+                assert(map.remove(key, value) == (match != last));
+                if (match != last) mapReference.erase(match);
+            }
+            assert(set.size() == setReference.size() && map.size() == mapReference.size());
+        }
+        assert(set.verify() && map.verify());
+        assert(std::equal(set.begin(), set.end(), setReference.begin(), setReference.end()));
+        auto expected = mapReference.begin();
+        for (auto [key, value] : map) {
+            assert(key == expected->first && value == expected->second);
+            ++expected;
+        }
+        assert(expected == mapReference.end());
+
+        // Height follows distinct keys, however many entries each one holds
+        assert(set.distinct() <= 40 && set.height() <= 1.45 * std::log2(static_cast<double>(set.distinct()) + 2));
+        for (int key = -1; key <= 41; key++) {
+            assert(set.count(key) == setReference.count(key) && map.count(key) == mapReference.count(key));
+            assert(set.rank(key) == static_cast<size_t>(std::distance(setReference.begin(), setReference.lower_bound(key))));
+            assert(map.rank(key) == static_cast<size_t>(std::distance(mapReference.begin(), mapReference.lower_bound(key))));
+            auto lower = set.lower_bound(key);
+            auto expectedLower = setReference.lower_bound(key);
+            assert((lower == set.end()) == (expectedLower == setReference.end()));
+            if (expectedLower != setReference.end()) assert(*lower == *expectedLower);
+            auto upper = map.upper_bound(key);
+            auto expectedUpper = mapReference.upper_bound(key);
+            assert((upper == map.end()) == (expectedUpper == mapReference.end()));
+            if (expectedUpper != mapReference.end()) assert(upper.key() == expectedUpper->first && upper.value() == expectedUpper->second);
+        }
+        size_t k = 0;
+        for (auto entry = mapReference.begin(); entry != mapReference.end(); ++entry, ++k) {
+            auto selected = map.select(k);
+            assert(selected.key() == entry->first && selected.value() == entry->second);
+        }
+        k = 0;
+        for (int value : setReference) assert(set.select(k++) == value);
+        assert(set.countRange(10, 20) == static_cast<size_t>(std::distance(setReference.lower_bound(10), setReference.lower_bound(20))));
+        bool threw = false;
+        try { (void)set.select(set.size()); } catch (const std::out_of_range&) { threw = true; }
+        assert(threw);
+
+        // Snapshots write every entry and collapse runs again on load
+        std::stringstream setSnapshot;
+        set.save(setSnapshot);
+        ds::AVLMultiset<int> setReloaded;
+        setReloaded.load(setSnapshot);
+        assert(setReloaded.verify() && setReloaded.distinct() == set.distinct());
+        assert(std::equal(setReloaded.begin(), setReloaded.end(), setReference.begin(), setReference.end()));
+        std::stringstream mapSnapshot;
+        map.save(mapSnapshot);
+        ds::AVLMultimap<int, int> mapReloaded;
+        mapReloaded.load(mapSnapshot);
+        assert(mapReloaded.verify() && mapReloaded.size() == map.size());
+        assert(std::equal(mapReloaded.begin(), mapReloaded.end(), map.begin(), map.end(),
+                          [](auto a, auto b) { return a.first == b.first && a.second == b.second; }));
+
+        // One hot key: a single node, payloads kept in insertion order
+        ds::AVLMultimap<double, std::string> prices;
+        prices.insert(290.25, "MSFT");
+        prices.insert(150.50, "AAPL");
+        prices.insert(290.25, "NFLX");
+        prices.insert(290.25, "ORCL");
+        assert(prices.size() == 4 && prices.distinct() == 2 && prices.count(290.25) == 3);
+        assert(prices.remove(290.25, "MSFT") && !prices.remove(290.25, "MSFT") && !prices.remove(1.0, "AAPL"));
+        const auto* level = prices.find(290.25);
+        assert(level && level->size() == 2 && (*level)[0] == "NFLX" && (*level)[1] == "ORCL");
+        assert(prices.select(1).value() == "NFLX" && prices.countRange(100.0, 300.0) == 3);
+        assert(prices.removeAll(290.25) == 2 && prices.distinct() == 1 && prices.find(290.25) == nullptr);
+        assert(prices.memory_usage().nodes == 1);
+
+        ds::AVLMultiset<int> copies;
+        copies.insert(7, 1000000);
+        copies.insert(3);
+        assert(copies.size() == 1000001 && copies.distinct() == 2 && copies.height() == 2);
+        assert(copies.select(0) == 3 && copies.select(1000000) == 7 && copies.removeAll(7) == 1000000);
+        threw = false;
+        try { copies.insert(3, ds::AVLMultiset<int>::MAX_COPIES); } catch (const std::length_error&) { threw = true; }
+        assert(threw && copies.count(3) == 1);
+
+        // removeAt on a hot key walks one path and moves one payload
+        struct Tracked {
+            int id;
+            size_t* moves;
+            Tracked(int i, size_t* m) : id(i), moves(m) {}
+            Tracked(Tracked&& other) noexcept : id(other.id), moves(other.moves) { ++*moves; }
+            Tracked& operator=(Tracked&& other) noexcept {
+                id = other.id;
+                moves = other.moves;
+                ++*moves;
+                return *this;
+            }
+        };
+        size_t moves = 0;
+        ds::AVLMultimap<int, Tracked, ds::TreeStats> hot;
+        for (int i = 0; i < 20000; i++) hot.insert(i % 2 == 0 ? 0 : i, Tracked(i, &moves));
+        assert(hot.count(0) == 10000 && hot.distinct() == 10001);
+        moves = 0;
+        hot.resetStats();
+        assert(hot.removeAt(0, 17));
+        assert(moves == 1 && hot.stats().comparisons <= 2 * static_cast<uint64_t>(hot.height()));
+        assert(hot.count(0) == 9999 && (*hot.find(0))[17].id == 19998);
+        assert(hot.insert(0, Tracked(-1, &moves)) == 9999);
+        assert(!hot.removeAt(0, 10000) && !hot.removeAt(2, 0) && hot.removeAt(1, 0) && !hot.contains(1));
+        assert(hot.verify());
+    }
 };
 
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -6,7 +6,6 @@
 #include <windows.h>
 #include "test_basic.h"
 #include "test_advanced.h"
-#include "performance_tests.h"
 
 namespace Color {
     const std::string RED     = "\033[91m";  // Bright Red
@@ -107,10 +106,6 @@ public:
         runTestSuite("Basic Tests", test::BasicTests::runAll);
         runTestSuite("Advanced Tests", test::AdvancedTests::runAll);
 
-        // Run performance tests
-        std::cout << "\nStarting Performance Tests...\n";
-        test::PerformanceTests::runAll();
-
         printSummary();
     }
 